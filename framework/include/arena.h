@@ -0,0 +1,176 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/*! Memory arena for containers of one query (or of one route).
+Memory is taken from big chunks. All memory is released in one shot by release() instead of one by one.
+Chunks are kept after release(). So the next query of the same size doesn't call malloc at all.
+
+Node based containers (std::map, std::list) free and allocate nodes of one size all the time (e.g. the queue of A*).
+Freed small blocks are kept in lists by size and reused. So the arena doesn't grow with count of pushes into a queue.
+Big blocks (vector buffers) are not reused before release().
+
+It is not thread safe. Use one arena per thread (e.g. per RouteBuilder).
+*/
+struct Arena
+{
+	static const size_t DEFAULT_CHUNK_BYTES = 1024 * 1024;
+
+	explicit Arena(size_t chunkBytes = DEFAULT_CHUNK_BYTES) :
+		m_chunkBytes(chunkBytes),
+		m_current(0),
+		m_offset(0),
+		m_freeLists(MAX_POOLED_BYTES / GRANULARITY, nullptr)
+	{}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+	{
+		bytes = roundUp(std::max<size_t>(bytes, 1), GRANULARITY);
+		if (isPooled(bytes, alignment))
+		{
+			auto& freeList = m_freeLists[bytes / GRANULARITY - 1];
+			if (freeList)
+			{
+				FreeBlock* block = freeList;
+				freeList = block->next;
+				return block;
+			}
+		}
+		while (m_current < m_chunks.size())
+		{
+			auto& chunk = m_chunks[m_current];
+			const size_t offset = roundUp(m_offset, alignment);
+			if (offset + bytes <= chunk.size)
+			{
+				m_offset = offset + bytes;
+				return chunk.data.get() + offset;
+			}
+			m_current += 1;
+			m_offset = 0;
+		}
+		// A new chunk. Big requests get a chunk of their own size
+		Chunk chunk;
+		chunk.size = std::max(m_chunkBytes, bytes + alignment);
+		chunk.data.reset(new char[chunk.size]);
+		m_chunks.push_back(std::move(chunk));
+		m_current = m_chunks.size() - 1;
+		const size_t offset = alignmentGap(m_chunks.back().data.get(), alignment);
+		m_offset = offset + bytes;
+		return m_chunks.back().data.get() + offset;
+	}
+
+	void deallocate(void* pointer, size_t bytes, size_t alignment = alignof(std::max_align_t))
+	{
+		bytes = roundUp(std::max<size_t>(bytes, 1), GRANULARITY);
+		if (isPooled(bytes, alignment))
+		{
+			auto& freeList = m_freeLists[bytes / GRANULARITY - 1];
+			FreeBlock* block = static_cast<FreeBlock*>(pointer);
+			block->next = freeList;
+			freeList = block;
+		}
+	}
+
+	/// Releases all allocated memory. Containers that use the arena must not be used after it.
+	void release()
+	{
+		m_current = 0;
+		m_offset = 0;
+		std::fill(m_freeLists.begin(), m_freeLists.end(), nullptr);
+	}
+
+	size_t chunksCount() const { return m_chunks.size(); }//statistic
+
+	size_t reservedBytes() const//statistic
+	{
+		size_t result = 0;
+		for (const auto& chunk : m_chunks)
+		{
+			result += chunk.size;
+		}
+		return result;
+	}
+
+private:
+	static const size_t GRANULARITY = 16;
+	static const size_t MAX_POOLED_BYTES = 256;
+
+	struct Chunk
+	{
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	static size_t roundUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	static size_t alignmentGap(const char* pointer, size_t alignment)
+	{
+		const size_t address = reinterpret_cast<size_t>(pointer);
+		return roundUp(address, alignment) - address;
+	}
+
+	static bool isPooled(size_t bytes, size_t alignment)
+	{
+		return bytes <= MAX_POOLED_BYTES && alignment <= GRANULARITY;
+	}
+
+private:
+	const size_t m_chunkBytes;
+	std::vector<Chunk> m_chunks;
+	size_t m_current;// chunk for the next allocation
+	size_t m_offset;// in the current chunk
+	std::vector<FreeBlock*> m_freeLists;// by size / GRANULARITY - 1
+};
+
+/// Allocator of STL containers over an Arena. Containers with it have to get the allocator in constructor.
+template<typename T>
+struct ArenaAllocator
+{
+	using value_type = T;
+
+	explicit ArenaAllocator(Arena& arena) : m_arena(&arena)
+	{}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena())
+	{}
+
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* pointer, size_t count)
+	{
+		m_arena->deallocate(pointer, count * sizeof(T), alignof(T));
+	}
+
+	Arena* arena() const { return m_arena; }
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.arena(); }
+
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return m_arena != other.arena(); }
+
+private:
+	Arena* m_arena;
+};
+
+#endif // __ARENA_H__
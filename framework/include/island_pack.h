@@ -0,0 +1,115 @@
+#ifndef __ISLAND_PACK_H__
+#define __ISLAND_PACK_H__
+
+#include "map_types.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*! Island pack is a single preprocessed file with everything that is needed to serve routes.
+It is built offline (tools/island_pack.cpp) and is mapped into memory at start. So there is no parsing and no
+calculations at start.
+
+File format (little endian):
+	page 0:	PackHeader, PackSection table [sectionsCount]
+	pages:	sections. Every section starts at a page boundary (PACK_PAGE_SIZE). So it could be used in place.
+Version is increased on any incompatible change. Readers reject other versions.
+Every section has a checksum (FNV-1a 64). The header has a checksum of the header and the sections table.
+*/
+
+static const uint32_t PACK_VERSION = 1;
+static const size_t PACK_PAGE_SIZE = 4096;
+
+/// Types of sections. New indexes get new types. Readers skip unknown types.
+enum PackSectionType
+{
+	PS_ELEVATION = 1,       ///< uint8_t [sizeY][sizeX] as assets/elevation.data
+	PS_OVERRIDES = 2,       ///< uint8_t [sizeY][sizeX] as assets/overrides.data
+	PS_DRIVABLE = 3,        ///< not written. Drivability is in labels of PS_COMPONENTS. The type is not reused
+	PS_MOVE_TIMES = 4,      ///< TimeT [511 * 2] rover move times of PS_COMPONENTS by (deltaH + 255) * 2 + isDiagonal
+	PS_COMPONENTS = 5,      ///< connected component labels
+};
+
+#pragma pack(push,1)
+struct PackHeader
+{
+	char signature[8]; // "ISLEPACK"
+	uint32_t version;
+	uint32_t sectionsCount;
+	uint64_t sizeX;
+	uint64_t sizeY;
+	uint64_t checksum; // of the header with zero checksum and the sections table
+};
+
+struct PackSection
+{
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t offset; // from the start of file, multiple of PACK_PAGE_SIZE
+	uint64_t size;
+	uint64_t checksum;
+};
+#pragma pack(pop)
+
+/// FNV-1a 64 bits
+uint64_t packChecksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+/// Read only island pack mapped into memory
+struct IslandPack
+{
+	/// Maps the file into memory. Throws if it is not an island pack of the supported version.
+	static std::shared_ptr<const IslandPack> open(const std::string& filename);
+
+	~IslandPack();
+
+	size_t sizeX() const { return m_header.sizeX; }
+
+	size_t sizeY() const { return m_header.sizeY; }
+
+	/// \return section data or nullptr if there is no section of this type
+	const uint8_t* section(uint32_t type, size_t& size) const;
+
+	bool has(uint32_t type) const
+	{
+		size_t size = 0;
+		return section(type, size) != nullptr;
+	}
+
+	/// Verifies checksums of all sections. It reads the whole file.
+	bool verify(std::string& error) const;
+
+	const std::vector<PackSection>& sections() const { return m_sections; }
+
+private:
+	IslandPack() : m_data(nullptr), m_size(0) {}
+
+	IslandPack(const IslandPack&) = delete;
+	IslandPack& operator=(const IslandPack&) = delete;
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+	std::vector<uint8_t> m_buffer; // it is used if file mapping is not supported
+	PackHeader m_header;
+	std::vector<PackSection> m_sections;
+};
+
+/// Collects sections and writes island pack file
+struct IslandPackWriter
+{
+	IslandPackWriter(size_t sizeX, size_t sizeY) : m_sizeX(sizeX), m_sizeY(sizeY)
+	{}
+
+	void add(uint32_t type, const void* data, size_t size);
+
+	void write(const std::string& filename) const;
+
+private:
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	std::vector<std::pair<uint32_t, std::vector<uint8_t>>> m_sections;
+};
+
+#endif // __ISLAND_PACK_H__
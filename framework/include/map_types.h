@@ -3,6 +3,7 @@
 
 #include <utility>
 #include <vector>
+#include <cstdint>
 
 /// This type is used over all app for measure time with appropriate precision. 
 using TimeT = double;
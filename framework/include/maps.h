@@ -2,9 +2,11 @@
 #define __MAPS_H__
 
 #include "map_types.h"
+#include "page_memory.h"
 #include <vector>
 #include <list>
 #include <functional>
+#include <memory>
 
 struct BaseMap
 {
@@ -21,40 +23,118 @@ struct BaseMap
 
 	std::list<PointT> getNeighbors(const PointT& pnt) const;
 
+	/// The same neighbors, list nodes are taken from the allocator (see arena.h)
+	template<typename AllocatorT>
+	std::list<PointT, AllocatorT> getNeighbors(const PointT& pnt, const AllocatorT& allocator) const
+	{
+		bool hasLowerNodes = (pnt.second > 0);
+		bool hasLeftNodes = (pnt.first > 0);
+		bool hasUpperNodes = (static_cast<size_t>(pnt.second) + 1 < m_sizeY);
+		bool hasRightNodes = (static_cast<size_t>(pnt.first) + 1 < m_sizeX);
+		std::list<PointT, AllocatorT> result(allocator);
+		if (hasLeftNodes)
+		{
+			if (hasLowerNodes)
+			{
+				result.push_back(std::make_pair(pnt.first - 1, pnt.second - 1));
+			}
+			result.push_back(std::make_pair(pnt.first - 1, pnt.second));
+			if (hasUpperNodes)
+			{
+				result.push_back(std::make_pair(pnt.first - 1, pnt.second + 1));
+			}
+		}
+
+		if (hasRightNodes)
+		{
+			if (hasLowerNodes)
+			{
+				result.push_back(std::make_pair(pnt.first + 1, pnt.second - 1));
+			}
+			result.push_back(std::make_pair(pnt.first + 1, pnt.second));
+			if (hasUpperNodes)
+			{
+				result.push_back(std::make_pair(pnt.first + 1, pnt.second + 1));
+			}
+		}
+
+		if (hasLowerNodes)
+		{
+			result.push_back(std::make_pair(pnt.first, pnt.second - 1));
+		}
+		if (hasUpperNodes)
+		{
+			result.push_back(std::make_pair(pnt.first, pnt.second + 1));
+		}
+		return result;
+	}
+
 protected:
 	const size_t m_sizeX;
 	const size_t m_sizeY;
 };
 
+struct TileCache;
+
 /// It's a wrapper with additional checks and functionality over a input NodesT map data
+/// Data could be in memory, in memory of another owner (e.g. mapped island pack) 
+/// or in a tiled map file, which is loaded on demand (see tiled_map.h)
 struct MapExplorer: public BaseMap
 {
 	MapExplorer(const NodesT&& points, size_t sizeX, size_t sizeY) : 
 		BaseMap(sizeX, sizeY),
-		m_nodes(std::move(points))
+		m_nodes(std::move(points)),
+		m_data(&m_nodes[0])
+	{
+	}
+
+	/// Data is not copied. The owner keeps it alive while the explorer exists
+	MapExplorer(const uint8_t* data, size_t sizeX, size_t sizeY, std::shared_ptr<const void> owner) :
+		BaseMap(sizeX, sizeY),
+		m_data(data),
+		m_owner(owner)
 	{
 	}
 
+	explicit MapExplorer(std::shared_ptr<TileCache> tiles);
+
+	MapExplorer(const MapExplorer&) = delete;
+	MapExplorer& operator=(const MapExplorer&) = delete;
+
 	uint8_t get(const PointT& pnt) const
 	{
+		if (!m_data)
+		{
+			return getTiled(pnt);
+		}
 		checkBoundaries(pnt);
-		return m_nodes[m_sizeX * pnt.second + pnt.first];
+		return m_data[m_sizeX * pnt.second + pnt.first];
 	}
 
-	const uint8_t* rawData() { return &m_nodes[0]; }
+	/// It is available for maps in memory only
+	const uint8_t* rawData() const;
+
+	bool isTiled() const { return static_cast<bool>(m_tiles); }
+
+private:
+	uint8_t getTiled(const PointT& pnt) const;
 
 private:
 	const NodesT m_nodes;
+	const uint8_t* m_data;
+	std::shared_ptr<const void> m_owner;
+	std::shared_ptr<TileCache> m_tiles;
 };
 
-/// Map for route building
+/// Map for route building. The grid is in huge pages by default (see page_memory.h), searches touch it randomly
 struct RWMap: public BaseMap
 {
-	RWMap(size_t sizeX, size_t sizeY, TimeT defaultValue, std::function<bool(const TimeT&)> isDefault) :
+	RWMap(size_t sizeX, size_t sizeY, TimeT defaultValue, std::function<bool(const TimeT&)> isDefault,
+			PagePolicy pages = PP_TRANSPARENT, int node = ANY_NODE) :
 											BaseMap(sizeX, sizeY),
 											m_defaultValue(defaultValue),
 											m_isDefault(isDefault),
-											m_map(sizeX * sizeY, defaultValue)
+											m_map(sizeX * sizeY, defaultValue, PageAllocator<TimeT>(pages, node))
 	{}
 
 	TimeT get(const PointT& pnt) const
@@ -71,10 +151,18 @@ struct RWMap: public BaseMap
 
 	std::list<PointT> getReachableNeighbors(PointT& pnt) const;
 
+	template<typename AllocatorT>
+	std::list<PointT, AllocatorT> getReachableNeighbors(const PointT& pnt, const AllocatorT& allocator) const
+	{
+		auto result = BaseMap::getNeighbors(pnt, allocator);
+		result.remove_if([&](const PointT& val) { return m_isDefault(get(val)); });
+		return result;
+	}
+
 	void reset() { m_map.assign(m_map.size(), m_defaultValue);}
 private:
 	const TimeT m_defaultValue;
 	std::function<bool(TimeT)> m_isDefault;
-	std::vector<TimeT> m_map;
+	std::vector<TimeT, PageAllocator<TimeT>> m_map;
 };
 #endif // __MAPS_H__
\ No newline at end of file
@@ -0,0 +1,134 @@
+#ifndef __PAGE_MEMORY_H__
+#define __PAGE_MEMORY_H__
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+#include <stdint.h>
+
+/*! Memory of big grids (maps, times to arrive) in pages of a chosen size on a chosen NUMA node.
+Searches touch grids randomly. With 4 KB pages nearly every access to a 32 MB grid is a TLB miss,
+2 MB pages cover it by 16 TLB entries.
+PP_TRANSPARENT asks the kernel for transparent huge pages (madvise). It is enough if THP is "madvise" or "always".
+PP_EXPLICIT takes pages from the pool of huge pages (vm.nr_hugepages) and falls back to transparent ones.
+Memory is bound to a node by the preferred policy. The kernel takes another node if the node has no free memory.
+Everything falls back to regular pages on other platforms.
+*/
+enum PagePolicy
+{
+	PP_REGULAR,     ///< pages of the system allocator
+	PP_TRANSPARENT, ///< transparent huge pages
+	PP_EXPLICIT     ///< huge pages from the reserved pool, transparent ones if the pool is empty
+};
+
+static const int ANY_NODE = -1;
+static const size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+/*! Allocates memory by the policy. Size is rounded up to HUGE_PAGE_BYTES.
+	\param[out] granted the policy that is applied actually. It could be less than requested
+*/
+void* allocatePages(size_t bytes, PagePolicy policy, int node = ANY_NODE, PagePolicy* granted = nullptr);
+
+/// Frees memory of allocatePages. Size is the same as in allocatePages
+void freePages(void* pointer, size_t bytes);
+
+/// Memory block of allocatePages. It is an owner of map data (see MapExplorer)
+struct PageBlock
+{
+	static std::shared_ptr<PageBlock> allocate(size_t bytes, PagePolicy policy, int node = ANY_NODE)
+	{
+		std::shared_ptr<PageBlock> result(new PageBlock(bytes));
+		result->m_data = static_cast<uint8_t*>(allocatePages(bytes, policy, node, &result->m_granted));
+		result->m_node = node;
+		return result;
+	}
+
+	~PageBlock()
+	{
+		freePages(m_data, m_size);
+	}
+
+	PageBlock(const PageBlock&) = delete;
+	PageBlock& operator=(const PageBlock&) = delete;
+
+	uint8_t* data() const { return m_data; }
+
+	size_t size() const { return m_size; }
+
+	/// \return the policy that is applied actually
+	PagePolicy granted() const { return m_granted; }
+
+	int node() const { return m_node; }
+
+private:
+	explicit PageBlock(size_t size) : m_data(nullptr), m_size(size), m_granted(PP_REGULAR), m_node(ANY_NODE)
+	{}
+
+private:
+	uint8_t* m_data;
+	const size_t m_size;
+	PagePolicy m_granted;
+	int m_node;
+};
+
+/// Allocator of STL containers. Big blocks (vector buffers of grids) are taken by allocatePages, small ones by operator new
+template<typename T>
+struct PageAllocator
+{
+	using value_type = T;
+
+	explicit PageAllocator(PagePolicy policy = PP_TRANSPARENT, int node = ANY_NODE) : m_policy(policy), m_node(node)
+	{}
+
+	template<typename U>
+	PageAllocator(const PageAllocator<U>& other) : m_policy(other.policy()), m_node(other.node())
+	{}
+
+	T* allocate(size_t count)
+	{
+		const size_t bytes = count * sizeof(T);
+		if (m_policy == PP_REGULAR || bytes < HUGE_PAGE_BYTES)
+		{
+			return static_cast<T*>(::operator new(bytes));
+		}
+		return static_cast<T*>(allocatePages(bytes, m_policy, m_node));
+	}
+
+	void deallocate(T* pointer, size_t count)
+	{
+		const size_t bytes = count * sizeof(T);
+		if (m_policy == PP_REGULAR || bytes < HUGE_PAGE_BYTES)
+		{
+			::operator delete(pointer);
+			return;
+		}
+		freePages(pointer, bytes);
+	}
+
+	PagePolicy policy() const { return m_policy; }
+
+	int node() const { return m_node; }
+
+	template<typename U>
+	bool operator==(const PageAllocator<U>& other) const { return m_policy == other.policy() && m_node == other.node(); }
+
+	template<typename U>
+	bool operator!=(const PageAllocator<U>& other) const { return !(*this == other); }
+
+private:
+	PagePolicy m_policy;
+	int m_node;
+};
+
+/// NUMA nodes of the host. There is one node 0 if the platform doesn't tell them
+struct NumaTopology
+{
+	/// \return ids of nodes that are online
+	static std::vector<int> nodes();
+
+	/// Binds the current thread to CPUs of the node. \return false if it is not supported
+	static bool bindThread(int node);
+};
+
+#endif // __PAGE_MEMORY_H__
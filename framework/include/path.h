@@ -2,12 +2,22 @@
 #define __PATH_TIMES_H__
 
 #include "map_types.h"
+#include "arena.h"
 //#include <unordered_map>
+#include <functional>
 #include <map>
+#include <memory>
 
-/// Keep route with times
-struct PathTimes
+/// Keep route with times. AllocatorT allocates nodes of the route (see arena.h)
+template<typename AllocatorT = std::allocator<std::pair<const PointT, TimeT>>>
+struct BasicPathTimes
 {
+	BasicPathTimes()
+	{}
+
+	explicit BasicPathTimes(const AllocatorT& allocator) : m_path(std::less<PointT>(), allocator)
+	{}
+
 	/// Returns false if no item found. If found returns true and time for get in this point from previous 
 	bool extract(const PointT& node, TimeT& time) const
 	{
@@ -26,6 +36,21 @@ struct PathTimes
 		m_path[pnt] = tm;
 	}
 
+	/// Calls function(point, time) for every point of the route
+	template<typename FunctionT>
+	void forEach(FunctionT function) const
+	{
+		for (const auto& node : m_path)
+		{
+			function(node.first, node.second);
+		}
+	}
+
+	void clear()
+	{
+		m_path.clear();
+	}
+
 	TimeT getForecastTime() const
 	{
 		TimeT elapsed = 0.0;
@@ -38,7 +63,11 @@ struct PathTimes
 private:
 	// TODO move to unordered_map. It's need hash function for PointT for this
 	//std::unordered_map<PointT, TimeT> m_path;
-	std::map<PointT, TimeT> m_path;
+	std::map<PointT, TimeT, std::less<PointT>, AllocatorT> m_path;
 };
 
+using PathTimes = BasicPathTimes<>;
+
+using ArenaPathTimes = BasicPathTimes<ArenaAllocator<std::pair<const PointT, TimeT>>>;
+
 #endif //__PATH_TIMES_H__
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include <string>
+#include <stdint.h>
+
+/*! Hardware counters of phases of a query (search, path extraction, rendering). Wall clock doesn't tell
+if a phase waits for memory or for mispredicted branches, counters do.
+They are Linux perf events of the calling thread (perf_event_open). Counting doesn't stop between phases,
+a phase is the difference of reads at its ends. Events that don't fit into the hardware are multiplexed
+by the kernel, their counts are scaled by the share of time they were counted.
+Counters are often not available: other platforms, containers without CAP_PERFMON, perf_event_paranoid > 2,
+VMs without virtual PMU. Then PerfCounts have no events and the search works as without counters.
+An event could be missing alone (e.g. a VM has cycles but no cache events), others are counted.
+*/
+enum PerfEvent
+{
+	PE_CYCLES,
+	PE_INSTRUCTIONS,
+	PE_L1D_MISSES,     ///< L1 data cache read misses
+	PE_LLC_MISSES,     ///< last level cache misses
+	PE_DTLB_MISSES,    ///< data TLB read misses
+	PE_BRANCH_MISSES,
+	PE_COUNT
+};
+
+/// Counts of events of a phase. Events that are not counted are 0
+struct PerfCounts
+{
+	PerfCounts() : mask(0)
+	{
+		for (int event = 0; event < PE_COUNT; ++event)
+		{
+			values[event] = 0;
+		}
+	}
+
+	uint64_t values[PE_COUNT];
+	uint32_t mask;// bits (1 << PerfEvent) of counted events
+
+	bool has(PerfEvent event) const { return (mask & (1u << event)) != 0; }
+
+	uint64_t operator[](PerfEvent event) const { return values[event]; }
+
+	/// Sums of phases or queries
+	PerfCounts& operator+=(const PerfCounts& other)
+	{
+		mask |= other.mask;
+		for (int event = 0; event < PE_COUNT; ++event)
+		{
+			values[event] += other.values[event];
+		}
+		return *this;
+	}
+
+	static const char* name(PerfEvent event);
+};
+
+/// Counters of the calling thread. They are opened by the first call of the thread and closed with it
+struct PerfCounters
+{
+	static PerfCounters& thread();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	/// At least one event is counted
+	bool available() const { return m_mask != 0; }
+
+	uint32_t mask() const { return m_mask; }
+
+	/// Why events are not counted, e.g. "cycles: Permission denied". Empty if all of them are counted
+	const std::string& error() const { return m_error; }
+
+	/// Counts since the start of the thread. A phase is the difference of two reads (see PerfPhase)
+	PerfCounts read() const;
+
+private:
+	PerfCounters();
+	~PerfCounters();
+
+private:
+	int m_descriptors[PE_COUNT];// -1 if the event is not counted
+	uint32_t m_mask;
+	std::string m_error;
+};
+
+/// Counts of a phase from construction to stop(). Nothing is read if it is not enabled
+struct PerfPhase
+{
+	explicit PerfPhase(bool enabled) : m_counters(enabled ? &PerfCounters::thread() : nullptr)
+	{
+		if (m_counters)
+		{
+			m_begin = m_counters->read();
+		}
+	}
+
+	/// Adds counts since the construction or the previous stop to the result
+	void stop(PerfCounts& result)
+	{
+		if (!m_counters)
+		{
+			return;
+		}
+		const PerfCounts end = m_counters->read();
+		PerfCounts phase;
+		phase.mask = end.mask;
+		for (int event = 0; event < PE_COUNT; ++event)
+		{
+			// Scaled counts of multiplexed events could go back a bit
+			phase.values[event] = (end.values[event] > m_begin.values[event]) ? end.values[event] - m_begin.values[event] : 0;
+		}
+		result += phase;
+		m_begin = end;
+	}
+
+private:
+	PerfCounters* m_counters;
+	PerfCounts m_begin;
+};
+
+#endif // __PERF_COUNTERS_H__
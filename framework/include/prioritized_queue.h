@@ -1,11 +1,24 @@
 #ifndef __PRIORITIZED_QUEUE_H__
 #define __PRIORITIZED_QUEUE_H__
+#include <functional>
 #include <map>
+#include <memory>
+
+#include "arena.h"
 
 // This implementation of queue interface makes quick access to ordered by priority elements of the queue
-template<typename PriorityT, typename ValueT>
+// AllocatorT allocates nodes of the queue. ArenaPrioritizedQueue takes them from an Arena of the query.
+template<typename PriorityT, typename ValueT, typename AllocatorT = std::allocator<std::pair<const PriorityT, ValueT>>>
 struct PrioritizedQueue
 {
+	using allocator_type = AllocatorT;
+
+	PrioritizedQueue()
+	{}
+
+	explicit PrioritizedQueue(const AllocatorT& allocator) : m_data(std::less<PriorityT>(), allocator)
+	{}
+
 	bool empty() const
 	{
 		return m_data.empty();
@@ -40,7 +53,20 @@ struct PrioritizedQueue
 	}
 
 	size_t size() const { return m_data.size(); }
+
+	/// Calls function(priority, value) for all elements in order of priority
+	template<typename FunctionT>
+	void forEach(FunctionT function) const
+	{
+		for (const auto& element : m_data)
+		{
+			function(element.first, element.second);
+		}
+	}
 private:
-	std::multimap<PriorityT, ValueT> m_data;// Queue data are saved in a balanced by key RB-tree
+	std::multimap<PriorityT, ValueT, std::less<PriorityT>, AllocatorT> m_data;// Queue data are saved in a balanced by key RB-tree
 };
+
+template<typename PriorityT, typename ValueT>
+using ArenaPrioritizedQueue = PrioritizedQueue<PriorityT, ValueT, ArenaAllocator<std::pair<const PriorityT, ValueT>>>;
 #endif //__PRIORITIZED_QUEUE_H__
\ No newline at end of file
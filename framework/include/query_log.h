@@ -0,0 +1,112 @@
+#ifndef __QUERY_LOG_H__
+#define __QUERY_LOG_H__
+
+#include "map_types.h"
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*! Query log keeps routing requests with their results. It is captured by RouteBuilder (see RouteBuilder::setQueryLog)
+and re-executed by tools/route_replay.cpp against another build to compare costs, expansions and latencies.
+
+File format (little endian):
+	QueryLogHeader, QueryRecord [until the end of file]
+Records are of a fixed size. So a log that is cut by a crash is still readable up to the last whole record.
+Version is increased on any incompatible change. Readers reject other versions.
+*/
+
+static const uint32_t QUERY_LOG_VERSION = 3;
+
+/// Flags of QueryRecord::mode
+enum QueryModeFlags
+{
+	QM_ANYTIME = 1,     ///< SearchOptions::anytime
+	QM_CORRIDOR = 2,    ///< the search was restricted by a corridor
+	QM_CLIMB_BOUND = 4, ///< SearchOptions::climbBound
+	QM_GOAL_BOUNDS = 8, ///< SearchOptions::goalBounds
+	QM_SWAMPS = 16,     ///< SearchOptions::swamps
+	QM_FIRST_MOVES = 32,///< SearchOptions::firstMoves
+	QM_PLATEAUS = 64,   ///< SearchOptions::plateaus
+};
+
+/// QueryRecord::vehicle. Parameters of the vehicle are logged for all but QV_DEFAULT
+enum QueryVehicle
+{
+	QV_DEFAULT = 0, ///< SearchOptions::vehicle is nullptr
+	QV_ROVER = 1,   ///< VehicleProfile::rover()
+	QV_TRUCK = 2,   ///< VehicleProfile::truck()
+	QV_BIKE = 3,    ///< VehicleProfile::bike()
+	QV_CUSTOM = 4,  ///< another profile, it is restored by its parameters
+};
+
+#pragma pack(push,1)
+struct QueryLogHeader
+{
+	char signature[8]; // "ISLEQLOG"
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t mapChecksum; // see MapsModel::checksum
+	uint64_t sizeX;
+	uint64_t sizeY;
+};
+
+struct QueryRecord
+{
+	int32_t startX;
+	int32_t startY;
+	int32_t finishX;
+	int32_t finishY;
+	uint8_t mode; // QueryModeFlags
+	uint8_t state; // SearchOptions::StateBackend
+	uint8_t found;
+	uint8_t reserved;
+	float epsilon;
+	float epsilonStep;
+	uint32_t deadlineUs; // from the start of the query, 0 if there is no deadline
+	double time; // cost of the route
+	uint64_t expansions;
+	uint32_t latencyUs;
+	uint32_t corridorFactor; // CorridorMask::factor of the corridor of QM_CORRIDOR queries
+	uint32_t corridorWidth; // CorridorMask::width
+	uint8_t vehicle; // QueryVehicle
+	uint8_t vehicleForbidden; // VehicleProfile::forbiddenFlags
+	uint16_t vehicleReserved;
+	int32_t vehicleMaxClimb; // VehicleProfile::maxClimb
+	int32_t vehicleMaxDescent; // VehicleProfile::maxDescent
+	double vehicleSpeed; // VehicleProfile::speed
+	double vehicleSlopeScale; // VehicleProfile::slopeScale
+};
+#pragma pack(pop)
+
+/// Appends records to a new log file. It is thread safe, several routers could share one log
+struct QueryLogWriter
+{
+	/// Creates the file. Throws if it could not be created
+	QueryLogWriter(const std::string& filename, uint64_t mapChecksum, size_t sizeX, size_t sizeY);
+
+	QueryLogWriter(const QueryLogWriter&) = delete;
+	QueryLogWriter& operator=(const QueryLogWriter&) = delete;
+
+	void append(const QueryRecord& record);
+
+	void flush();
+
+private:
+	std::mutex m_mutex;
+	std::ofstream m_out;
+};
+
+/// Log read into memory
+struct QueryLog
+{
+	/// Throws if it is not a query log of the supported version
+	static QueryLog read(const std::string& filename);
+
+	QueryLogHeader header;
+	std::vector<QueryRecord> records;
+};
+
+#endif // __QUERY_LOG_H__
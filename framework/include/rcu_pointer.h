@@ -0,0 +1,93 @@
+#ifndef __RCU_POINTER_H__
+#define __RCU_POINTER_H__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+/*! Shared pointer that is read without locks and replaced by writers (read-copy-update).
+Readers take a copy of the shared pointer. The copy keeps the value alive as long as they need it,
+e.g. one query sees one version of maps even if a new one is published meanwhile.
+The pointer to the copied shared pointer (the holder) is protected by epochs: a reader counts itself in the
+counter of the current epoch while it copies. A writer publishes a new holder, switches the epoch and waits until
+readers of the previous epoch leave (a grace period). It is a few instructions of copy, so writers don't wait long.
+Then the old holder is deleted. The value itself is deleted by the last copy.
+Writers are serialized by a mutex, readers never lock: they retry if the epoch is switched while they enter it.
+*/
+template<typename T>
+struct RcuPointer
+{
+	explicit RcuPointer(std::shared_ptr<const T> value) :
+		m_current(new Holder(std::move(value))),
+		m_epoch(0)
+	{
+		m_readers[0].count.store(0);
+		m_readers[1].count.store(0);
+	}
+
+	~RcuPointer()
+	{
+		delete m_current.load();
+	}
+
+	RcuPointer(const RcuPointer&) = delete;
+	RcuPointer& operator=(const RcuPointer&) = delete;
+
+	/// \return the last published value. It is lock-free
+	std::shared_ptr<const T> load() const
+	{
+		for (;;)
+		{
+			const uint64_t epoch = m_epoch.load();
+			auto& readers = m_readers[epoch & 1].count;
+			readers.fetch_add(1);
+			if (m_epoch.load() != epoch)
+			{
+				// A writer switched the epoch and could miss this reader. Enter the new one
+				readers.fetch_sub(1);
+				continue;
+			}
+			std::shared_ptr<const T> result = m_current.load()->value;
+			readers.fetch_sub(1);
+			return result;
+		}
+	}
+
+	/// Publishes the value. Readers that copied the previous one keep it
+	void store(std::shared_ptr<const T> value)
+	{
+		std::lock_guard<std::mutex> lock(m_writer);
+		Holder* previous = m_current.exchange(new Holder(std::move(value)));
+		// Readers of the previous epoch could copy the previous holder. New readers see the new one
+		const uint64_t epoch = m_epoch.fetch_add(1);
+		while (m_readers[epoch & 1].count.load() != 0)
+		{
+			std::this_thread::yield();
+		}
+		delete previous;
+	}
+
+private:
+	struct Holder
+	{
+		explicit Holder(std::shared_ptr<const T> value) : value(std::move(value))
+		{}
+
+		const std::shared_ptr<const T> value;
+	};
+
+	/// Counters of readers are on different cache lines
+	struct alignas(64) Readers
+	{
+		std::atomic<uint64_t> count;
+	};
+
+	std::atomic<Holder*> m_current;
+	std::atomic<uint64_t> m_epoch;
+	mutable Readers m_readers[2];// by epoch parity
+	std::mutex m_writer;
+};
+
+#endif // __RCU_POINTER_H__
@@ -0,0 +1,286 @@
+#ifndef __ROUTE_CODEC_H__
+#define __ROUTE_CODEC_H__
+
+#include "map_types.h"
+
+#include <cmath>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+/*! Output formats of routes for clients. A route is streamed from its source to std::ostream without copies.
+A source is any object with forEachStep(function(point, time)) that calls the function for every point of the route
+in order of the drive. Time is of the move to the point, it is 0 for the start point (see RouteBuilder::forEachStep).
+
+Binary format (little endian, all integers are LEB128 varints unless noted):
+	version, count of moves N, start x, start y, time divider D (times are quantized by 1/D of island second),
+	directions of N moves [(3 * N + 7) / 8 bytes, 3 bits per move from the lowest bit, codes are of offset()],
+	N zigzag varints: the difference of quantized move times from the previous move (the first one is from 0).
+Elapsed time is quantized, not times of moves. So the error of any elapsed time is 0.5 / D without accumulation.
+Moves of equal time (common on plains) take one byte of time and 3 bits of direction.
+
+Polyline is a route simplified to points where the direction changes with elapsed times (see forEachVertex).
+It is written as an encoded polyline (the format of Google maps) of triples: x, y, elapsed time * D.
+GeoJSON is a LineString Feature of the polyline in cells of the map. Elapsed times are in "elapsed" property.
+*/
+struct RouteStep
+{
+	PointT pnt;
+	TimeT time;// of the move to the point
+};
+
+/// Route in memory, e.g. a decoded one. It is a source of the codec
+struct RouteSteps
+{
+	std::vector<RouteStep> steps;
+
+	template<typename FunctionT>
+	void forEachStep(FunctionT function) const
+	{
+		for (const auto& step : steps)
+		{
+			function(step.pnt, step.time);
+		}
+	}
+};
+
+struct RouteCodec
+{
+	static const uint32_t VERSION = 1;
+	static const uint32_t DEFAULT_TIME_DIVIDER = 1024; // times in 1/1024 of island second
+
+	template<typename RouteT>
+	static void writeBinary(std::ostream& out, const RouteT& route, uint32_t timeDivider = DEFAULT_TIME_DIVIDER);
+
+	/// Reads a route of writeBinary. Times are restored up to quantization
+	static RouteSteps readBinary(std::istream& in);
+
+	/** Calls function(point, elapsed time) for the start, the finish and points where the direction of moves changes.
+		Straight runs between them are not needed to draw the route.
+	*/
+	template<typename RouteT, typename FunctionT>
+	static void forEachVertex(const RouteT& route, FunctionT function);
+
+	template<typename RouteT>
+	static void writePolyline(std::ostream& out, const RouteT& route, uint32_t timeDivider = DEFAULT_TIME_DIVIDER);
+
+	template<typename RouteT>
+	static void writeGeoJson(std::ostream& out, const RouteT& route);
+
+	/// Code of the move between neighbors. The same order as BaseMap::getNeighbors
+	static uint8_t direction(const PointT& from, const PointT& to)
+	{
+		const int dX = to.first - from.first;
+		const int dY = to.second - from.second;
+		for (uint8_t code = 0; code < 8; ++code)
+		{
+			if (offset(code)[0] == dX && offset(code)[1] == dY)
+			{
+				return code;
+			}
+		}
+		throw std::invalid_argument("Points of the route are not neighbors");
+	}
+
+	static const int* offset(uint8_t code)
+	{
+		static const int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+		return offsets[code];
+	}
+
+private:
+	static void put(std::streambuf& out, char value)
+	{
+		if (out.sputc(value) == std::streambuf::traits_type::eof())
+		{
+			throw std::runtime_error("Can't write the route");
+		}
+	}
+
+	static void writeVarint(std::streambuf& out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			put(out, static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		put(out, static_cast<char>(value));
+	}
+
+	static uint64_t zigzag(int64_t value)
+	{
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+
+	static int64_t quantize(TimeT time, uint32_t timeDivider)
+	{
+		return static_cast<int64_t>(std::llround(time * timeDivider));
+	}
+
+	/// Value of the encoded polyline: zigzag, 5 bits per char from the lowest ones, 0x20 is the continuation
+	static void writePolylineValue(std::streambuf& out, int64_t value)
+	{
+		uint64_t bits = zigzag(value);
+		while (bits >= 0x20)
+		{
+			put(out, static_cast<char>((0x20 | (bits & 0x1F)) + 63));
+			bits >>= 5;
+		}
+		put(out, static_cast<char>(bits + 63));
+	}
+};
+
+template<typename RouteT>
+void RouteCodec::writeBinary(std::ostream& out, const RouteT& route, uint32_t timeDivider)
+{
+	if (timeDivider == 0)
+	{
+		throw std::invalid_argument("Time divider should be > 0");
+	}
+	std::streambuf& buffer = *out.rdbuf();
+	size_t moves = 0;
+	PointT start(0, 0);
+	route.forEachStep([&](const PointT& pnt, TimeT) {
+		if (moves++ == 0)
+		{
+			start = pnt;
+		}
+	});
+	moves = moves ? moves - 1 : 0;
+	writeVarint(buffer, VERSION);
+	writeVarint(buffer, moves);
+	writeVarint(buffer, static_cast<uint32_t>(start.first));
+	writeVarint(buffer, static_cast<uint32_t>(start.second));
+	writeVarint(buffer, timeDivider);
+
+	// Directions
+	bool first = true;
+	PointT previous(0, 0);
+	uint32_t bits = 0;
+	size_t bitsCount = 0;
+	route.forEachStep([&](const PointT& pnt, TimeT) {
+		if (!first)
+		{
+			bits |= static_cast<uint32_t>(direction(previous, pnt)) << bitsCount;
+			bitsCount += 3;
+			while (bitsCount >= 8)
+			{
+				put(buffer, static_cast<char>(bits & 0xFF));
+				bits >>= 8;
+				bitsCount -= 8;
+			}
+		}
+		first = false;
+		previous = pnt;
+	});
+	if (bitsCount)
+	{
+		put(buffer, static_cast<char>(bits & 0xFF));
+	}
+
+	// Times
+	first = true;
+	TimeT elapsed = 0.0;
+	int64_t quantized = 0;
+	int64_t lastMove = 0;
+	route.forEachStep([&](const PointT&, TimeT time) {
+		if (first)
+		{
+			first = false;
+			return;
+		}
+		elapsed += time;
+		const int64_t next = quantize(elapsed, timeDivider);
+		const int64_t move = next - quantized;
+		writeVarint(buffer, zigzag(move - lastMove));
+		quantized = next;
+		lastMove = move;
+	});
+}
+
+template<typename RouteT, typename FunctionT>
+void RouteCodec::forEachVertex(const RouteT& route, FunctionT function)
+{
+	// A point is a vertex if the move from it differs from the move to it. So it is known at the next point
+	size_t index = 0;
+	PointT previous(0, 0);
+	TimeT previousElapsed = 0.0;
+	int lastDirection = -1;
+	TimeT elapsed = 0.0;
+	route.forEachStep([&](const PointT& pnt, TimeT time) {
+		elapsed += (index == 0) ? 0.0 : time;
+		if (index == 0)
+		{
+			function(pnt, elapsed);
+		}
+		else
+		{
+			const int code = direction(previous, pnt);
+			if (index > 1 && code != lastDirection)
+			{
+				function(previous, previousElapsed);
+			}
+			lastDirection = code;
+		}
+		previous = pnt;
+		previousElapsed = elapsed;
+		++index;
+	});
+	if (index > 1)
+	{
+		function(previous, previousElapsed);
+	}
+}
+
+template<typename RouteT>
+void RouteCodec::writePolyline(std::ostream& out, const RouteT& route, uint32_t timeDivider)
+{
+	std::streambuf& buffer = *out.rdbuf();
+	int64_t last[3] = { 0, 0, 0 };
+	forEachVertex(route, [&](const PointT& pnt, TimeT elapsed) {
+		const int64_t values[3] = { pnt.first, pnt.second, quantize(elapsed, timeDivider) };
+		for (int id = 0; id < 3; ++id)
+		{
+			writePolylineValue(buffer, values[id] - last[id]);
+			last[id] = values[id];
+		}
+	});
+}
+
+template<typename RouteT>
+void RouteCodec::writeGeoJson(std::ostream& out, const RouteT& route)
+{
+	std::streambuf& buffer = *out.rdbuf();
+	char text[64];
+	auto write = [&](const char* value) {
+		const std::streamsize size = static_cast<std::streamsize>(strlen(value));
+		if (buffer.sputn(value, size) != size)
+		{
+			throw std::runtime_error("Can't write the route");
+		}
+	};
+	write("{\"type\":\"Feature\",\"geometry\":{\"type\":\"LineString\",\"coordinates\":[");
+	bool first = true;
+	TimeT total = 0.0;
+	forEachVertex(route, [&](const PointT& pnt, TimeT elapsed) {
+		snprintf(text, sizeof(text), first ? "[%d,%d]" : ",[%d,%d]", pnt.first, pnt.second);
+		write(text);
+		first = false;
+		total = elapsed;
+	});
+	snprintf(text, sizeof(text), "]},\"properties\":{\"time\":%.3f,\"elapsed\":[", total);
+	write(text);
+	first = true;
+	forEachVertex(route, [&](const PointT&, TimeT elapsed) {
+		snprintf(text, sizeof(text), first ? "%.3f" : ",%.3f", elapsed);
+		write(text);
+		first = false;
+	});
+	write("]}}");
+}
+
+#endif // __ROUTE_CODEC_H__
@@ -0,0 +1,212 @@
+#ifndef __SPARSE_MAP_H__
+#define __SPARSE_MAP_H__
+
+#include "map_types.h"
+#include "maps.h"
+#include "static_maps.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+
+/** Map for route building that keeps only visited cells in an open addressing hash table.
+The key is a 64-bit linear index of a cell, collisions are resolved by linear probing.
+Keys of 32 bits are not enough: a 65536x65536 map has 2^32 cells, so no value is left to mark empty slots.
+Memory scales with the explored area of a query, not with the map area. So short queries touch kilobytes
+and many of them could run concurrently. Use reserve() with an estimate of explored cells before a query,
+the table grows anyway if the estimate is low.
+It has the same interface as RWMap and could be used as ArrivalMapT of RouteBuilder.
+Values are of the type of UnreachableT::value(). They are times by default, other values take less memory (e.g. bytes of moves).
+*/
+template<typename UnreachableT = NanUnreachable>
+struct SparseRWMap : public BaseMap
+{
+	static const size_t MIN_CAPACITY = 256;
+
+	using ValueT = typename std::decay<decltype(UnreachableT::value())>::type;
+
+	SparseRWMap(size_t sizeX, size_t sizeY) :
+		BaseMap(sizeX, sizeY),
+		m_count(0)
+	{
+		allocate(MIN_CAPACITY);
+	}
+
+	ValueT get(const PointT& pnt) const
+	{
+		checkBoundaries(pnt);
+		const uint64_t key = toKey(pnt);
+		for (size_t slot = hash(key); ; slot = (slot + 1) & m_mask)
+		{
+			if (m_keys[slot] == key)
+			{
+				return m_values[slot];
+			}
+			if (m_keys[slot] == EMPTY)
+			{
+				return UnreachableT::value();
+			}
+		}
+	}
+
+	void put(const PointT& pnt, const ValueT& val)
+	{
+		checkBoundaries(pnt);
+		insert(toKey(pnt), val);
+		// Load factor is kept <= 1/2. Probes are short then
+		if (2 * m_count > m_keys.size())
+		{
+			rehash(2 * m_keys.size());
+		}
+	}
+
+	/// The same neighbors and in the same order as BaseMap::getNeighbors, but without allocations
+	NeighborsList getNeighbors(const PointT& pnt) const
+	{
+		constexpr int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+		NeighborsList result;
+		for (const auto& offset : offsets)
+		{
+			const PointT neighbor(pnt.first + offset[0], pnt.second + offset[1]);
+			if (neighbor.first >= 0 && neighbor.second >= 0 &&
+				static_cast<size_t>(neighbor.first) < m_sizeX && static_cast<size_t>(neighbor.second) < m_sizeY)
+			{
+				result.push_back(neighbor);
+			}
+		}
+		return result;
+	}
+
+	/// NeighborsList doesn't allocate memory. The allocator is accepted for the same interface as RWMap
+	template<typename AllocatorT>
+	NeighborsList getNeighbors(const PointT& pnt, const AllocatorT&) const
+	{
+		return getNeighbors(pnt);
+	}
+
+	NeighborsList getReachableNeighbors(const PointT& pnt) const
+	{
+		NeighborsList result;
+		for (const auto& neighbor : getNeighbors(pnt))
+		{
+			if (!UnreachableT::isDefault(get(neighbor)))
+			{
+				result.push_back(neighbor);
+			}
+		}
+		return result;
+	}
+
+	template<typename AllocatorT>
+	NeighborsList getReachableNeighbors(const PointT& pnt, const AllocatorT&) const
+	{
+		return getReachableNeighbors(pnt);
+	}
+
+	/// Forgets all cells. Memory is kept for the next query
+	void reset()
+	{
+		std::fill(m_keys.begin(), m_keys.end(), EMPTY);
+		m_count = 0;
+	}
+
+	/// Forgets all cells and sizes the table for the expected count of cells
+	void reserve(size_t cells)
+	{
+		size_t capacity = MIN_CAPACITY;
+		while (capacity < 2 * cells)
+		{
+			capacity *= 2;
+		}
+		// A table far larger than needed is shrunk. So one long query doesn't keep memory forever
+		if (capacity > m_keys.size() || 4 * capacity < m_keys.size())
+		{
+			allocate(capacity);
+		}
+		else
+		{
+			reset();
+		}
+	}
+
+	size_t size() const { return m_count; }
+
+	size_t allocatedBytes() const { return m_keys.size() * (sizeof(uint64_t) + sizeof(ValueT)); }//statistic
+
+private:
+	static constexpr uint64_t EMPTY = 0xFFFFFFFFFFFFFFFFull;// it is not an index of a cell of any map
+
+	uint64_t toKey(const PointT& pnt) const
+	{
+		return static_cast<uint64_t>(m_sizeX) * pnt.second + pnt.first;
+	}
+
+	/// Fibonacci hashing. Neighbor cells go to distant slots
+	size_t hash(uint64_t key) const
+	{
+		return static_cast<size_t>((key * 11400714819323198485ull) >> m_shift) & m_mask;
+	}
+
+	void insert(uint64_t key, const ValueT& val)
+	{
+		for (size_t slot = hash(key); ; slot = (slot + 1) & m_mask)
+		{
+			if (m_keys[slot] == EMPTY)
+			{
+				m_keys[slot] = key;
+				m_values[slot] = val;
+				m_count += 1;
+				return;
+			}
+			if (m_keys[slot] == key)
+			{
+				m_values[slot] = val;
+				return;
+			}
+		}
+	}
+
+	void allocate(size_t capacity)
+	{
+		m_keys.assign(capacity, EMPTY);
+		m_values.assign(capacity, UnreachableT::value());
+		m_keys.shrink_to_fit();
+		m_values.shrink_to_fit();
+		m_mask = capacity - 1;
+		m_shift = 64;
+		for (size_t bits = capacity; bits > 1; bits /= 2)
+		{
+			m_shift -= 1;
+		}
+		m_count = 0;
+	}
+
+	void rehash(size_t capacity)
+	{
+		std::vector<uint64_t> keys;
+		std::vector<ValueT> values;
+		keys.swap(m_keys);
+		values.swap(m_values);
+		allocate(capacity);
+		for (size_t slot = 0; slot < keys.size(); ++slot)
+		{
+			if (keys[slot] != EMPTY)
+			{
+				insert(keys[slot], values[slot]);
+			}
+		}
+	}
+
+private:
+	std::vector<uint64_t> m_keys;// linear indexes of cells or EMPTY
+	std::vector<ValueT> m_values;
+	size_t m_count;
+	size_t m_mask;// capacity - 1, capacity is a power of 2
+	unsigned m_shift;// 64 - log2(capacity)
+};
+
+template<typename UnreachableT>
+constexpr uint64_t SparseRWMap<UnreachableT>::EMPTY;
+
+#endif // __SPARSE_MAP_H__
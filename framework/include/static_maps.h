@@ -0,0 +1,147 @@
+#ifndef __STATIC_MAPS_H__
+#define __STATIC_MAPS_H__
+
+#include "map_types.h"
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+/*! Maps with sizes and predicates known at compile time.
+They have the same interface as BaseMap and RWMap (see maps.h), but there is no std::function and no runtime sizes.
+So the compiler could inline every access and unroll the loop by 8 neighbors of a cell.
+Use them on the hot path. Use maps.h types if sizes or predicates are known at runtime only.
+*/
+
+/// Fixed capacity list of neighbors of a cell. It lives on the stack, no allocations.
+struct NeighborsList
+{
+	NeighborsList() : m_count(0) {}
+
+	void push_back(const PointT& pnt) { m_items[m_count++] = pnt; }
+
+	const PointT* begin() const { return m_items; }
+
+	const PointT* end() const { return m_items + m_count; }
+
+	size_t size() const { return m_count; }
+
+	bool empty() const { return m_count == 0; }
+
+private:
+	PointT m_items[8];
+	size_t m_count;
+};
+
+/// Time value of a not visited cell is NaN
+struct NanUnreachable
+{
+	static constexpr TimeT value() { return std::numeric_limits<TimeT>::quiet_NaN(); }
+
+	static constexpr bool isDefault(const TimeT& t) { return t != t; } // t is Nan if t != t
+};
+
+template<size_t SizeX, size_t SizeY>
+struct StaticBaseMap
+{
+	static constexpr size_t sizeX() { return SizeX; }
+
+	static constexpr size_t sizeY() { return SizeY; }
+
+	static constexpr bool isOutOfRange(const PointT& pnt)
+	{
+		return (pnt.first < 0) || (pnt.second < 0) ||
+			(static_cast<size_t>(pnt.first) >= SizeX) || (static_cast<size_t>(pnt.second) >= SizeY);
+	}
+
+	static void checkBoundaries(const PointT& pnt)
+	{
+		if (isOutOfRange(pnt))
+		{
+			throw std::out_of_range("Requested coordinate out of range");
+		}
+	}
+
+	static constexpr size_t index(const PointT& pnt)
+	{
+		return SizeX * static_cast<size_t>(pnt.second) + static_cast<size_t>(pnt.first);
+	}
+
+	/// The same neighbors and in the same order as BaseMap::getNeighbors
+	static NeighborsList getNeighbors(const PointT& pnt)
+	{
+		constexpr int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+		NeighborsList result;
+		for (const auto& offset : offsets)
+		{
+			const PointT neighbor(pnt.first + offset[0], pnt.second + offset[1]);
+			if (!isOutOfRange(neighbor))
+			{
+				result.push_back(neighbor);
+			}
+		}
+		return result;
+	}
+
+	/// NeighborsList doesn't allocate memory. The allocator is accepted for the same interface as BaseMap
+	template<typename AllocatorT>
+	static NeighborsList getNeighbors(const PointT& pnt, const AllocatorT&)
+	{
+		return getNeighbors(pnt);
+	}
+};
+
+/// Map for route building with compile-time sizes and a predicate of not visited cells
+template<size_t SizeX, size_t SizeY, typename UnreachableT = NanUnreachable>
+struct StaticRWMap : public StaticBaseMap<SizeX, SizeY>
+{
+	using BaseT = StaticBaseMap<SizeX, SizeY>;
+
+	StaticRWMap() : m_map(SizeX * SizeY, UnreachableT::value())
+	{}
+
+	/// Runtime sizes are accepted to be constructed as RWMap. They have to be the same as compile-time ones.
+	StaticRWMap(size_t sizeX, size_t sizeY) : StaticRWMap()
+	{
+		if (sizeX != SizeX || sizeY != SizeY)
+		{
+			throw std::invalid_argument("Map sizes differ from compile-time sizes");
+		}
+	}
+
+	TimeT get(const PointT& pnt) const
+	{
+		BaseT::checkBoundaries(pnt);
+		return m_map[BaseT::index(pnt)];
+	}
+
+	void put(const PointT& pnt, const TimeT& val)
+	{
+		BaseT::checkBoundaries(pnt);
+		m_map[BaseT::index(pnt)] = val;
+	}
+
+	NeighborsList getReachableNeighbors(const PointT& pnt) const
+	{
+		NeighborsList result;
+		for (const auto& neighbor : BaseT::getNeighbors(pnt))
+		{
+			if (!UnreachableT::isDefault(m_map[BaseT::index(neighbor)]))
+			{
+				result.push_back(neighbor);
+			}
+		}
+		return result;
+	}
+
+	template<typename AllocatorT>
+	NeighborsList getReachableNeighbors(const PointT& pnt, const AllocatorT&) const
+	{
+		return getReachableNeighbors(pnt);
+	}
+
+	void reset() { m_map.assign(m_map.size(), UnreachableT::value()); }
+private:
+	std::vector<TimeT, PageAllocator<TimeT>> m_map;// in huge pages, see page_memory.h
+};
+
+#endif // __STATIC_MAPS_H__
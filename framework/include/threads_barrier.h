@@ -0,0 +1,49 @@
+#ifndef __THREADS_BARRIER_H__
+#define __THREADS_BARRIER_H__
+
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+
+/*! Reusable barrier for algorithms that work by phases in a fixed set of threads.
+The last thread that arrives to the barrier runs a completion step before the others are released.
+It is a good place to reduce per-thread results into a shared state without any extra locks.
+*/
+struct ThreadsBarrier
+{
+	explicit ThreadsBarrier(size_t count) :
+		m_count(count),
+		m_arrived(0),
+		m_generation(0)
+	{}
+
+	template<typename CompletionT>
+	void wait(CompletionT onComplete)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		const size_t generation = m_generation;
+		if (++m_arrived == m_count)
+		{
+			onComplete();
+			m_arrived = 0;
+			++m_generation;
+			m_released.notify_all();
+			return;
+		}
+		m_released.wait(lock, [&]() { return generation != m_generation; });
+	}
+
+	void wait()
+	{
+		wait([]() {});
+	}
+
+private:
+	const size_t m_count;
+	size_t m_arrived;
+	size_t m_generation;
+	std::mutex m_mutex;
+	std::condition_variable m_released;
+};
+
+#endif //__THREADS_BARRIER_H__
@@ -0,0 +1,220 @@
+#ifndef __TILED_MAP_H__
+#define __TILED_MAP_H__
+
+#include "map_types.h"
+#include "maps.h"
+#include "static_maps.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+/*! Storage of a map in a file by fixed-size square tiles.
+It allows to work with maps that are far larger than memory (e.g. 65536x65536).
+
+File format (little endian):
+	TiledMapHeader
+	tiles by rows of tiles, every tile is tileDim * tileDim bytes by rows of cells.
+	Tiles on the right and bottom borders are padded by zeros up to the full size.
+*/
+#pragma pack(push,1)
+struct TiledMapHeader
+{
+	char signature[8]; // "ISLTILES"
+	uint32_t version;
+	uint32_t tileDim;
+	uint64_t sizeX;
+	uint64_t sizeY;
+};
+#pragma pack(pop)
+
+/// Cuts raw map data (sizeX * sizeY bytes by rows) into tiles and writes them to a file
+void writeTiledMap(const std::string& filename, const uint8_t* data, size_t sizeX, size_t sizeY, size_t tileDim);
+
+/** Writes a tiled map file by bands of rows, so the raw map doesn't have to be in memory.
+A band is tileDim rows of the map (the last one could be shorter), they are written from the top.
+*/
+struct TiledMapWriter
+{
+	TiledMapWriter(const std::string& filename, size_t sizeX, size_t sizeY, size_t tileDim);
+
+	/// Cuts the next band (rows * sizeX bytes by rows) into a row of tiles
+	void writeBand(const uint8_t* data, size_t rows);
+
+	/// Rows of the next band
+	size_t bandRows() const { return std::min(m_tileDim, m_sizeY - m_writtenRows); }
+
+	bool isComplete() const { return m_writtenRows == m_sizeY; }
+
+private:
+	std::ofstream m_out;
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	const size_t m_tileDim;
+	size_t m_writtenRows;
+	std::vector<uint8_t> m_tile;
+};
+
+/** Loads tiles of a tiled map file on demand and keeps the recently used ones in memory.
+The least recently used tile is dropped when the memory cap is reached.
+It is thread safe. Many searches could share one cache.
+Every thread keeps its last tile of the cache, so the mutex is taken only when a read moves to another tile.
+*/
+struct TileCache
+{
+	static const size_t DEFAULT_CACHE_BYTES = 64 * 1024 * 1024;
+
+	TileCache(const std::string& filename, size_t cacheBytes = DEFAULT_CACHE_BYTES);
+
+	uint8_t get(const PointT& pnt);
+
+	size_t sizeX() const { return m_header.sizeX; }
+
+	size_t sizeY() const { return m_header.sizeY; }
+
+	size_t tileDim() const { return m_header.tileDim; }
+
+	size_t loadedTiles() const { return m_loadedTiles; }//statistic
+
+private:
+	using TileT = std::vector<uint8_t>;
+	using LruT = std::list<size_t>;
+
+	/// Readers hold tiles by shared pointers, so an evicted tile lives while a thread reads it
+	std::shared_ptr<const TileT> tile(size_t tileId);
+
+private:
+	std::ifstream m_file;
+	TiledMapHeader m_header;
+	size_t m_tilesX;
+	size_t m_maxTiles;// memory cap in tiles
+	LruT m_lru;// the most recently used tiles are at the front
+	std::unordered_map<size_t, std::pair<std::shared_ptr<const TileT>, LruT::iterator>> m_tiles;
+	const size_t m_id;// key of the cache in last tiles of threads
+	std::atomic<size_t> m_loadedTiles;
+	std::mutex m_mutex;
+};
+
+/** Map for route building that allocates memory by tiles on the first write.
+Memory scales with the explored area of the map, not with the map area.
+It has the same interface as RWMap and could be used as ArrivalMapT of RouteBuilder.
+Values are of the type of UnreachableT::value() as in SparseRWMap.
+*/
+template<typename UnreachableT = NanUnreachable>
+struct TiledRWMap : public BaseMap
+{
+	static const size_t TILE_DIM = 64; // 32 KB of times per tile
+
+	using ValueT = typename std::decay<decltype(UnreachableT::value())>::type;
+
+	TiledRWMap(size_t sizeX, size_t sizeY) :
+		BaseMap(sizeX, sizeY),
+		m_tilesX((sizeX + TILE_DIM - 1) / TILE_DIM),
+		m_tiles(m_tilesX * ((sizeY + TILE_DIM - 1) / TILE_DIM))
+	{}
+
+	ValueT get(const PointT& pnt) const
+	{
+		checkBoundaries(pnt);
+		const auto& tile = m_tiles[tileId(pnt)];
+		if (!tile)
+		{
+			return UnreachableT::value();
+		}
+		return tile[cellId(pnt)];
+	}
+
+	void put(const PointT& pnt, const ValueT& val)
+	{
+		checkBoundaries(pnt);
+		auto& tile = m_tiles[tileId(pnt)];
+		if (!tile)
+		{
+			tile.reset(new ValueT[TILE_DIM * TILE_DIM]);
+			std::fill(tile.get(), tile.get() + TILE_DIM * TILE_DIM, UnreachableT::value());
+			m_usedTiles.push_back(tileId(pnt));
+		}
+		tile[cellId(pnt)] = val;
+	}
+
+	/// The same neighbors and in the same order as BaseMap::getNeighbors, but without allocations
+	NeighborsList getNeighbors(const PointT& pnt) const
+	{
+		constexpr int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+		NeighborsList result;
+		for (const auto& offset : offsets)
+		{
+			const PointT neighbor(pnt.first + offset[0], pnt.second + offset[1]);
+			if (neighbor.first >= 0 && neighbor.second >= 0 &&
+				static_cast<size_t>(neighbor.first) < m_sizeX && static_cast<size_t>(neighbor.second) < m_sizeY)
+			{
+				result.push_back(neighbor);
+			}
+		}
+		return result;
+	}
+
+	/// NeighborsList doesn't allocate memory. The allocator is accepted for the same interface as RWMap
+	template<typename AllocatorT>
+	NeighborsList getNeighbors(const PointT& pnt, const AllocatorT&) const
+	{
+		return getNeighbors(pnt);
+	}
+
+	NeighborsList getReachableNeighbors(const PointT& pnt) const
+	{
+		NeighborsList result;
+		for (const auto& neighbor : getNeighbors(pnt))
+		{
+			if (!UnreachableT::isDefault(get(neighbor)))
+			{
+				result.push_back(neighbor);
+			}
+		}
+		return result;
+	}
+
+	template<typename AllocatorT>
+	NeighborsList getReachableNeighbors(const PointT& pnt, const AllocatorT&) const
+	{
+		return getReachableNeighbors(pnt);
+	}
+
+	/// Releases all tiles
+	void reset()
+	{
+		for (auto id : m_usedTiles)
+		{
+			m_tiles[id].reset();
+		}
+		m_usedTiles.clear();
+	}
+
+	size_t allocatedBytes() const { return m_usedTiles.size() * TILE_DIM * TILE_DIM * sizeof(ValueT); }//statistic
+
+private:
+	size_t tileId(const PointT& pnt) const
+	{
+		return (pnt.second / TILE_DIM) * m_tilesX + pnt.first / TILE_DIM;
+	}
+
+	static size_t cellId(const PointT& pnt)
+	{
+		return (pnt.second % TILE_DIM) * TILE_DIM + pnt.first % TILE_DIM;
+	}
+
+private:
+	const size_t m_tilesX;
+	std::vector<std::unique_ptr<ValueT[]>> m_tiles;
+	std::vector<size_t> m_usedTiles;
+};
+
+#endif // __TILED_MAP_H__
@@ -0,0 +1,212 @@
+#include "island_pack.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const char PACK_SIGNATURE[8] = { 'I', 'S', 'L', 'E', 'P', 'A', 'C', 'K' };
+
+size_t alignToPage(size_t size)
+{
+	return (size + PACK_PAGE_SIZE - 1) / PACK_PAGE_SIZE * PACK_PAGE_SIZE;
+}
+
+uint64_t headerChecksum(PackHeader header, const std::vector<PackSection>& sections)
+{
+	header.checksum = 0;
+	auto hash = packChecksum(&header, sizeof(header));
+	return sections.empty() ? hash : packChecksum(&sections[0], sections.size() * sizeof(PackSection), hash);
+}
+}
+
+uint64_t packChecksum(const void* data, size_t size, uint64_t hash)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+std::shared_ptr<const IslandPack> IslandPack::open(const std::string& filename)
+{
+	std::shared_ptr<IslandPack> pack(new IslandPack());
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Can't open island pack");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(PackHeader)))
+	{
+		::close(fd);
+		throw std::runtime_error("Wrong size of island pack");
+	}
+	void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		throw std::runtime_error("Can't map island pack into memory");
+	}
+	pack->m_data = static_cast<const uint8_t*>(mapped);
+	pack->m_size = info.st_size;
+#else
+	std::ifstream in(filename, std::ifstream::ate | std::ifstream::binary);
+	if (!in.good())
+	{
+		throw std::runtime_error("Can't open island pack");
+	}
+	pack->m_buffer.resize(static_cast<size_t>(in.tellg()));
+	in.seekg(0);
+	in.read((char*)&pack->m_buffer[0], pack->m_buffer.size());
+	if (!in.good() || pack->m_buffer.size() < sizeof(PackHeader))
+	{
+		throw std::runtime_error("Can't read island pack");
+	}
+	pack->m_data = &pack->m_buffer[0];
+	pack->m_size = pack->m_buffer.size();
+#endif
+
+	memcpy(&pack->m_header, pack->m_data, sizeof(PackHeader));
+	const auto& header = pack->m_header;
+	if (memcmp(header.signature, PACK_SIGNATURE, sizeof(PACK_SIGNATURE)) != 0)
+	{
+		throw std::runtime_error("It is not an island pack");
+	}
+	if (header.version != PACK_VERSION)
+	{
+		throw std::runtime_error("Unsupported version of island pack");
+	}
+	if (sizeof(PackHeader) + header.sectionsCount * sizeof(PackSection) > pack->m_size)
+	{
+		throw std::runtime_error("Island pack is truncated");
+	}
+	pack->m_sections.resize(header.sectionsCount);
+	if (header.sectionsCount)
+	{
+		memcpy(&pack->m_sections[0], pack->m_data + sizeof(PackHeader), header.sectionsCount * sizeof(PackSection));
+	}
+	if (headerChecksum(header, pack->m_sections) != header.checksum)
+	{
+		throw std::runtime_error("Island pack header is corrupted");
+	}
+	for (const auto& section : pack->m_sections)
+	{
+		if (section.offset % PACK_PAGE_SIZE != 0 || section.offset + section.size > pack->m_size)
+		{
+			throw std::runtime_error("Island pack section is out of file");
+		}
+	}
+	return pack;
+}
+
+IslandPack::~IslandPack()
+{
+#ifndef _WIN32
+	if (m_data)
+	{
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+#endif
+}
+
+const uint8_t* IslandPack::section(uint32_t type, size_t& size) const
+{
+	for (const auto& section : m_sections)
+	{
+		if (section.type == type)
+		{
+			size = section.size;
+			return m_data + section.offset;
+		}
+	}
+	size = 0;
+	return nullptr;
+}
+
+bool IslandPack::verify(std::string& error) const
+{
+	for (const auto& section : m_sections)
+	{
+		if (packChecksum(m_data + section.offset, section.size) != section.checksum)
+		{
+			error = "Checksum mismatch in section of type " + std::to_string(section.type);
+			return false;
+		}
+	}
+	return true;
+}
+
+void IslandPackWriter::add(uint32_t type, const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	m_sections.push_back(std::make_pair(type, std::vector<uint8_t>(bytes, bytes + size)));
+}
+
+void IslandPackWriter::write(const std::string& filename) const
+{
+	PackHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, PACK_SIGNATURE, sizeof(header.signature));
+	header.version = PACK_VERSION;
+	header.sectionsCount = static_cast<uint32_t>(m_sections.size());
+	header.sizeX = m_sizeX;
+	header.sizeY = m_sizeY;
+
+	std::vector<PackSection> table;
+	size_t offset = alignToPage(sizeof(PackHeader) + m_sections.size() * sizeof(PackSection));
+	for (const auto& section : m_sections)
+	{
+		PackSection entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.type = section.first;
+		entry.offset = offset;
+		entry.size = section.second.size();
+		entry.checksum = packChecksum(section.second.data(), section.second.size());
+		table.push_back(entry);
+		offset = alignToPage(offset + entry.size);
+	}
+	header.checksum = headerChecksum(header, table);
+
+	std::ofstream out(filename, std::ofstream::binary);
+	if (!out.good())
+	{
+		throw std::runtime_error("Can't create island pack");
+	}
+	std::vector<uint8_t> page(alignToPage(sizeof(PackHeader) + table.size() * sizeof(PackSection)), 0);
+	memcpy(&page[0], &header, sizeof(header));
+	if (!table.empty())
+	{
+		memcpy(&page[sizeof(header)], &table[0], table.size() * sizeof(PackSection));
+	}
+	out.write((const char*)&page[0], page.size());
+	for (const auto& section : m_sections)
+	{
+		const size_t size = section.second.size();
+		if (size)
+		{
+			out.write((const char*)section.second.data(), size);
+		}
+		const std::vector<char> filler(alignToPage(size) - size, 0);
+		if (!filler.empty())
+		{
+			out.write(&filler[0], filler.size());
+		}
+	}
+	if (!out.good())
+	{
+		throw std::runtime_error("Can't write island pack");
+	}
+}
@@ -1,5 +1,7 @@
 #include "maps.h"
+#include "tiled_map.h"
 #include <algorithm>
+#include <stdexcept>
 
 void BaseMap::checkBoundaries(const PointT& pnt) const
 {
@@ -11,49 +13,30 @@ void BaseMap::checkBoundaries(const PointT& pnt) const
 
 }
 
-std::list<PointT> BaseMap::getNeighbors(const PointT& pnt) const
+MapExplorer::MapExplorer(std::shared_ptr<TileCache> tiles) :
+	BaseMap(tiles->sizeX(), tiles->sizeY()),
+	m_data(nullptr),
+	m_tiles(tiles)
 {
-	bool hasLowerNodes = (pnt.second > 0);
-	bool hasLeftNodes = (pnt.first > 0);
-	bool hasUpperNodes = (pnt.second < m_sizeY - 1);
-	bool hasRightNodes = (pnt.first < m_sizeY - 1);
-	std::list<PointT> result;
-	if (hasLeftNodes)
-	{
-		if (hasLowerNodes)
-		{
-			result.push_back(std::make_pair(pnt.first - 1, pnt.second - 1));
-		}
-		result.push_back(std::make_pair(pnt.first - 1, pnt.second));
-		if (hasUpperNodes)
-		{
-			result.push_back(std::make_pair(pnt.first - 1, pnt.second + 1));
-		}
-	}
+}
 
-	if (hasRightNodes)
+const uint8_t* MapExplorer::rawData() const
+{
+	if (!m_data)
 	{
-		if (hasLowerNodes)
-		{
-			result.push_back(std::make_pair(pnt.first + 1, pnt.second - 1));
-		}
-		result.push_back(std::make_pair(pnt.first + 1, pnt.second));
-		if (hasUpperNodes)
-		{
-			result.push_back(std::make_pair(pnt.first + 1, pnt.second + 1));
-		}
+		throw std::logic_error("Tiled map has no raw data in memory");
 	}
+	return m_data;
+}
 
-	if (hasLowerNodes)
-	{
-		result.push_back(std::make_pair(pnt.first, pnt.second - 1));
-	}
-	if (hasUpperNodes)
-	{
-		result.push_back(std::make_pair(pnt.first, pnt.second + 1));
-	}
-	return result;
+uint8_t MapExplorer::getTiled(const PointT& pnt) const
+{
+	return m_tiles->get(pnt);
+}
 
+std::list<PointT> BaseMap::getNeighbors(const PointT& pnt) const
+{
+	return getNeighbors(pnt, std::allocator<PointT>());
 }
 
 std::list<PointT> RWMap::getReachableNeighbors(PointT& pnt) const
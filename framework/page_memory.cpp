@@ -0,0 +1,168 @@
+#include "page_memory.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+size_t roundToHugePages(size_t bytes)
+{
+	return (std::max<size_t>(bytes, 1) + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+}
+
+/// Parses lists of sysfs like "0-3,8,10-11"
+std::vector<int> readList(const std::string& filename)
+{
+	std::vector<int> result;
+	std::ifstream in(filename);
+	std::string text;
+	if (!std::getline(in, text))
+	{
+		return result;
+	}
+	std::stringstream items(text);
+	std::string item;
+	while (std::getline(items, item, ','))
+	{
+		const auto dash = item.find('-');
+		try
+		{
+			const int first = std::stoi(item.substr(0, dash));
+			const int last = (dash == std::string::npos) ? first : std::stoi(item.substr(dash + 1));
+			for (int id = first; id <= last; ++id)
+			{
+				result.push_back(id);
+			}
+		}
+		catch (const std::exception&)
+		{
+			return std::vector<int>();
+		}
+	}
+	return result;
+}
+
+#ifdef __linux__
+void bindToNode(void* pointer, size_t bytes, int node)
+{
+	const size_t BITS = 8 * sizeof(unsigned long);
+	if (node < 0 || static_cast<size_t>(node) >= 64 * BITS)
+	{
+		return;
+	}
+	std::vector<unsigned long> mask(node / BITS + 1, 0);
+	mask[node / BITS] = 1UL << (node % BITS);
+	// It is a hint. Memory is taken from another node if the node is full
+	syscall(SYS_mbind, pointer, bytes, MPOL_PREFERRED, &mask[0], mask.size() * BITS + 1, 0);
+}
+#endif
+}
+
+void* allocatePages(size_t bytes, PagePolicy policy, int node, PagePolicy* granted)
+{
+	const size_t size = roundToHugePages(bytes);
+#ifdef __linux__
+	void* result = MAP_FAILED;
+	PagePolicy applied = policy;
+#ifdef MAP_HUGETLB
+	if (policy == PP_EXPLICIT)
+	{
+		result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (result == MAP_FAILED)
+	{
+		applied = (policy == PP_REGULAR) ? PP_REGULAR : PP_TRANSPARENT;
+		result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (result == MAP_FAILED)
+		{
+			throw std::bad_alloc();
+		}
+#ifdef MADV_HUGEPAGE
+		if (applied == PP_TRANSPARENT && madvise(result, size, MADV_HUGEPAGE) != 0)
+		{
+			applied = PP_REGULAR;
+		}
+#else
+		applied = PP_REGULAR;
+#endif
+	}
+	if (node != ANY_NODE)
+	{
+		// Before the first touch. Pages are placed on the first touch
+		bindToNode(result, size, node);
+	}
+	if (granted)
+	{
+		*granted = applied;
+	}
+	return result;
+#else
+	(void)node;
+	if (granted)
+	{
+		*granted = PP_REGULAR;
+	}
+	return ::operator new(size);
+#endif
+}
+
+void freePages(void* pointer, size_t bytes)
+{
+	if (!pointer)
+	{
+		return;
+	}
+#ifdef __linux__
+	munmap(pointer, roundToHugePages(bytes));
+#else
+	(void)bytes;
+	::operator delete(pointer);
+#endif
+}
+
+std::vector<int> NumaTopology::nodes()
+{
+	auto result = readList("/sys/devices/system/node/online");
+	if (result.empty())
+	{
+		result.push_back(0);
+	}
+	return result;
+}
+
+bool NumaTopology::bindThread(int node)
+{
+#ifdef __linux__
+	const auto cpus = readList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+	if (cpus.empty())
+	{
+		return false;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu : cpus)
+	{
+		if (cpu < CPU_SETSIZE)
+		{
+			CPU_SET(cpu, &set);
+		}
+	}
+	// 0 is the calling thread
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+	(void)node;
+	return false;
+#endif
+}
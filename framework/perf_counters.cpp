@@ -0,0 +1,122 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef __linux__
+struct EventConfig
+{
+	uint32_t type;
+	uint64_t config;
+};
+
+EventConfig eventConfig(PerfEvent event)
+{
+	const uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	switch (event)
+	{
+	case PE_CYCLES:
+		return EventConfig{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES };
+	case PE_INSTRUCTIONS:
+		return EventConfig{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS };
+	case PE_L1D_MISSES:
+		return EventConfig{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | readMiss };
+	case PE_LLC_MISSES:
+		return EventConfig{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES };
+	case PE_DTLB_MISSES:
+		return EventConfig{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | readMiss };
+	default:
+		return EventConfig{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES };
+	}
+}
+
+/// Counter of the calling thread on any CPU. Kernel and hypervisor are excluded, it works with perf_event_paranoid 2
+int openEvent(PerfEvent event)
+{
+	const EventConfig config = eventConfig(event);
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = config.type;
+	attr.config = config.config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+}
+
+const char* PerfCounts::name(PerfEvent event)
+{
+	static const char* names[PE_COUNT] = { "cycles", "instructions", "L1d misses", "LLC misses", "dTLB misses", "branch misses" };
+	return (event < PE_COUNT) ? names[event] : "unknown";
+}
+
+PerfCounters& PerfCounters::thread()
+{
+	thread_local PerfCounters counters;
+	return counters;
+}
+
+PerfCounters::PerfCounters() : m_mask(0)
+{
+	for (int event = 0; event < PE_COUNT; ++event)
+	{
+		m_descriptors[event] = -1;
+#ifdef __linux__
+		m_descriptors[event] = openEvent(static_cast<PerfEvent>(event));
+		if (m_descriptors[event] >= 0)
+		{
+			m_mask |= 1u << event;
+			continue;
+		}
+		const int error = errno;
+		m_error += (m_error.empty() ? "" : ", ") + std::string(PerfCounts::name(static_cast<PerfEvent>(event))) + ": " + strerror(error);
+#endif
+	}
+#ifndef __linux__
+	m_error = "perf events are not supported on the platform";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	for (int event = 0; event < PE_COUNT; ++event)
+	{
+		if (m_descriptors[event] >= 0)
+		{
+			close(m_descriptors[event]);
+		}
+	}
+#endif
+}
+
+PerfCounts PerfCounters::read() const
+{
+	PerfCounts result;
+#ifdef __linux__
+	for (int event = 0; event < PE_COUNT; ++event)
+	{
+		uint64_t data[3] = { 0, 0, 0 };// value, time enabled, time running
+		if (m_descriptors[event] < 0 || ::read(m_descriptors[event], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)))
+		{
+			continue;
+		}
+		result.mask |= 1u << event;
+		// Multiplexed events are counted a part of time
+		result.values[event] = (data[2] && data[2] < data[1]) ?
+			static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]) : data[0];
+	}
+#endif
+	return result;
+}
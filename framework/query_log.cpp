@@ -0,0 +1,68 @@
+#include "query_log.h"
+
+#include <stdexcept>
+#include <string.h>
+
+namespace
+{
+const char LOG_SIGNATURE[8] = { 'I', 'S', 'L', 'E', 'Q', 'L', 'O', 'G' };
+}
+
+QueryLogWriter::QueryLogWriter(const std::string& filename, uint64_t mapChecksum, size_t sizeX, size_t sizeY) :
+	m_out(filename, std::ofstream::binary)
+{
+	if (!m_out.good())
+	{
+		throw std::runtime_error("Can't create query log");
+	}
+	QueryLogHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, LOG_SIGNATURE, sizeof(header.signature));
+	header.version = QUERY_LOG_VERSION;
+	header.mapChecksum = mapChecksum;
+	header.sizeX = sizeX;
+	header.sizeY = sizeY;
+	m_out.write((const char*)&header, sizeof(header));
+	m_out.flush();
+	if (!m_out.good())
+	{
+		throw std::runtime_error("Can't write query log");
+	}
+}
+
+void QueryLogWriter::append(const QueryRecord& record)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_out.write((const char*)&record, sizeof(record));
+}
+
+void QueryLogWriter::flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_out.flush();
+}
+
+QueryLog QueryLog::read(const std::string& filename)
+{
+	std::ifstream in(filename, std::ifstream::binary);
+	if (!in.good())
+	{
+		throw std::runtime_error("Can't open query log");
+	}
+	QueryLog log;
+	in.read((char*)&log.header, sizeof(log.header));
+	if (!in.good() || memcmp(log.header.signature, LOG_SIGNATURE, sizeof(LOG_SIGNATURE)) != 0)
+	{
+		throw std::runtime_error("It is not a query log");
+	}
+	if (log.header.version != QUERY_LOG_VERSION)
+	{
+		throw std::runtime_error("Unsupported version of query log: " + std::to_string(log.header.version));
+	}
+	QueryRecord record;
+	while (in.read((char*)&record, sizeof(record)))
+	{
+		log.records.push_back(record);
+	}
+	return log;
+}
@@ -0,0 +1,71 @@
+#include "route_codec.h"
+
+namespace
+{
+uint64_t readVarint(std::istream& in)
+{
+	uint64_t result = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		const int value = in.get();
+		if (value == std::char_traits<char>::eof())
+		{
+			throw std::runtime_error("Route is cut");
+		}
+		result |= static_cast<uint64_t>(value & 0x7F) << shift;
+		if (!(value & 0x80))
+		{
+			return result;
+		}
+	}
+	throw std::runtime_error("Wrong varint in the route");
+}
+
+int64_t unzigzag(uint64_t value)
+{
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+}
+
+RouteSteps RouteCodec::readBinary(std::istream& in)
+{
+	if (readVarint(in) != VERSION)
+	{
+		throw std::runtime_error("Unsupported version of the route");
+	}
+	const uint64_t moves = readVarint(in);
+	const uint64_t startX = readVarint(in);
+	const uint64_t startY = readVarint(in);
+	const uint64_t timeDivider = readVarint(in);
+	if (timeDivider == 0 || startX > 0x7FFFFFFF || startY > 0x7FFFFFFF)
+	{
+		throw std::runtime_error("Wrong header of the route");
+	}
+	std::vector<uint8_t> directions((moves * 3 + 7) / 8);
+	if (!directions.empty() && !in.read(reinterpret_cast<char*>(&directions[0]), directions.size()))
+	{
+		throw std::runtime_error("Route is cut");
+	}
+
+	RouteSteps result;
+	result.steps.reserve(moves + 1);
+	PointT pnt(static_cast<int>(startX), static_cast<int>(startY));
+	result.steps.push_back(RouteStep{ pnt, 0.0 });
+	int64_t quantized = 0;
+	int64_t lastMove = 0;
+	for (uint64_t id = 0; id < moves; ++id)
+	{
+		const size_t bit = id * 3;
+		const uint32_t bits = directions[bit / 8] | ((bit / 8 + 1 < directions.size()) ? (directions[bit / 8 + 1] << 8) : 0);
+		const uint8_t code = static_cast<uint8_t>((bits >> (bit % 8)) & 0x7);
+		pnt = PointT(pnt.first + offset(code)[0], pnt.second + offset(code)[1]);
+
+		const int64_t move = lastMove + unzigzag(readVarint(in));
+		// Times of moves are differences of quantized elapsed times
+		const TimeT time = static_cast<TimeT>(quantized + move) / timeDivider - static_cast<TimeT>(quantized) / timeDivider;
+		quantized += move;
+		lastMove = move;
+		result.steps.push_back(RouteStep{ pnt, time });
+	}
+	return result;
+}
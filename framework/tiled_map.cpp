@@ -0,0 +1,161 @@
+#include "tiled_map.h"
+#include <stdexcept>
+#include <string.h>
+
+namespace
+{
+const char TILED_MAP_SIGNATURE[8] = { 'I', 'S', 'L', 'T', 'I', 'L', 'E', 'S' };
+const uint32_t TILED_MAP_VERSION = 1;
+
+std::atomic<size_t> s_lastCacheId(0);
+
+/// The last tile that a thread has read from a cache. Neighbor cells are mostly in the same tile
+struct LastTile
+{
+	size_t cacheId = 0;
+	size_t tileId = 0;
+	std::shared_ptr<const std::vector<uint8_t>> tile;
+};
+
+/// Slots of last tiles of a thread by ids of caches. A collision of caches only costs a lookup under the mutex
+const size_t LAST_TILES = 8;
+}
+
+void writeTiledMap(const std::string& filename, const uint8_t* data, size_t sizeX, size_t sizeY, size_t tileDim)
+{
+	TiledMapWriter writer(filename, sizeX, sizeY, tileDim);
+	while (!writer.isComplete())
+	{
+		const size_t rows = writer.bandRows();
+		writer.writeBand(data, rows);
+		data += rows * sizeX;
+	}
+}
+
+TiledMapWriter::TiledMapWriter(const std::string& filename, size_t sizeX, size_t sizeY, size_t tileDim) :
+	m_sizeX(sizeX),
+	m_sizeY(sizeY),
+	m_tileDim(tileDim),
+	m_writtenRows(0),
+	m_tile(tileDim * tileDim)
+{
+	if (tileDim == 0)
+	{
+		throw std::invalid_argument("Tile size should be > 0");
+	}
+	m_out.open(filename, std::ofstream::binary);
+	if (!m_out.good())
+	{
+		throw std::runtime_error("Can't create tiled map file");
+	}
+	TiledMapHeader header;
+	memcpy(header.signature, TILED_MAP_SIGNATURE, sizeof(header.signature));
+	header.version = TILED_MAP_VERSION;
+	header.tileDim = static_cast<uint32_t>(tileDim);
+	header.sizeX = sizeX;
+	header.sizeY = sizeY;
+	m_out.write((const char*)&header, sizeof(header));
+}
+
+void TiledMapWriter::writeBand(const uint8_t* data, size_t rows)
+{
+	if (rows != bandRows())
+	{
+		throw std::invalid_argument("Band should have tile size rows or the rest of the map");
+	}
+	for (size_t tileX = 0; tileX < m_sizeX; tileX += m_tileDim)
+	{
+		std::fill(m_tile.begin(), m_tile.end(), 0);
+		const size_t width = std::min(m_tileDim, m_sizeX - tileX);
+		for (size_t y = 0; y < rows; ++y)
+		{
+			memcpy(&m_tile[y * m_tileDim], data + y * m_sizeX + tileX, width);
+		}
+		m_out.write((const char*)&m_tile[0], m_tile.size());
+	}
+	m_writtenRows += rows;
+	if (!m_out.good())
+	{
+		throw std::runtime_error("Can't write tiled map file");
+	}
+}
+
+TileCache::TileCache(const std::string& filename, size_t cacheBytes) :
+	m_file(filename, std::ifstream::binary),
+	m_id(++s_lastCacheId),
+	m_loadedTiles(0)
+{
+	if (!m_file.good())
+	{
+		throw std::runtime_error("Can't open tiled map file");
+	}
+	m_file.read((char*)&m_header, sizeof(m_header));
+	if (!m_file.good() || memcmp(m_header.signature, TILED_MAP_SIGNATURE, sizeof(TILED_MAP_SIGNATURE)) != 0)
+	{
+		throw std::runtime_error("It is not a tiled map file");
+	}
+	if (m_header.version != TILED_MAP_VERSION)
+	{
+		throw std::runtime_error("Unsupported version of tiled map file");
+	}
+	if (m_header.tileDim == 0)
+	{
+		throw std::runtime_error("Wrong tile size in tiled map file");
+	}
+	m_tilesX = (m_header.sizeX + m_header.tileDim - 1) / m_header.tileDim;
+	const size_t tileBytes = static_cast<size_t>(m_header.tileDim) * m_header.tileDim;
+	m_maxTiles = std::max<size_t>(1, cacheBytes / tileBytes);
+}
+
+uint8_t TileCache::get(const PointT& pnt)
+{
+	if (pnt.first < 0 || pnt.second < 0 ||
+		static_cast<size_t>(pnt.first) >= m_header.sizeX || static_cast<size_t>(pnt.second) >= m_header.sizeY)
+	{
+		throw std::out_of_range("Requested coordinate out of range");
+	}
+	const size_t tileDim = m_header.tileDim;
+	const size_t tileId = (pnt.second / tileDim) * m_tilesX + pnt.first / tileDim;
+	thread_local LastTile lastTiles[LAST_TILES];
+	LastTile& last = lastTiles[m_id % LAST_TILES];
+	if (last.cacheId != m_id || last.tileId != tileId || !last.tile)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		last.tile = tile(tileId);
+		last.cacheId = m_id;
+		last.tileId = tileId;
+	}
+	return (*last.tile)[(pnt.second % tileDim) * tileDim + pnt.first % tileDim];
+}
+
+std::shared_ptr<const TileCache::TileT> TileCache::tile(size_t tileId)
+{
+	auto found = m_tiles.find(tileId);
+	if (found != m_tiles.end())
+	{
+		// Move to the front of LRU list
+		m_lru.splice(m_lru.begin(), m_lru, found->second.second);
+		return found->second.first;
+	}
+
+	if (m_tiles.size() >= m_maxTiles)
+	{
+		m_tiles.erase(m_lru.back());
+		m_lru.pop_back();
+	}
+	const size_t tileBytes = static_cast<size_t>(m_header.tileDim) * m_header.tileDim;
+	auto data = std::make_shared<TileT>(tileBytes);
+	m_file.clear();
+	m_file.seekg(sizeof(TiledMapHeader) + tileId * tileBytes);
+	m_file.read((char*)&(*data)[0], tileBytes);
+	if (!m_file.good())
+	{
+		throw std::runtime_error("Can't read tile from tiled map file");
+	}
+	m_loadedTiles += 1;
+	m_lru.push_front(tileId);
+	auto& inserted = m_tiles[tileId];
+	inserted.first = data;
+	inserted.second = m_lru.begin();
+	return inserted.first;
+}
@@ -4,6 +4,7 @@
 
 #include <map_types.h>
 #include <prioritized_queue.h>
+#include <query_log.h>
 #include <time_prediction.h>
 #include <string>
 #include <exception>
@@ -19,6 +20,7 @@ enum {
 };
 
 
+/// Usage: Bachelor [--query-log <file>]
 int main(int argc, char** argv)
 {
 	try
@@ -34,9 +36,14 @@ int main(int argc, char** argv)
 
 		// RouteBuilder could be a Controller in MVC architecture
 		//Can coordinate and do commands
-		RouteBuilder<EvaluationStategy, PrioritizedQueue<TimeT, MeasuredPointT>> router(model, viewer,
+		RouteBuilder<EvaluationStategy, ArenaPrioritizedQueue<TimeT, MeasuredPointT>> router(model, viewer,
 																			//elevation, overrides,  //Maps 
 																			std::make_pair(ROVER_X, ROVER_Y)); //Start point
+		// Capture of queries for replay by tools/route_replay.cpp
+		if (argc > 2 && std::string(argv[1]) == "--query-log")
+		{
+			router.setQueryLog(std::make_shared<QueryLogWriter>(argv[2], model.checksum(), model.getSizeX(), model.getSizeY()));
+		}
 		//Drive to me
 		if (!router.moveTo(std::make_pair(BACHELOR_X, BACHELOR_Y)))
 		{
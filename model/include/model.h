@@ -3,14 +3,23 @@
 
 #include <map_types.h>
 #include <maps.h>
+#include <tiled_map.h>
+#include <island_pack.h>
 #include <time_prediction.h>
+#include <components.h>
+#include <page_memory.h>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <vector>
 #include <exception>
+#include <stdexcept>
 #include <cstdio>
 #include <memory>
+#include <mutex>
+#include <string.h>
 
 #ifdef _MSC_VER
 static const char* PATH_SEP = "\\";
@@ -18,6 +27,13 @@ static const char* PATH_SEP = "\\";
 static const char* PATH_SEP = "/";
 #endif
 
+/// New value of overrides of the cell (see OverrideFlags)
+struct OverrideEdit
+{
+	PointT pnt;
+	uint8_t value;
+};
+
 /*!
 This class implements logic of extract maps from source files and bring access data.
 
@@ -25,32 +41,69 @@ This class implements logic of extract maps from source files and bring access d
 */
 struct MapsModel
 {
-	static const size_t IMAGE_DIM; // Width and height of the elevation and overrides image
+	static constexpr size_t IMAGE_DIM = 2048; // Width and height of the elevation and overrides image
 
-	MapsModel(const std::string& pname)
+	/// Where maps are taken from by the application
+	enum AssetsSource
+	{
+		AS_AUTO,    ///< assets/island.pack if it exists, otherwise raw assets
+		AS_RAW      ///< raw assets/*.data files only
+	};
+
+	/// Maps of raw assets are loaded into pages by the policy (see page_memory.h). Maps of the pack are used in place
+	MapsModel(const std::string& pname, AssetsSource source = AS_AUTO, PagePolicy pages = PP_TRANSPARENT) :
+		m_sizeX(IMAGE_DIM),
+		m_sizeY(IMAGE_DIM),
+		m_pages(pages),
+		m_version(0)
 	{
-		//Initialization. 
-		const size_t expectedFileSize = getSizeX() * getSizeY();
 		// Address assets relative to application location
-		std::string anchor = std::string(".") + PATH_SEP;
-		auto lastpos = pname.find_last_of("/\\");
-		if (lastpos != std::string::npos)
+		const std::string assets = assetsDir(pname);
+		if (source == AS_AUTO && std::ifstream(assets + "island.pack").good())
 		{
-			anchor = pname.substr(0, lastpos) + PATH_SEP;
+			loadPack(IslandPack::open(assets + "island.pack"));
+			return;
 		}
+		//Initialization. 
+		const size_t expectedFileSize = getSizeX() * getSizeY();
 		//Create maps
-		m_elevation.reset(new  MapExplorer(
-			loadFile(anchor + "assets" + PATH_SEP + "elevation.data", expectedFileSize),
-			getSizeX(), getSizeY()));
+		auto elevation = loadFile(assets + "elevation.data", expectedFileSize);
+		m_elevation.reset(new MapExplorer(elevation->data(), getSizeX(), getSizeY(), elevation));
 
-		m_overrides.reset(new  MapExplorer(
-			loadFile(anchor + "assets" + PATH_SEP + "overrides.data", expectedFileSize),
-			getSizeX(), getSizeY()));
+		auto overrides = loadFile(assets + "overrides.data", expectedFileSize);
+		m_overrides.reset(new MapExplorer(overrides->data(), getSizeX(), getSizeY(), overrides));
 	}
 
-	size_t getSizeX() const { return IMAGE_DIM; };
+	/// Maps are in the island pack (see island_pack.h). They are used in place, without copy.
+	explicit MapsModel(std::shared_ptr<const IslandPack> pack) :
+		m_pages(PP_REGULAR),
+		m_version(0)
+	{
+		loadPack(pack);
+	}
 
-	size_t getSizeY() const { return IMAGE_DIM; };
+	/** Maps are in tiled map files (see tiled_map.h). Tiles are loaded on demand.
+		\param cacheBytes memory cap of loaded tiles for every of maps.
+	*/
+	MapsModel(const std::string& elevationTiles, const std::string& overridesTiles, size_t cacheBytes = TileCache::DEFAULT_CACHE_BYTES) :
+		m_pages(PP_REGULAR),
+		m_version(0)
+	{
+		auto elevation = std::make_shared<TileCache>(elevationTiles, cacheBytes);
+		auto overrides = std::make_shared<TileCache>(overridesTiles, cacheBytes);
+		if (elevation->sizeX() != overrides->sizeX() || elevation->sizeY() != overrides->sizeY())
+		{
+			throw std::runtime_error("Sizes of elevation and overrides maps differ");
+		}
+		m_sizeX = elevation->sizeX();
+		m_sizeY = elevation->sizeY();
+		m_elevation.reset(new MapExplorer(elevation));
+		m_overrides.reset(new MapExplorer(overrides));
+	}
+
+	size_t getSizeX() const { return m_sizeX; };
+
+	size_t getSizeY() const { return m_sizeY; };
 
 	const MapExplorer& elevation() const { return *m_elevation.get(); }
 
@@ -58,40 +111,260 @@ struct MapsModel
 
 
 	const MapExplorer& overrides() const { return *m_overrides.get(); }
+
+	/// \return island pack with preprocessed data or nullptr if maps are not from a pack
+	const IslandPack* pack() const { return m_pack.get(); }
+
+	/// Components are not built for tiled maps: labels of every cell of a map larger than memory don't fit into it either
+	bool hasComponents() const { return !m_elevation->isTiled(); }
+
+	/// Connected components of drivable cells by EvaluationStategy.
+	/// They are taken from the island pack or calculated on the first call. See hasComponents()
+	/// Components of a pack are not used if the pack was built with other move times of the rover
+	const ConnectedComponents& components() const
+	{
+		if (!hasComponents())
+		{
+			throw std::logic_error("Components of tiled maps are not built");
+		}
+		std::call_once(m_componentsFlag, [this]() {
+			size_t size = 0;
+			const uint8_t* data = (m_pack && hasPackMoveTimes()) ? m_pack->section(PS_COMPONENTS, size) : nullptr;
+			if (data)
+			{
+				m_components = ConnectedComponents::load(data, size, m_sizeX, m_sizeY, m_pack);
+			}
+			else
+			{
+				m_components = ConnectedComponents::build<EvaluationStategy>(*m_elevation, *m_overrides);
+			}
+		});
+		return *m_components;
+	}
+
+	/*! Copy of maps in memory of the NUMA node. Threads of batch jobs on the node read it instead of
+		the remote memory (see MapsReplicas). Components are shared. It is available for maps in memory only.
+	*/
+	std::shared_ptr<MapsModel> replica(int node) const
+	{
+		components(); // they are calculated once for all replicas
+		std::shared_ptr<MapsModel> result(new MapsModel(m_sizeX, m_sizeY, m_pages, m_version));
+		auto copy = [&](const MapExplorer& map) {
+			auto block = PageBlock::allocate(m_sizeX * m_sizeY, (m_pages == PP_REGULAR) ? PP_TRANSPARENT : m_pages, node);
+			memcpy(block->data(), map.rawData(), m_sizeX * m_sizeY);
+			return new MapExplorer(block->data(), m_sizeX, m_sizeY, block);
+		};
+		result->m_elevation.reset(copy(*m_elevation));
+		result->m_overrides.reset(copy(*m_overrides));
+		std::call_once(result->m_componentsFlag, [&]() { result->m_components = m_components; });
+		return result;
+	}
+
+	/** Copy of the model with changed overrides (e.g. closures of roads). The model itself is not changed,
+		routes in flight keep reading it. Elevation is shared. Components are shared if drivability of cells is the same,
+		otherwise they are calculated on the first call. It is available for maps in memory only.
+		\return the model of the next version
+	*/
+	std::shared_ptr<MapsModel> withOverrides(const std::vector<OverrideEdit>& edits) const
+	{
+		if (m_overrides->isTiled())
+		{
+			throw std::logic_error("Overrides of tiled maps are read only");
+		}
+		std::shared_ptr<MapsModel> result(new MapsModel(m_sizeX, m_sizeY, m_pages, m_version + 1));
+		result->m_elevation = m_elevation;
+		auto block = PageBlock::allocate(m_sizeX * m_sizeY, m_pages);
+		memcpy(block->data(), m_overrides->rawData(), m_sizeX * m_sizeY);
+		for (const auto& edit : edits)
+		{
+			if (edit.pnt.first < 0 || edit.pnt.second < 0 ||
+				static_cast<size_t>(edit.pnt.first) >= m_sizeX || static_cast<size_t>(edit.pnt.second) >= m_sizeY)
+			{
+				throw std::invalid_argument("Edit of overrides is out of the map");
+			}
+			block->data()[m_sizeX * edit.pnt.second + edit.pnt.first] = edit.value;
+		}
+		result->m_overrides.reset(new MapExplorer(block->data(), m_sizeX, m_sizeY, block));
+
+		const TimeT unreachable = std::numeric_limits<TimeT>::quiet_NaN();
+		const EvaluationStategy before(*m_elevation, *m_overrides, unreachable);
+		const EvaluationStategy after(*result->m_elevation, *result->m_overrides, unreachable);
+		const bool sameDrivability = std::all_of(edits.begin(), edits.end(), [&](const OverrideEdit& edit) {
+			return before.isDrivable(edit.pnt) == after.isDrivable(edit.pnt);
+		});
+		if (sameDrivability)
+		{
+			components();
+			std::call_once(result->m_componentsFlag, [&]() { result->m_components = m_components; });
+		}
+		return result;
+	}
+
+	/// 0 for loaded maps. Every withOverrides() makes the next one
+	uint64_t version() const { return m_version; }
+
+	/// FNV-1a of elevation and overrides maps. It tells query logs and caches of one map from another
+	uint64_t checksum() const
+	{
+		std::call_once(m_checksumFlag, [this]() {
+			const uint64_t basis = packChecksum(nullptr, 0);
+			m_checksum = mapChecksum(*m_overrides, mapChecksum(*m_elevation, basis));
+		});
+		return m_checksum;
+	}
+
+	/// \return directory of assets for the application
+	static std::string assetsDir(const std::string& pname)
+	{
+		std::string anchor = std::string(".") + PATH_SEP;
+		auto lastpos = pname.find_last_of("/\\");
+		if (lastpos != std::string::npos)
+		{
+			anchor = pname.substr(0, lastpos) + PATH_SEP;
+		}
+		return anchor + "assets" + PATH_SEP;
+	}
 private:
+	MapsModel(size_t sizeX, size_t sizeY, PagePolicy pages, uint64_t version) :
+		m_sizeX(sizeX),
+		m_sizeY(sizeY),
+		m_pages(pages),
+		m_version(version)
+	{}
+
+	uint64_t mapChecksum(const MapExplorer& map, uint64_t hash) const
+	{
+		if (!map.isTiled())
+		{
+			return packChecksum(map.rawData(), m_sizeX * m_sizeY, hash);
+		}
+		std::vector<uint8_t> row(m_sizeX);
+		for (size_t y = 0; y < m_sizeY; ++y)
+		{
+			for (size_t x = 0; x < m_sizeX; ++x)
+			{
+				row[x] = map.get(PointT(static_cast<int>(x), static_cast<int>(y)));
+			}
+			hash = packChecksum(&row[0], row.size(), hash);
+		}
+		return hash;
+	}
+
+	/// Move times of the pack (PS_MOVE_TIMES) are the ones of the standard rover, so its components are valid
+	bool hasPackMoveTimes() const
+	{
+		size_t size = 0;
+		const uint8_t* times = m_pack->section(PS_MOVE_TIMES, size);
+		const auto& expected = VehicleCosts::standard()->times();
+		return times && size == expected.size() * sizeof(TimeT) && memcmp(times, &expected[0], size) == 0;
+	}
+
+	void loadPack(std::shared_ptr<const IslandPack> pack)
+	{
+		size_t elevationSize = 0;
+		size_t overridesSize = 0;
+		const uint8_t* elevation = pack->section(PS_ELEVATION, elevationSize);
+		const uint8_t* overrides = pack->section(PS_OVERRIDES, overridesSize);
+		const size_t expectedSize = pack->sizeX() * pack->sizeY();
+		if (!elevation || !overrides || elevationSize != expectedSize || overridesSize != expectedSize)
+		{
+			throw std::runtime_error("Island pack has no maps");
+		}
+		m_sizeX = pack->sizeX();
+		m_sizeY = pack->sizeY();
+		m_pack = pack;
+		m_elevation.reset(new MapExplorer(elevation, m_sizeX, m_sizeY, pack));
+		m_overrides.reset(new MapExplorer(overrides, m_sizeX, m_sizeY, pack));
+	}
+
 	std::ifstream::pos_type fileSize(const std::string& filename)
 	{
 		//TODO what wrong with s.t. like stat
 		std::ifstream in(filename, std::ifstream::ate | std::ifstream::binary);
 		if (!in.good())
 		{
-			throw std::exception("Can't open file for get size");
+			throw std::runtime_error("Can't open file for get size");
 		}
 		return in.tellg();
 	}
 
-	std::vector<uint8_t> loadFile(const std::string& filename, size_t expectedFileSize)
+	std::shared_ptr<PageBlock> loadFile(const std::string& filename, size_t expectedFileSize)
 	{
 		size_t fsize = fileSize(filename);
 		if (fsize != expectedFileSize)
 		{
-			throw std::exception("wrong file size");
+			throw std::runtime_error("wrong file size");
 		}
-		std::vector<uint8_t> data(fsize);
+		auto data = PageBlock::allocate(fsize, m_pages);
 		std::ifstream ifile(filename, std::ifstream::binary);
 		if (!ifile.good())
 		{
-			throw std::exception("Can't open file");
+			throw std::runtime_error("Can't open file");
 		}
-		ifile.read((char*)&data[0], fsize);
+		ifile.read((char*)data->data(), fsize);
 		return data;
 	}
 
 private:
-	std::unique_ptr<MapExplorer> m_elevation;
-	std::unique_ptr<MapExplorer> m_overrides;
+	size_t m_sizeX;
+	size_t m_sizeY;
+	PagePolicy m_pages;// of maps in memory
+	uint64_t m_version;
+	std::shared_ptr<MapExplorer> m_elevation;// it is shared by versions
+	std::shared_ptr<MapExplorer> m_overrides;
+	std::shared_ptr<const IslandPack> m_pack;
+	mutable std::once_flag m_componentsFlag;
+	mutable std::shared_ptr<const ConnectedComponents> m_components;
+	mutable std::once_flag m_checksumFlag;
+	mutable uint64_t m_checksum;
+
+};
+
+/*! Maps for threads of batch jobs on NUMA hosts. Every node has its own copy of maps. Workers are bound to nodes
+by turns and read maps of their node. A copy is made by the first worker of the node, nodes without workers
+have no copies. There are no copies on hosts with one node, workers take the model itself.
+Scratch grids of workers (e.g. RWMap of RouteBuilder) are placed on the node of the first touch, so create them
+in the worker thread after bind().
+*/
+struct MapsReplicas
+{
+	explicit MapsReplicas(const MapsModel& model) :
+		m_model(model),
+		m_nodes(NumaTopology::nodes())
+	{
+		if (m_nodes.size() > 1 && !model.elevation().isTiled())
+		{
+			m_replicas.resize(m_nodes.size());
+		}
+	}
 
+	/** Binds the current thread to the node of the worker. The affinity is not restored,
+		so call it in threads of the job only, not in the caller's one.
+		\return maps of the node
+	*/
+	const MapsModel& bind(size_t worker)
+	{
+		if (m_replicas.empty())
+		{
+			return m_model;
+		}
+		const size_t id = worker % m_nodes.size();
+		NumaTopology::bindThread(m_nodes[id]);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_replicas[id])
+		{
+			m_replicas[id] = m_model.replica(m_nodes[id]);
+		}
+		return *m_replicas[id];
+	}
+
+	size_t nodesCount() const { return m_nodes.size(); }
+
+private:
+	const MapsModel& m_model;
+	const std::vector<int> m_nodes;
+	std::mutex m_mutex;
+	std::vector<std::shared_ptr<const MapsModel>> m_replicas;// by nodes, they are made on demand
 };
 
-const size_t MapsModel::IMAGE_DIM = 2048;
 #endif // __MODEL_H__
\ No newline at end of file
@@ -0,0 +1,524 @@
+#ifndef __ALTERNATIVES_H__
+#define __ALTERNATIVES_H__
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include <arena.h>
+#include <maps.h>
+#include <route_codec.h>
+#include <sparse_map.h>
+#include <tiled_map.h>
+#include <vehicle_profile.h>
+
+/// Options of RouteBuilder::alternatives. Defaults are of admissible alternatives of road networks
+struct AlternativeOptions
+{
+	AlternativeOptions() :
+		maxStretch(0.25),
+		maxSharing(0.8),
+		sharingRadius(2),
+		minPlateau(0.25)
+	{}
+
+	/// Time of an alternative is not greater than (1 + maxStretch) * optimal time. Trees are bounded by it too
+	TimeT maxStretch;
+	/// Time of moves an alternative shares with the optimal route and other alternatives <= maxSharing * optimal time
+	TimeT maxSharing;
+	/** Moves to cells not farther than the radius from cells of another route (by both axes) are shared with it.
+		The grid has many routes of the same time side by side, they are not alternatives of each other
+	*/
+	int sharingRadius;
+	/// Local optimality: parts of an alternative not longer than minPlateau * optimal time are optimal routes
+	TimeT minPlateau;
+	/// Vehicle of the query (see SearchOptions::vehicle)
+	std::shared_ptr<const VehicleCosts> vehicle;
+};
+
+/// Route of RouteBuilder::alternatives
+struct AlternativeRoute
+{
+	TimeT time;// time to arrive
+	TimeT shared;// time of moves shared with the optimal route (see AlternativeOptions::sharingRadius)
+	TimeT plateau;// time of moves of both trees. Parts of the route not longer than it are optimal routes
+	std::vector<MeasuredPointT> steps;// route without the start: points with times of moves to them (see RouteBuilder::forEachStep)
+};
+
+/// Moves of trees of AlternativeRoutes are codes of RouteCodec::offset(). Cells that are not reached have no move
+struct NoMoveUnreachable
+{
+	static constexpr uint8_t value() { return 8; }
+
+	static constexpr bool isDefault(uint8_t move) { return move == value(); }
+};
+
+/// Dense grid of moves of a tree. It is a byte per cell, the dense grid of times is 8 bytes per cell
+struct MovesGrid
+{
+	MovesGrid(size_t sizeX, size_t sizeY) : m_sizeX(sizeX), m_moves(sizeX * sizeY, NoMoveUnreachable::value())
+	{}
+
+	uint8_t get(const PointT& pnt) const { return m_moves[m_sizeX * pnt.second + pnt.first]; }
+
+	void put(const PointT& pnt, uint8_t move) { m_moves[m_sizeX * pnt.second + pnt.first] = move; }
+
+	size_t allocatedBytes() const { return m_moves.size(); }//statistic
+
+private:
+	const size_t m_sizeX;
+	std::vector<uint8_t> m_moves;
+};
+
+/// Map of moves of the same backend as the map of times of trees. Sparse and tiled ones keep bytes too
+template<typename MapT>
+struct MovesMapOf
+{
+	using type = MovesGrid;
+};
+
+template<typename UnreachableT>
+struct MovesMapOf<SparseRWMap<UnreachableT>>
+{
+	using type = SparseRWMap<NoMoveUnreachable>;
+};
+
+template<typename UnreachableT>
+struct MovesMapOf<TiledRWMap<UnreachableT>>
+{
+	using type = TiledRWMap<NoMoveUnreachable>;
+};
+
+/** Alternative routes by the plateau method. There are two searches only, whatever the count of alternatives:
+the forward tree of optimal routes from the start and the backward tree of optimal routes to the destination.
+A via route of a cell v is the route of the forward tree to v and the route of the backward tree from v.
+Plateaus are chains of moves of the backward tree that are moves of optimal routes from the start too.
+The forward tree is not compared by parents: the grid has many routes of the same time, both trees take different ones.
+The via route of the first cell of a plateau goes by it. The route from the start to the end of the plateau is optimal,
+the route from its beginning to the destination is optimal too (backward tree). So any part of the via route not longer than the plateau is optimal:
+long plateaus are locally optimal alternatives without extra searches (plateaus here are not PlateauMask cells).
+
+An alternative is admissible if:
+	its time <= (1 + maxStretch) * optimal time (bounded stretch);
+	its plateau >= minPlateau * optimal time (local optimality);
+	its moves shared with every chosen route take <= maxSharing * optimal time (limited sharing). Moves are shared
+	if they are close to the other route, so routes of the same time side by side are not chosen.
+Admissible ones are taken by 2 * time + shared - plateau, the lower the better. Then they are checked for sharing with
+the chosen ones in this order.
+Trees are searched by A* until the key exceeds (1 + maxStretch) * optimal time. Via routes of other cells are too long,
+so trees are bounded by the ellipse around the start and the destination. Times of cells inside it are exact:
+the key of a cell is not greater than the limit if its time and its time to the other end is not.
+Trees are kept in maps of times of the search state of the query (MapT is a dense grid, SparseRWMap or TiledRWMap,
+see SearchOptions::state). Moves are kept as byte codes in maps of the same backend (see MovesMapOf).
+Queues of trees take memory from the arena of the query.
+*/
+template<typename SimulationT, typename MapT>
+struct AlternativeRoutes
+{
+	using MovesMapT = typename MovesMapOf<MapT>::type;
+
+	/// \param create returns an empty map of the whole map size. It is called for times of both trees
+	template<typename FactoryT>
+	AlternativeRoutes(size_t sizeX, size_t sizeY, FactoryT create) :
+		m_sizeX(sizeX),
+		m_sizeY(sizeY),
+		m_times{ std::unique_ptr<MapT>(new MapT(create())), std::unique_ptr<MapT>(new MapT(create())) },
+		m_moves{ std::unique_ptr<MovesMapT>(new MovesMapT(sizeX, sizeY)), std::unique_ptr<MovesMapT>(new MovesMapT(sizeX, sizeY)) },
+		m_expansions(0)
+	{}
+
+	/** \return up to count routes ordered by time. The first one is the optimal route. Nothing if the destination is not reached.
+		The start and the destination have to be drivable
+	*/
+	std::vector<AlternativeRoute> find(SimulationT& simEngine, Arena& arena, const PointT& startPnt, const PointT& finishPnt, size_t count,
+										const AlternativeOptions& options);
+
+	/// Sizes hash tables of sparse trees for the expected count of cells (see SparseRWMap::reserve). Other maps ignore it
+	void reserve(size_t cells)
+	{
+		for (size_t tree = FORWARD; tree <= BACKWARD; ++tree)
+		{
+			reserve(*m_times[tree], cells);
+			reserve(*m_moves[tree], cells);
+		}
+	}
+
+	size_t getSizeX() const { return m_sizeX; }
+
+	size_t getSizeY() const { return m_sizeY; }
+
+	/// Nodes taken from queues of both trees by the last find
+	size_t expansions() const { return m_expansions; }
+
+	/// Memory of trees
+	size_t bytes() const
+	{
+		return mapBytes(*m_times[FORWARD]) + mapBytes(*m_times[BACKWARD]) + mapBytes(*m_moves[FORWARD]) + mapBytes(*m_moves[BACKWARD]);
+	}
+
+private:
+	enum Tree
+	{
+		FORWARD,  ///< times from the start, moves from parents
+		BACKWARD  ///< times to the destination, moves to the next cells
+	};
+
+	static const uint8_t NO_MOVE = NoMoveUnreachable::value();
+	static constexpr TimeT TOLERANCE = 1e-12;// of times of optimal routes relative to the limit
+
+	struct Candidate
+	{
+		PointT first;// of the plateau
+		PointT last;
+		TimeT plateau;
+		TimeT rank;
+		AlternativeRoute route;
+	};
+
+	/** A* by the tree until the key exceeds the limit. The limit is set by the time of the other end if it is infinite.
+		\return false if the other end is not reached
+	*/
+	bool search(SimulationT& simEngine, Arena& arena, Tree tree, const PointT& from, const PointT& to, TimeT stretch, TimeT& limit);
+
+	/// Key of the cell in sets of cells
+	size_t id(const PointT& pnt) const { return static_cast<size_t>(pnt.second) * m_sizeX + pnt.first; }
+
+	/// Time of the cell by the tree, infinity if it is not reached
+	TimeT time(Tree tree, const PointT& pnt) const
+	{
+		const TimeT result = m_times[tree]->get(pnt);
+		return (result == result) ? result : std::numeric_limits<TimeT>::infinity();
+	}
+
+	uint8_t move(Tree tree, const PointT& pnt) const { return m_moves[tree]->get(pnt); }
+
+	/// Cells of the last search are forgotten. Dense grids are reset by the touched cells
+	template<typename OtherMapT>
+	static void clear(OtherMapT& map, const std::vector<PointT>& touched)
+	{
+		for (const auto& pnt : touched)
+		{
+			map.put(pnt, std::numeric_limits<TimeT>::quiet_NaN());
+		}
+	}
+
+	static void clear(MovesGrid& map, const std::vector<PointT>& touched)
+	{
+		for (const auto& pnt : touched)
+		{
+			map.put(pnt, NO_MOVE);
+		}
+	}
+
+	template<typename UnreachableT>
+	static void clear(SparseRWMap<UnreachableT>& map, const std::vector<PointT>&) { map.reset(); }
+
+	template<typename UnreachableT>
+	static void clear(TiledRWMap<UnreachableT>& map, const std::vector<PointT>&) { map.reset(); }
+
+	template<typename OtherMapT>
+	static void reserve(OtherMapT&, size_t) {}
+
+	template<typename UnreachableT>
+	static void reserve(SparseRWMap<UnreachableT>& map, size_t cells) { map.reserve(cells); }
+
+	template<typename OtherMapT>
+	size_t mapBytes(const OtherMapT&) const { return m_sizeX * m_sizeY * sizeof(TimeT); }
+
+	template<typename UnreachableT>
+	static size_t mapBytes(const SparseRWMap<UnreachableT>& map) { return map.allocatedBytes(); }
+
+	template<typename UnreachableT>
+	static size_t mapBytes(const TiledRWMap<UnreachableT>& map) { return map.allocatedBytes(); }
+
+	static size_t mapBytes(const MovesGrid& map) { return map.allocatedBytes(); }
+
+	/// The move back. Codes are of RouteCodec::offset()
+	static uint8_t opposite(uint8_t move)
+	{
+		static const uint8_t moves[8] = { 5, 4, 3, 2, 1, 0, 7, 6 };
+		return moves[move];
+	}
+
+	/// \return false if the neighbor of the cell by the move is out of the map
+	bool neighbor(const PointT& pnt, uint8_t move, PointT& result) const
+	{
+		result = PointT(pnt.first + RouteCodec::offset(move)[0], pnt.second + RouteCodec::offset(move)[1]);
+		return result.first >= 0 && result.second >= 0 &&
+			static_cast<size_t>(result.first) < m_sizeX && static_cast<size_t>(result.second) < m_sizeY;
+	}
+
+	/** The move of the backward tree from the cell is a move of an optimal route to the next cell too.
+		Parents of the forward tree are not compared: the grid has many routes of the same time, trees take different ones
+	*/
+	bool isPlateauMove(const SimulationT& simEngine, const PointT& from, TimeT limit) const
+	{
+		const uint8_t backward = move(BACKWARD, from);
+		PointT to;
+		if (backward == NO_MOVE || !neighbor(from, backward, to) || !isInside(to, limit))
+		{
+			return false;
+		}
+		const TimeT arrival = time(FORWARD, from) + simEngine.getTimeToNeighbour(from, to);
+		return arrival <= time(FORWARD, to) + limit * TOLERANCE;
+	}
+
+	/// A plateau move of a neighbor leads to the cell, so the cell is not the first one of a plateau
+	bool isReachedByPlateau(const SimulationT& simEngine, const PointT& cell, TimeT limit) const
+	{
+		for (uint8_t code = 0; code < 8; ++code)
+		{
+			PointT from;
+			if (neighbor(cell, code, from) && move(BACKWARD, from) == opposite(code) && isInside(from, limit) &&
+				isPlateauMove(simEngine, from, limit))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// Times of both trees are exact in the cell
+	bool isInside(const PointT& pnt, TimeT limit) const
+	{
+		return time(FORWARD, pnt) + time(BACKWARD, pnt) <= limit;
+	}
+
+	/// Via route of the plateau: the forward tree to its first cell and the backward tree from it
+	AlternativeRoute viaRoute(const SimulationT& simEngine, const PointT& first, const PointT& startPnt, const PointT& finishPnt) const;
+
+	/// Cells not farther than the radius from the route
+	std::unordered_set<size_t> nearCells(const PointT& startPnt, const AlternativeRoute& route, int radius) const;
+
+	/// Time of moves of the route to the cells
+	TimeT sharedTime(const AlternativeRoute& route, const std::unordered_set<size_t>& cells) const;
+
+private:
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	std::unique_ptr<MapT> m_times[2];// by Tree, NaN is not reached
+	std::unique_ptr<MovesMapT> m_moves[2];// by Tree, NO_MOVE is not reached
+	std::vector<PointT> m_touched[2];// cells of the last search
+	size_t m_expansions;//statistic
+};
+
+template<typename SimulationT, typename MapT>
+std::vector<AlternativeRoute> AlternativeRoutes<SimulationT, MapT>::find(SimulationT& simEngine, Arena& arena, const PointT& startPnt,
+																		const PointT& finishPnt, size_t count, const AlternativeOptions& options)
+{
+	if (!(options.maxStretch >= 0) || !(options.maxSharing >= 0) || !(options.minPlateau >= 0) || options.sharingRadius < 0)
+	{
+		throw std::invalid_argument("Stretch, sharing, sharing radius and plateau of alternatives should be >= 0");
+	}
+	m_expansions = 0;
+	std::vector<AlternativeRoute> result;
+	TimeT limit = std::numeric_limits<TimeT>::infinity();
+	if (count == 0 || !search(simEngine, arena, FORWARD, startPnt, finishPnt, options.maxStretch, limit) ||
+		!search(simEngine, arena, BACKWARD, finishPnt, startPnt, options.maxStretch, limit))
+	{
+		return result;
+	}
+	result.push_back(viaRoute(simEngine, finishPnt, startPnt, finishPnt));
+	const TimeT optimal = time(FORWARD, finishPnt);
+	result.front().plateau = optimal;
+	if (count == 1)
+	{
+		return result;
+	}
+
+	// Plateaus start where there are no plateau moves to the cell, but the move from it is.
+	// Cells of the forward search are enough: both trees have the cells of via routes
+	const auto optimalCells = nearCells(startPnt, result.front(), options.sharingRadius);
+	std::vector<Candidate> candidates;
+	for (const auto& cell : m_touched[FORWARD])
+	{
+		if (!isInside(cell, limit) || !isPlateauMove(simEngine, cell, limit) || isReachedByPlateau(simEngine, cell, limit))
+		{
+			continue;
+		}
+		PointT last = cell;
+		while (isPlateauMove(simEngine, last, limit))
+		{
+			neighbor(last, move(BACKWARD, last), last);
+		}
+		const TimeT plateau = time(BACKWARD, cell) - time(BACKWARD, last);
+		if (plateau < options.minPlateau * optimal || plateau >= optimal)
+		{
+			continue;
+		}
+		Candidate candidate = { cell, last, plateau, 0.0, viaRoute(simEngine, cell, startPnt, finishPnt) };
+		candidate.route.plateau = plateau;
+		candidate.route.shared = sharedTime(candidate.route, optimalCells);
+		candidate.rank = 2 * candidate.route.time + candidate.route.shared - plateau;
+		candidates.push_back(std::move(candidate));
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& first, const Candidate& second) { return first.rank < second.rank; });
+
+	std::vector<std::unordered_set<size_t>> chosenCells(1, optimalCells);
+	for (auto& candidate : candidates)
+	{
+		if (result.size() == count)
+		{
+			break;
+		}
+		if (candidate.route.time > limit)
+		{
+			continue;
+		}
+		const bool limited = std::all_of(chosenCells.begin(), chosenCells.end(), [&](const std::unordered_set<size_t>& cells) {
+			return sharedTime(candidate.route, cells) <= options.maxSharing * optimal;
+		});
+		if (limited)
+		{
+			chosenCells.push_back(nearCells(startPnt, candidate.route, options.sharingRadius));
+			result.push_back(std::move(candidate.route));
+		}
+	}
+	std::stable_sort(result.begin() + 1, result.end(), [](const AlternativeRoute& first, const AlternativeRoute& second) {
+		return first.time < second.time;
+	});
+	return result;
+}
+
+template<typename SimulationT, typename MapT>
+bool AlternativeRoutes<SimulationT, MapT>::search(SimulationT& simEngine, Arena& arena, Tree tree, const PointT& from, const PointT& to,
+												TimeT stretch, TimeT& limit)
+{
+	MapT& times = *m_times[tree];
+	MovesMapT& moves = *m_moves[tree];
+	clear(times, m_touched[tree]);
+	clear(moves, m_touched[tree]);
+	m_touched[tree].clear();
+
+	// The estimation is to the other end. The backward tree goes by reverse moves, its estimation is from the start
+	auto estimate = [&](const PointT& pnt) {
+		return (tree == FORWARD) ? simEngine.getMinTimeToArrive(pnt, to) : simEngine.getMinTimeToArrive(to, pnt);
+	};
+	struct Node
+	{
+		TimeT key;
+		TimeT time;
+		PointT pnt;
+
+		bool operator>(const Node& other) const { return key > other.key; }
+	};
+	using NodesT = std::vector<Node, ArenaAllocator<Node>>;
+	std::priority_queue<Node, NodesT, std::greater<Node>> queue{ std::greater<Node>(), NodesT(ArenaAllocator<Node>(arena)) };
+	times.put(from, 0.0);
+	m_touched[tree].push_back(from);
+	queue.push(Node{ estimate(from), 0.0, from });
+	while (!queue.empty() && queue.top().key <= limit)
+	{
+		const Node node = queue.top();
+		queue.pop();
+		if (time(tree, node.pnt) < node.time)
+		{
+			continue;
+		}
+		m_expansions += 1;
+		if (node.pnt == to && limit == std::numeric_limits<TimeT>::infinity())
+		{
+			limit = node.time * (1.0 + stretch);
+		}
+		for (uint8_t code = 0; code < 8; ++code)
+		{
+			PointT next;
+			if (!neighbor(node.pnt, code, next))
+			{
+				continue;
+			}
+			const TimeT moveTime = (tree == FORWARD) ? simEngine.getTimeToNeighbour(node.pnt, next) : simEngine.getTimeToNeighbour(next, node.pnt);
+			if (moveTime != moveTime)
+			{
+				continue;
+			}
+			const TimeT newTime = node.time + moveTime;
+			const TimeT oldTime = time(tree, next);
+			if (!(newTime < oldTime))
+			{
+				continue;
+			}
+			if (oldTime == std::numeric_limits<TimeT>::infinity())
+			{
+				m_touched[tree].push_back(next);
+			}
+			times.put(next, newTime);
+			// Forward moves are of the parent to the cell, backward ones are of the cell to the parent (the opposite move)
+			moves.put(next, (tree == FORWARD) ? code : opposite(code));
+			queue.push(Node{ newTime + estimate(next), newTime, next });
+		}
+	}
+	return time(tree, to) <= limit;
+}
+
+template<typename SimulationT, typename MapT>
+AlternativeRoute AlternativeRoutes<SimulationT, MapT>::viaRoute(const SimulationT& simEngine, const PointT& first, const PointT& startPnt,
+																const PointT& finishPnt) const
+{
+	std::vector<PointT> points;
+	for (PointT cell = first; cell != startPnt; neighbor(cell, opposite(move(FORWARD, cell)), cell))
+	{
+		points.push_back(cell);
+	}
+	points.push_back(startPnt);
+	std::reverse(points.begin(), points.end());
+	for (PointT cell = first; cell != finishPnt; )
+	{
+		neighbor(cell, move(BACKWARD, cell), cell);
+		points.push_back(cell);
+	}
+	AlternativeRoute route;
+	route.time = 0.0;
+	route.shared = 0.0;
+	route.plateau = 0.0;
+	for (size_t step = 1; step < points.size(); ++step)
+	{
+		const TimeT time = simEngine.getTimeToNeighbour(points[step - 1], points[step]);
+		route.time += time;
+		route.steps.push_back(std::make_pair(points[step], time));
+	}
+	return route;
+}
+
+template<typename SimulationT, typename MapT>
+std::unordered_set<size_t> AlternativeRoutes<SimulationT, MapT>::nearCells(const PointT& startPnt, const AlternativeRoute& route, int radius) const
+{
+	std::unordered_set<size_t> result;
+	auto add = [&](const PointT& pnt) {
+		for (int y = std::max(0, pnt.second - radius); y <= pnt.second + radius && static_cast<size_t>(y) < m_sizeY; ++y)
+		{
+			for (int x = std::max(0, pnt.first - radius); x <= pnt.first + radius && static_cast<size_t>(x) < m_sizeX; ++x)
+			{
+				result.insert(id(PointT(x, y)));
+			}
+		}
+	};
+	add(startPnt);
+	for (const auto& step : route.steps)
+	{
+		add(step.first);
+	}
+	return result;
+}
+
+template<typename SimulationT, typename MapT>
+TimeT AlternativeRoutes<SimulationT, MapT>::sharedTime(const AlternativeRoute& route, const std::unordered_set<size_t>& cells) const
+{
+	TimeT result = 0.0;
+	for (const auto& step : route.steps)
+	{
+		if (cells.count(id(step.first)))
+		{
+			result += step.second;
+		}
+	}
+	return result;
+}
+
+#endif // __ALTERNATIVES_H__
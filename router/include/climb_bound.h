@@ -0,0 +1,175 @@
+#ifndef __CLIMB_BOUND_H__
+#define __CLIMB_BOUND_H__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <maps.h>
+#include <vehicle_profile.h>
+
+/** Lower bound of time to arrive by the distance and the climb to the goal (see SearchOptions::climbBound).
+The octile estimation takes the cheapest move per unit of distance, it is a descent. But a route to a higher goal
+has to climb, and climbs are the most expensive moves. The bound takes both.
+
+For any slope b and a move of length l and elevation change dh: t >= a(b) * l + b * dh,
+where a(b) is the minimum of (t - b * dh) / l by moves of the vehicle. A route of length L climbs
+the difference of elevations H of its ends, so its time T >= a(b) * L + b * H >= a(b) * D + b * H,
+if a(b) >= 0 (D is the octile distance, L >= D). The bound is the maximum of it by slopes.
+a(b) is the minimum of lines by moves, it is concave. So the maximum is at one of its vertices (tangents)
+or at an end of the range of a(b) >= 0. They are found once for the vehicle.
+The bound of a slope is consistent (b * dh are summed to b * H by any route), so the maximum is consistent too.
+*/
+struct ClimbBound
+{
+	/// \param vehicle nullptr is VehicleCosts::standard()
+	static std::shared_ptr<const ClimbBound> build(std::shared_ptr<const VehicleCosts> vehicle = nullptr);
+
+	/** \return lower bound of time of a route
+		\param distance the octile distance between ends
+		\param climb elevation of the end - elevation of the start
+	*/
+	TimeT time(TimeT distance, int climb) const
+	{
+		// Bounds of tangents are concave by them
+		size_t first = 0;
+		size_t last = m_tangents.size() - 1;
+		while (first < last)
+		{
+			const size_t middle = (first + last) / 2;
+			if (bound(middle, distance, climb) < bound(middle + 1, distance, climb))
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+		return std::max(0.0, bound(first, distance, climb));
+	}
+
+	const std::shared_ptr<const VehicleCosts>& vehicle() const { return m_vehicle; }
+
+	/// Count of slopes of the bound
+	size_t tangents() const { return m_tangents.size(); }
+
+private:
+	/// a(b) of the slope b
+	struct Tangent
+	{
+		TimeT slope;
+		TimeT base;
+	};
+
+	explicit ClimbBound(std::shared_ptr<const VehicleCosts> vehicle) : m_vehicle(std::move(vehicle))
+	{}
+
+	TimeT bound(size_t tangent, TimeT distance, int climb) const
+	{
+		return m_tangents[tangent].base * distance + m_tangents[tangent].slope * climb;
+	}
+
+private:
+	std::shared_ptr<const VehicleCosts> m_vehicle;
+	std::vector<Tangent> m_tangents;// ordered by slopes
+};
+
+inline std::shared_ptr<const ClimbBound> ClimbBound::build(std::shared_ptr<const VehicleCosts> vehicle)
+{
+	std::shared_ptr<ClimbBound> result(new ClimbBound(vehicle ? std::move(vehicle) : VehicleCosts::standard()));
+	// Moves as points: (dh / l, t / l). Then (t - b * dh) / l of a move is the line of slope -(dh / l)
+	std::vector<std::pair<TimeT, TimeT>> moves;
+	for (int deltaH = -VehicleCosts::MAX_DELTA; deltaH <= VehicleCosts::MAX_DELTA; ++deltaH)
+	{
+		for (size_t isDiagonal = 0; isDiagonal < 2; ++isDiagonal)
+		{
+			const TimeT time = result->m_vehicle->time(deltaH, isDiagonal);
+			const TimeT length = isDiagonal ? sqrt(2.0) : 1.0;
+			if (time == time)
+			{
+				moves.push_back(std::make_pair(deltaH / length, time / length));
+			}
+		}
+	}
+	if (moves.empty())
+	{
+		throw std::invalid_argument("Vehicle has no moves");
+	}
+	auto base = [&moves](TimeT slope) {
+		TimeT value = moves.front().second - moves.front().first * slope;
+		for (const auto& move : moves)
+		{
+			value = std::min(value, move.second - move.first * slope);
+		}
+		return value;
+	};
+
+	// a(b) >= 0 if b is in the range [lowest, highest]. Vertices of a(b) are slopes of edges of the lower hull of moves
+	TimeT lowest = -std::numeric_limits<TimeT>::infinity();
+	TimeT highest = std::numeric_limits<TimeT>::infinity();
+	for (const auto& move : moves)
+	{
+		if (move.first < 0)
+		{
+			lowest = std::max(lowest, move.second / move.first);
+		}
+		else if (move.first > 0)
+		{
+			highest = std::min(highest, move.second / move.first);
+		}
+	}
+	std::sort(moves.begin(), moves.end());
+	std::vector<std::pair<TimeT, TimeT>> hull;
+	for (const auto& move : moves)
+	{
+		if (!hull.empty() && hull.back().first == move.first)
+		{
+			continue;// the cheapest one of the same climb is first
+		}
+		while (hull.size() > 1)
+		{
+			const auto& first = hull[hull.size() - 2];
+			const auto& second = hull.back();
+			// The second point is not below the line from the first one to the move
+			if ((second.second - first.second) * (move.first - first.first) < (move.second - first.second) * (second.first - first.first))
+			{
+				break;
+			}
+			hull.pop_back();
+		}
+		hull.push_back(move);
+	}
+	std::vector<TimeT> slopes;
+	if (lowest == lowest && std::isfinite(lowest))
+	{
+		slopes.push_back(lowest);
+	}
+	for (size_t id = 1; id < hull.size(); ++id)
+	{
+		const TimeT slope = (hull[id].second - hull[id - 1].second) / (hull[id].first - hull[id - 1].first);
+		if (slope > lowest && slope < highest)
+		{
+			slopes.push_back(slope);
+		}
+	}
+	if (std::isfinite(highest))
+	{
+		slopes.push_back(highest);
+	}
+	if (slopes.empty())
+	{
+		slopes.push_back(0.0);
+	}
+	for (TimeT slope : slopes)
+	{
+		result->m_tangents.push_back(Tangent{ slope, std::max(0.0, base(slope)) });
+	}
+	return result;
+}
+
+#endif // __CLIMB_BOUND_H__
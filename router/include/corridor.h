@@ -0,0 +1,457 @@
+#ifndef __CORRIDOR_H__
+#define __CORRIDOR_H__
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+#include <stdint.h>
+
+#include <maps.h>
+#include "model.h"
+
+/** Cells of the map where the full resolution search is allowed.
+It is stored by cells of a pyramid level: one flag for factor x factor cells of the map.
+The factor and the width tell how to build the same corridor again (e.g. by route_replay).
+*/
+struct CorridorMask
+{
+	CorridorMask(size_t factor, size_t width, size_t sizeX, size_t sizeY) :
+		m_factor(factor),
+		m_width(width),
+		m_sizeX(sizeX),
+		m_sizeY(sizeY),
+		m_flags(sizeX * sizeY, 0)
+	{}
+
+	/// \param pnt point of the full resolution map
+	bool contains(const PointT& pnt) const
+	{
+		const size_t x = pnt.first / m_factor;
+		const size_t y = pnt.second / m_factor;
+		return pnt.first >= 0 && pnt.second >= 0 && x < m_sizeX && y < m_sizeY && m_flags[y * m_sizeX + x];
+	}
+
+	/// \param x, y cell of the pyramid level
+	void add(size_t x, size_t y) { m_flags[y * m_sizeX + x] = 1; }
+
+	/// Count of cells of the full resolution map in the corridor
+	size_t cells() const
+	{
+		return std::count(m_flags.begin(), m_flags.end(), 1) * m_factor * m_factor;
+	}
+
+	size_t factor() const { return m_factor; }
+
+	/// Cells of the level on every side of the coarse route
+	size_t width() const { return m_width; }
+
+private:
+	const size_t m_factor;
+	const size_t m_width;
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	std::vector<uint8_t> m_flags;
+};
+
+/** Downsampled copies of the map for coarse-to-fine search.
+Every level joins factor x factor cells of the map (factor is 2, 4, 8 ...) in one cell.
+A cell of a level is drivable if any of its cells is drivable. Neighbor cells of a level are linked if there is
+a move of the map between them. So narrow passes are never lost on coarse levels. It is conservative for corridors:
+a coarse route could go through a pass that doesn't exist (parts of a cell are not connected inside), but never misses one.
+The time to cross a cell in a direction is the average time per unit of distance of moves of the map in this direction
+that start in the cell. So coarse routes know about slopes: a climb costs more than a descent.
+
+The coarse route is found by A* on a level. The corridor is the route widened by 'width' cells of the level.
+RouteBuilder searches inside the corridor (see SearchOptions::corridor) and falls back to the whole map
+if there is no way inside.
+*/
+struct MapsPyramid
+{
+	static const size_t DEFAULT_LEVELS = 2; // factors 2, 4. Cells of 8x8 often join both banks of a river
+	static const size_t DEFAULT_WIDTH = 2; // cells of a level on every side of the coarse route
+	static const size_t DIRTY_TILE = 64; // cells of the map. Pyramids are updated by tiles
+
+	struct Level
+	{
+		size_t factor;
+		size_t sizeX;
+		size_t sizeY;
+		std::vector<float> cost;// [cell * 8 + direction] time per unit of distance to cross a cell in the direction
+		std::vector<uint8_t> links;// bit by direction (see offset()) is set if there is a move of the map to the neighbor cell
+	};
+
+	/// Builds levels from the maps of the model by SimulationT rules of drivability and time of moves
+	template<typename SimulationT>
+	static std::shared_ptr<const MapsPyramid> build(const MapsModel& model, size_t levels = DEFAULT_LEVELS);
+
+	/** Pyramid of the model after changes of cells (e.g. MapsModel::withOverrides). Only cells of levels
+		in dirty tiles (DIRTY_TILE x DIRTY_TILE cells of the map around changed cells) are calculated again.
+	*/
+	template<typename SimulationT>
+	static std::shared_ptr<const MapsPyramid> update(const MapsPyramid& previous, const MapsModel& model, const std::vector<PointT>& changed);
+
+	size_t levels() const { return m_levels.size(); }
+
+	/// \param id 0 is the level with factor 2
+	const Level& level(size_t id) const { return m_levels.at(id); }
+
+	/** Finds a route on the level and widens it.
+		\return corridor or nullptr if there is no route on the level (then there is no route on the map too).
+	*/
+	std::shared_ptr<const CorridorMask> corridor(const PointT& from, const PointT& to, size_t width = DEFAULT_WIDTH) const
+	{
+		return corridor(from, to, width, m_levels.size() - 1);
+	}
+
+	std::shared_ptr<const CorridorMask> corridor(const PointT& from, const PointT& to, size_t width, size_t levelId) const;
+
+private:
+	/// Offset of the neighbor by direction. The same order as BaseMap::getNeighbors
+	static const int* offset(int direction)
+	{
+		static const int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+		return offsets[direction];
+	}
+
+	MapsPyramid() {}
+
+	/// Moves of the map that start in a cell of the first level (factor 2)
+	struct CellSums
+	{
+		float time[8];// time per unit of distance by directions
+		uint16_t moves[8];
+		uint8_t links;// bit by direction is set if there is a move to the neighbor cell of the first level
+	};
+
+	template<typename SimulationT>
+	static CellSums sumCell(const SimulationT& simEngine, int sizeX, int sizeY, size_t cellX, size_t cellY);
+
+	/// Cost and links of the cell of the level by sums of its cells of the first level: sumsOf(x, y)
+	template<typename SumsT>
+	static void joinCell(Level& level, size_t levelX, size_t levelY, size_t x, size_t y, const SumsT& sumsOf);
+
+	/// \return direction of offset
+	static int direction(int dX, int dY)
+	{
+		for (int id = 0; id < 8; ++id)
+		{
+			if (offset(id)[0] == dX && offset(id)[1] == dY)
+			{
+				return id;
+			}
+		}
+		throw std::logic_error("Cells are not neighbors");
+	}
+
+	static size_t divideUp(size_t value, size_t factor) { return (value + factor - 1) / factor; }
+
+private:
+	std::vector<Level> m_levels;
+};
+
+template<typename SimulationT>
+std::shared_ptr<const MapsPyramid> MapsPyramid::build(const MapsModel& model, size_t levels)
+{
+	if (levels == 0)
+	{
+		throw std::invalid_argument("Pyramid should have at least one level");
+	}
+	const TimeT unreachable = std::numeric_limits<TimeT>::quiet_NaN();
+	const SimulationT simEngine(model.elevation(), model.overrides(), unreachable);
+	const int sizeX = static_cast<int>(model.getSizeX());
+	const int sizeY = static_cast<int>(model.getSizeY());
+
+	// Sums by cells of the first level
+	const size_t factor = 2;
+	const size_t levelX = divideUp(sizeX, factor);
+	const size_t levelY = divideUp(sizeY, factor);
+	std::vector<CellSums> sums(levelX * levelY);
+	for (size_t y = 0; y < levelY; ++y)
+	{
+		for (size_t x = 0; x < levelX; ++x)
+		{
+			sums[y * levelX + x] = sumCell(simEngine, sizeX, sizeY, x, y);
+		}
+	}
+	auto sumsOf = [&](size_t x, size_t y) -> const CellSums& { return sums[y * levelX + x]; };
+
+	std::shared_ptr<MapsPyramid> result(new MapsPyramid());
+	for (size_t levelId = 0; levelId < levels; ++levelId)
+	{
+		const size_t levelFactor = factor << levelId;
+		Level level;
+		level.factor = levelFactor;
+		level.sizeX = divideUp(sizeX, levelFactor);
+		level.sizeY = divideUp(sizeY, levelFactor);
+		level.cost.assign(level.sizeX * level.sizeY * 8, 1.0f);
+		level.links.assign(level.sizeX * level.sizeY, 0);
+		for (size_t y = 0; y < level.sizeY; ++y)
+		{
+			for (size_t x = 0; x < level.sizeX; ++x)
+			{
+				joinCell(level, levelX, levelY, x, y, sumsOf);
+			}
+		}
+		result->m_levels.push_back(std::move(level));
+	}
+	return result;
+}
+
+template<typename SimulationT>
+std::shared_ptr<const MapsPyramid> MapsPyramid::update(const MapsPyramid& previous, const MapsModel& model, const std::vector<PointT>& changed)
+{
+	const TimeT unreachable = std::numeric_limits<TimeT>::quiet_NaN();
+	const SimulationT simEngine(model.elevation(), model.overrides(), unreachable);
+	const int sizeX = static_cast<int>(model.getSizeX());
+	const int sizeY = static_cast<int>(model.getSizeY());
+	const size_t factor = 2;
+	const size_t levelX = divideUp(sizeX, factor);
+	const size_t levelY = divideUp(sizeY, factor);
+
+	// Moves from the changed cell and moves to it from neighbors are changed. Tiles are aligned to cells of all levels
+	const size_t tile = std::max(static_cast<size_t>(DIRTY_TILE), previous.m_levels.back().factor);
+	const size_t tilesX = divideUp(sizeX, tile);
+	const size_t tilesY = divideUp(sizeY, tile);
+	std::vector<uint8_t> dirty(tilesX * tilesY, 0);
+	for (const auto& pnt : changed)
+	{
+		for (int dY = -1; dY <= 1; ++dY)
+		{
+			for (int dX = -1; dX <= 1; ++dX)
+			{
+				const int x = pnt.first + dX;
+				const int y = pnt.second + dY;
+				if (x >= 0 && y >= 0 && x < sizeX && y < sizeY)
+				{
+					dirty[(y / tile) * tilesX + x / tile] = 1;
+				}
+			}
+		}
+	}
+
+	std::shared_ptr<MapsPyramid> result(new MapsPyramid(previous));
+	const size_t tileCells = tile / factor; // cells of the first level in a row of the tile
+	std::vector<CellSums> sums(tileCells * tileCells);
+	for (size_t tileY = 0; tileY < tilesY; ++tileY)
+	{
+		for (size_t tileX = 0; tileX < tilesX; ++tileX)
+		{
+			if (!dirty[tileY * tilesX + tileX])
+			{
+				continue;
+			}
+			const size_t left = tileX * tileCells;
+			const size_t top = tileY * tileCells;
+			for (size_t y = top; y < std::min(levelY, top + tileCells); ++y)
+			{
+				for (size_t x = left; x < std::min(levelX, left + tileCells); ++x)
+				{
+					sums[(y - top) * tileCells + (x - left)] = sumCell(simEngine, sizeX, sizeY, x, y);
+				}
+			}
+			auto sumsOf = [&](size_t x, size_t y) -> const CellSums& { return sums[(y - top) * tileCells + (x - left)]; };
+			for (auto& level : result->m_levels)
+			{
+				const size_t join = level.factor / factor;
+				for (size_t y = top / join; y < std::min(level.sizeY, (top + tileCells) / join); ++y)
+				{
+					for (size_t x = left / join; x < std::min(level.sizeX, (left + tileCells) / join); ++x)
+					{
+						joinCell(level, levelX, levelY, x, y, sumsOf);
+					}
+				}
+			}
+		}
+	}
+	return result;
+}
+
+template<typename SimulationT>
+MapsPyramid::CellSums MapsPyramid::sumCell(const SimulationT& simEngine, int sizeX, int sizeY, size_t cellX, size_t cellY)
+{
+	const size_t factor = 2;
+	CellSums result;
+	std::fill(result.time, result.time + 8, 0.0f);
+	std::fill(result.moves, result.moves + 8, 0);
+	result.links = 0;
+	for (int y = static_cast<int>(cellY * factor); y < std::min(sizeY, static_cast<int>((cellY + 1) * factor)); ++y)
+	{
+		for (int x = static_cast<int>(cellX * factor); x < std::min(sizeX, static_cast<int>((cellX + 1) * factor)); ++x)
+		{
+			const PointT pnt(x, y);
+			if (!simEngine.isDrivable(pnt))
+			{
+				continue;
+			}
+			for (int direction = 0; direction < 8; ++direction)
+			{
+				const PointT neighbor(x + offset(direction)[0], y + offset(direction)[1]);
+				if (neighbor.first < 0 || neighbor.second < 0 || neighbor.first >= sizeX || neighbor.second >= sizeY)
+				{
+					continue;
+				}
+				const TimeT time = simEngine.getTimeToNeighbour(pnt, neighbor);
+				if (time != time)
+				{
+					continue;
+				}
+				const int dX = neighbor.first / static_cast<int>(factor) - x / static_cast<int>(factor);
+				const int dY = neighbor.second / static_cast<int>(factor) - y / static_cast<int>(factor);
+				if (dX != 0 || dY != 0)
+				{
+					result.links |= 1 << MapsPyramid::direction(dX, dY);
+				}
+				result.time[direction] += static_cast<float>(time / SimulationT::getNeighboursDistance(pnt, neighbor));
+				result.moves[direction] += 1;
+			}
+		}
+	}
+	return result;
+}
+
+template<typename SumsT>
+void MapsPyramid::joinCell(Level& level, size_t levelX, size_t levelY, size_t x, size_t y, const SumsT& sumsOf)
+{
+	const size_t join = level.factor / 2; // cells of the first level in one cell of this level
+	double cellTime[8] = {};
+	size_t cellMoves[8] = {};
+	uint8_t links = 0;
+	for (size_t subY = y * join; subY < std::min(levelY, (y + 1) * join); ++subY)
+	{
+		for (size_t subX = x * join; subX < std::min(levelX, (x + 1) * join); ++subX)
+		{
+			const CellSums& sums = sumsOf(subX, subY);
+			for (int direction = 0; direction < 8; ++direction)
+			{
+				cellTime[direction] += sums.time[direction];
+				cellMoves[direction] += sums.moves[direction];
+			}
+			// Links of sub cells to other cells of this level
+			for (int direction = 0; direction < 8; ++direction)
+			{
+				if (!(sums.links & (1 << direction)))
+				{
+					continue;
+				}
+				const int dX = (static_cast<int>(subX) + offset(direction)[0]) / static_cast<int>(join) - static_cast<int>(x);
+				const int dY = (static_cast<int>(subY) + offset(direction)[1]) / static_cast<int>(join) - static_cast<int>(y);
+				if (dX != 0 || dY != 0)
+				{
+					links |= 1 << MapsPyramid::direction(dX, dY);
+				}
+			}
+		}
+	}
+	level.links[y * level.sizeX + x] = links;
+	// There could be no moves in a direction (e.g. a shore). The average of all directions is used then.
+	double totalTime = 0.0;
+	size_t totalMoves = 0;
+	for (int direction = 0; direction < 8; ++direction)
+	{
+		totalTime += cellTime[direction];
+		totalMoves += cellMoves[direction];
+	}
+	for (int direction = 0; direction < 8; ++direction)
+	{
+		const double perUnit = cellMoves[direction] ? cellTime[direction] / cellMoves[direction] :
+			(totalMoves ? totalTime / totalMoves : 1.0);
+		level.cost[(y * level.sizeX + x) * 8 + direction] = static_cast<float>(perUnit);
+	}
+}
+
+inline std::shared_ptr<const CorridorMask> MapsPyramid::corridor(const PointT& from, const PointT& to, size_t width, size_t levelId) const
+{
+	const Level& level = m_levels.at(levelId);
+	const int sizeX = static_cast<int>(level.sizeX);
+	const int sizeY = static_cast<int>(level.sizeY);
+	const int factor = static_cast<int>(level.factor);
+	auto toCell = [&](const PointT& pnt) {
+		if (pnt.first < 0 || pnt.second < 0 || pnt.first / factor >= sizeX || pnt.second / factor >= sizeY)
+		{
+			throw std::out_of_range("Point is out of the map");
+		}
+		return static_cast<size_t>((pnt.second / factor) * sizeX + pnt.first / factor);
+	};
+	const size_t start = toCell(from);
+	const size_t finish = toCell(to);
+	const float lowestCost = *std::min_element(level.cost.begin(), level.cost.end());
+	const int finishX = static_cast<int>(finish % sizeX);
+	const int finishY = static_cast<int>(finish / sizeX);
+	const double diagonal = std::sqrt(2.0);
+	auto estimate = [&](size_t cell) {
+		const int dX = std::abs(static_cast<int>(cell % sizeX) - finishX);
+		const int dY = std::abs(static_cast<int>(cell / sizeX) - finishY);
+		return (std::abs(dX - dY) + diagonal * std::min(dX, dY)) * factor * lowestCost;
+	};
+
+	// A* on the level. Time of a move is the distance by the average cost of two cells in the direction
+	const size_t NO_CELL = std::numeric_limits<size_t>::max();
+	std::vector<double> time(level.links.size(), std::numeric_limits<double>::infinity());
+	std::vector<size_t> parent(level.links.size(), NO_CELL);
+	using ItemT = std::pair<double, size_t>;
+	std::priority_queue<ItemT, std::vector<ItemT>, std::greater<ItemT>> queue;
+	time[start] = 0.0;
+	queue.push(std::make_pair(estimate(start), start));
+	while (!queue.empty())
+	{
+		const size_t cell = queue.top().second;
+		const double priority = queue.top().first;
+		queue.pop();
+		if (cell == finish)
+		{
+			break;
+		}
+		if (priority > time[cell] + estimate(cell))
+		{
+			continue;
+		}
+		const int x = static_cast<int>(cell % sizeX);
+		const int y = static_cast<int>(cell / sizeX);
+		for (int direction = 0; direction < 8; ++direction)
+		{
+			if (!(level.links[cell] & (1 << direction)))
+			{
+				continue;
+			}
+			const int dX = offset(direction)[0];
+			const int dY = offset(direction)[1];
+			const size_t neighbor = (y + dY) * sizeX + x + dX;
+			const double distance = (dX != 0 && dY != 0) ? diagonal : 1.0;
+			const double newTime = time[cell] +
+				distance * factor * 0.5 * (level.cost[cell * 8 + direction] + level.cost[neighbor * 8 + direction]);
+			if (newTime < time[neighbor])
+			{
+				time[neighbor] = newTime;
+				parent[neighbor] = cell;
+				queue.push(std::make_pair(newTime + estimate(neighbor), neighbor));
+			}
+		}
+	}
+	if (time[finish] == std::numeric_limits<double>::infinity())
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<CorridorMask> result(new CorridorMask(level.factor, width, level.sizeX, level.sizeY));
+	const int radius = static_cast<int>(width);
+	for (size_t cell = finish; cell != NO_CELL; cell = parent[cell])
+	{
+		const int x = static_cast<int>(cell % sizeX);
+		const int y = static_cast<int>(cell / sizeX);
+		for (int nY = std::max(0, y - radius); nY <= std::min(sizeY - 1, y + radius); ++nY)
+		{
+			for (int nX = std::max(0, x - radius); nX <= std::min(sizeX - 1, x + radius); ++nX)
+			{
+				result->add(nX, nY);
+			}
+		}
+	}
+	return result;
+}
+
+#endif // __CORRIDOR_H__
@@ -0,0 +1,415 @@
+#ifndef __DELTA_STEPPING_H__
+#define __DELTA_STEPPING_H__
+
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include <maps.h>
+#include <threads_barrier.h>
+#include "model.h"
+
+/** This class calculates time to arrive from one start point to every cell of the map (one-to-all).
+It is used for preprocessing where the whole map is needed: landmarks, isochrones, matrix rows, heatmaps.
+The simulation of move between cells is the same as in RouteBuilder (see time_prediction.h).
+
+Algorithm is a parallel Delta-stepping (U. Meyer, P. Sanders).
+Cells are sorted in buckets by time to arrive. The width of a bucket is Delta.
+Edges are split on light (time <= Delta) and heavy (time > Delta).
+1)	Take the lowest not empty bucket.
+2)	Relax light edges of its cells. It could add new cells in the same bucket - repeat until bucket is empty.
+3)	Relax heavy edges of all cells that were settled in the bucket. They never come to the same bucket.
+4)	Go to 1) while there are not empty buckets.
+Cells of a bucket are processed in parallel. Every cell has an owner thread (by stripes of rows).
+Each thread keeps its own bucket array with owned cells only. So no locks on buckets.
+Relaxation of an edge is an atomic min-update on the shared arrival time grid.
+If it succeeds, the cell is posted into outbox of the owner thread.
+Owners move posted cells from outboxes into own buckets after a barrier.
+
+Result is the same as result of a sequential Dijkstra. Both algorithms stop at the least solution of
+	time(to) = min(time(from) + timeToNeighbour(from, to)).
+The order of relaxations doesn't matter for it (tools/sssp_check.cpp makes sure on the real map).
+*/
+template<typename SimulationT>
+struct DeltaStepping
+{
+	static const double UNREACHABLE; // is NaN
+	static const TimeT DEFAULT_DELTA;// bucket width. Most of moves on the Island take 0.8..3, so they are light edges
+
+	DeltaStepping(const MapsModel& model, TimeT delta = DEFAULT_DELTA, size_t threadsCount = 0) :
+		m_sizeX(model.getSizeX()),
+		m_sizeY(model.getSizeY()),
+		m_simEngine(model.elevation(), model.overrides(), UNREACHABLE),
+		m_delta(delta),
+		m_threadsCount(threadsCount ? threadsCount : std::max<size_t>(1, std::thread::hardware_concurrency())),
+		m_timeToArrive(m_sizeX * m_sizeY),
+		m_workers(m_threadsCount),
+		m_current(0),
+		m_pending(false),
+		m_relaxedItems(0),
+		m_processedBuckets(0)
+	{
+		if (!(m_delta > 0))
+		{
+			throw std::invalid_argument("Delta should be > 0");
+		}
+	}
+
+	/// Calculates time to arrive from the start point to all cells of the map
+	void run(const PointT& start)
+	{
+		checkBoundaries(start);
+		for (auto& value : m_timeToArrive)
+		{
+			value.store(NOT_VISITED, std::memory_order_relaxed);
+		}
+		for (auto& worker : m_workers)
+		{
+			worker.reset(m_threadsCount);
+		}
+		m_current = 0;
+		m_pending = false;
+		m_processedBuckets = 0;
+
+		const uint32_t startCell = toCell(start);
+		m_timeToArrive[startCell].store(0.0, std::memory_order_relaxed);
+		m_workers[owner(startCell)].buckets[0].push_back(startCell);
+
+		ThreadsBarrier barrier(m_threadsCount);
+		std::vector<std::thread> threads;
+		for (size_t id = 1; id < m_threadsCount; ++id)
+		{
+			threads.emplace_back([this, id, &barrier]() { work(id, barrier); });
+		}
+		work(0, barrier);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		m_relaxedItems = 0;
+		for (auto& worker : m_workers)
+		{
+			m_relaxedItems += worker.relaxedItems;
+		}
+	}
+
+	/// \return time to arrive to the point from the last start point. NaN if there is no way.
+	TimeT get(const PointT& pnt) const
+	{
+		checkBoundaries(pnt);
+		auto value = m_timeToArrive[toCell(pnt)].load(std::memory_order_relaxed);
+		return (value == NOT_VISITED) ? UNREACHABLE : value;
+	}
+
+	/// Copy results into the map of the same format as RouteBuilder uses
+	void exportTo(RWMap& timeToArrive) const
+	{
+		for (int y = 0; y < static_cast<int>(m_sizeY); ++y)
+		{
+			for (int x = 0; x < static_cast<int>(m_sizeX); ++x)
+			{
+				auto pnt = std::make_pair(x, y);
+				timeToArrive.put(pnt, get(pnt));
+			}
+		}
+	}
+
+	size_t threadsCount() const { return m_threadsCount; }
+
+	size_t relaxedItems() const { return m_relaxedItems; }//statistic
+
+	size_t processedBuckets() const { return m_processedBuckets; }//statistic
+
+private:
+	static const size_t WINDOW = 1024; // buckets in the cyclic array of a worker. Farther cells wait in overflow list
+	static const int STRIPE_ROWS = 16; // rows of one stripe of owned cells
+	static const size_t NO_BUCKET = std::numeric_limits<size_t>::max();
+	static constexpr TimeT NOT_VISITED = std::numeric_limits<TimeT>::infinity(); // inf is simpler for atomic min than NaN
+
+	/// State of one thread. It is aligned to avoid false sharing between threads
+	struct alignas(64) Worker
+	{
+		std::vector<std::vector<uint32_t>> buckets; // cyclic array of buckets [bucket % WINDOW]
+		std::vector<uint32_t> overflow; // cells with bucket >= current + WINDOW
+		size_t overflowMin; // the lowest bucket in overflow list
+		std::vector<uint32_t> frontier; // cells of the current bucket in processing
+		std::vector<uint32_t> settled; // cells of the current bucket for relax of heavy edges
+		std::vector<std::vector<uint32_t>> outbox; // [owner] - cells with updated time for other threads
+		size_t nextBucket; // the lowest not empty bucket after the current
+		bool pending; // the current bucket is not empty
+		size_t relaxedItems; // statistic
+
+		void reset(size_t threadsCount)
+		{
+			buckets.assign(WINDOW, std::vector<uint32_t>());
+			overflow.clear();
+			overflowMin = NO_BUCKET;
+			frontier.clear();
+			settled.clear();
+			outbox.assign(threadsCount, std::vector<uint32_t>());
+			nextBucket = NO_BUCKET;
+			pending = false;
+			relaxedItems = 0;
+		}
+	};
+
+	void checkBoundaries(const PointT& pnt) const
+	{
+		if (pnt.first < 0 || pnt.second < 0 || pnt.first >= static_cast<int>(m_sizeX) || pnt.second >= static_cast<int>(m_sizeY))
+		{
+			throw std::out_of_range("Requested point out of range");
+		}
+	}
+
+	uint32_t toCell(const PointT& pnt) const
+	{
+		return static_cast<uint32_t>(m_sizeX * pnt.second + pnt.first);
+	}
+
+	PointT toPoint(uint32_t cell) const
+	{
+		return std::make_pair(static_cast<int>(cell % m_sizeX), static_cast<int>(cell / m_sizeX));
+	}
+
+	size_t owner(uint32_t cell) const
+	{
+		return (cell / m_sizeX / STRIPE_ROWS) % m_threadsCount;
+	}
+
+	size_t bucketOf(TimeT time) const
+	{
+		return static_cast<size_t>(time / m_delta);
+	}
+
+	void work(size_t id, ThreadsBarrier& barrier)
+	{
+		auto& worker = m_workers[id];
+		while (true)
+		{
+			// Light edges. Relaxed cells could come back to the current bucket
+			do
+			{
+				relaxBucket(worker);
+				barrier.wait();
+				collect(id);
+				barrier.wait([this]() {
+					m_pending = std::any_of(m_workers.begin(), m_workers.end(), [](const Worker& w) {return w.pending; });
+				});
+			} while (m_pending);
+
+			// Heavy edges of settled cells. They always go to the next buckets
+			relaxSettled(worker);
+			barrier.wait();
+			collect(id);
+			barrier.wait([this]() {
+				++m_processedBuckets;
+				m_current = NO_BUCKET;
+				for (const auto& w : m_workers)
+				{
+					m_current = std::min(m_current, w.nextBucket);
+				}
+			});
+			if (m_current == NO_BUCKET)
+			{
+				break;
+			}
+		}
+	}
+
+	void relaxBucket(Worker& worker)
+	{
+		if (worker.overflowMin < m_current + WINDOW)
+		{
+			// Window is moved. Some of far cells are in the window now
+			std::vector<uint32_t> overflow;
+			overflow.swap(worker.overflow);
+			worker.overflowMin = NO_BUCKET;
+			for (auto cell : overflow)
+			{
+				put(worker, cell);
+			}
+		}
+
+		worker.frontier.clear();
+		worker.frontier.swap(worker.buckets[m_current % WINDOW]);
+		for (auto cell : worker.frontier)
+		{
+			const TimeT time = m_timeToArrive[cell].load(std::memory_order_relaxed);
+			// Skip stale cells. They have got lower time and have been processed in previous buckets
+			if (bucketOf(time) != m_current)
+			{
+				continue;
+			}
+			worker.settled.push_back(cell);
+			relaxEdges(worker, cell, time, true);
+		}
+		worker.frontier.clear();
+	}
+
+	void relaxSettled(Worker& worker)
+	{
+		for (auto cell : worker.settled)
+		{
+			relaxEdges(worker, cell, m_timeToArrive[cell].load(std::memory_order_relaxed), false);
+		}
+		worker.settled.clear();
+	}
+
+	void relaxEdges(Worker& worker, uint32_t cell, TimeT time, bool isLight)
+	{
+		const PointT curPoint = toPoint(cell);
+		for (int dY = -1; dY <= 1; ++dY)
+		{
+			for (int dX = -1; dX <= 1; ++dX)
+			{
+				const PointT neighbor(curPoint.first + dX, curPoint.second + dY);
+				if ((dX == 0 && dY == 0) ||
+					neighbor.first < 0 || neighbor.second < 0 ||
+					neighbor.first >= static_cast<int>(m_sizeX) || neighbor.second >= static_cast<int>(m_sizeY))
+				{
+					continue;
+				}
+				// Skip not drivable neighbors
+				if (!m_simEngine.isDrivable(neighbor))
+				{
+					continue;
+				}
+				const TimeT timeForMove = m_simEngine.getTimeToNeighbour(curPoint, neighbor);
+				if ((timeForMove != timeForMove) || ((timeForMove <= m_delta) != isLight))
+				{
+					continue;
+				}
+				worker.relaxedItems += 1;
+				const TimeT newTime = time + timeForMove;
+				const uint32_t neighborCell = toCell(neighbor);
+				auto& value = m_timeToArrive[neighborCell];
+				TimeT oldTime = value.load(std::memory_order_relaxed);
+				while (newTime < oldTime)
+				{
+					if (value.compare_exchange_weak(oldTime, newTime, std::memory_order_relaxed))
+					{
+						worker.outbox[owner(neighborCell)].push_back(neighborCell);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	/// Move cells from all outboxes addressed to the thread into its buckets
+	void collect(size_t id)
+	{
+		auto& worker = m_workers[id];
+		for (auto& sender : m_workers)
+		{
+			auto& outbox = sender.outbox[id];
+			for (auto cell : outbox)
+			{
+				put(worker, cell);
+			}
+			outbox.clear();
+		}
+		worker.pending = !worker.buckets[m_current % WINDOW].empty();
+		worker.nextBucket = worker.overflowMin;
+		for (size_t bucket = m_current + 1; bucket < m_current + WINDOW; ++bucket)
+		{
+			if (!worker.buckets[bucket % WINDOW].empty())
+			{
+				worker.nextBucket = std::min(worker.nextBucket, bucket);
+				break;
+			}
+		}
+	}
+
+	void put(Worker& worker, uint32_t cell)
+	{
+		const size_t bucket = bucketOf(m_timeToArrive[cell].load(std::memory_order_relaxed));
+		if (bucket < m_current)
+		{
+			return; // stale - cell is already settled
+		}
+		if (bucket >= m_current + WINDOW)
+		{
+			worker.overflow.push_back(cell);
+			worker.overflowMin = std::min(worker.overflowMin, bucket);
+			return;
+		}
+		worker.buckets[bucket % WINDOW].push_back(cell);
+	}
+
+private:
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	const SimulationT m_simEngine;//< Simulation of move between points. It has to be read only to share between threads
+	const TimeT m_delta;//< width of bucket
+	const size_t m_threadsCount;
+	std::vector<std::atomic<TimeT>> m_timeToArrive;//< shared arrival time grid
+	std::vector<Worker> m_workers;
+	size_t m_current;//< the bucket in processing
+	bool m_pending;//< current bucket has cells after the last light phase
+	size_t m_relaxedItems;//statistic
+	size_t m_processedBuckets;//statistic
+};
+
+template<typename SimulationT>
+const double DeltaStepping<SimulationT>::UNREACHABLE = std::numeric_limits<double>::quiet_NaN();
+
+template<typename SimulationT>
+const TimeT DeltaStepping<SimulationT>::DEFAULT_DELTA = 4.0;
+
+template<typename SimulationT>
+constexpr TimeT DeltaStepping<SimulationT>::NOT_VISITED;
+
+/** Sequential one-to-all Dijkstra over the same simulation and queue as RouteBuilder::moveTo.
+It is the reference for the results of DeltaStepping.
+*/
+template<typename SimulationT, typename QueueT>
+void sequentialArrivalTimes(const MapsModel& model, const PointT& start, RWMap& timeToArrive)
+{
+	const TimeT unreachable = std::numeric_limits<TimeT>::quiet_NaN();
+	SimulationT simEngine(model.elevation(), model.overrides(), unreachable);
+	auto isLower = [](const TimeT& val1, const TimeT& val2) { return !(val1 != val1) && (val1 < val2); };
+
+	timeToArrive.reset();
+	timeToArrive.put(start, 0);
+	QueueT queue;
+	queue.push(0.0, std::make_pair(start, 0.0));
+	while (!queue.empty())
+	{
+		auto curNode = queue.front().second;
+		auto& curPoint = curNode.first;
+		auto& timeToPoint = curNode.second;
+		queue.pop();
+		// If the node is processed and has a lower time value - skip it
+		if (isLower(timeToArrive.get(curPoint), timeToPoint))
+		{
+			continue;
+		}
+		for (auto& neighbor : timeToArrive.getNeighbors(curPoint))
+		{
+			if (!simEngine.isDrivable(neighbor))
+			{
+				continue;
+			}
+			TimeT timeForMove = simEngine.getTimeToNeighbour(curPoint, neighbor);
+			if (timeForMove != timeForMove)
+			{
+				continue;
+			}
+			auto newTime = timeToPoint + timeForMove;
+			if (isLower(timeToArrive.get(neighbor), newTime))
+			{
+				continue;
+			}
+			timeToArrive.put(neighbor, newTime);
+			queue.push(newTime, std::make_pair(neighbor, newTime));
+		}
+	}
+}
+
+#endif // __DELTA_STEPPING_H__
@@ -0,0 +1,496 @@
+#ifndef __FIRST_MOVES_H__
+#define __FIRST_MOVES_H__
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include <maps.h>
+#include <route_codec.h>
+#include "model.h"
+
+/** Compressed path database of popular destinations: the first move of an optimal route from every cell.
+A route to a destination of the table is a walk by first moves, there is no search (see SearchOptions::firstMoves).
+The table of a destination is found by one backward Dijkstra from it over the whole map. A move of a cell is optimal
+if it leads to a neighbor whose time to the destination is less by the time of the move. Plains have a few of them.
+
+Moves are codes of RouteCodec::offset() (3 bits), NO_MOVE is for the destination and cells that can't reach it.
+Cells are ordered by the Morton curve (bits of x and y are interleaved), so neighbor cells are close in the order
+and their optimal moves are mostly the same. A table is a sorted list of runs along the curve, a run is as long as
+its cells have a common optimal move. It is 32 bits: the Morton index of its first cell << 4 | move.
+Cells that are not drivable are never walked, they don't break runs. A lookup is a binary search of the run of the cell.
+Dijkstras of destinations are independent, they run in parallel.
+File layout: FirstMovesHeader, Destination destinations[count], uint32_t runs[] of all destinations in their order.
+*/
+#pragma pack(push, 1)
+struct FirstMovesHeader
+{
+	char signature[8];
+	uint32_t version;
+	uint64_t mapChecksum;// MapsModel::checksum()
+	uint32_t sizeX;
+	uint32_t sizeY;
+	uint32_t count;// of destinations
+};
+#pragma pack(pop)
+
+struct FirstMoves
+{
+	static const uint32_t VERSION = 1;
+	static const uint8_t NO_MOVE = 8;
+
+	/** Runs backward Dijkstra from every destination by SimulationT rules of moves.
+		\param threadsCount 0 is all cores
+		\param progress it is called with count of done destinations, from any thread. It could be empty
+	*/
+	template<typename SimulationT>
+	static std::shared_ptr<const FirstMoves> build(const MapsModel& model, const std::vector<PointT>& destinations,
+													size_t threadsCount = 0, std::function<void(size_t)> progress = nullptr);
+
+	/// Tables stored by save(). The map of the model has to be the same
+	static std::shared_ptr<const FirstMoves> load(const std::string& filename, const MapsModel& model);
+
+	void save(const std::string& filename) const;
+
+	/// MapsModel::checksum() of the map of the tables. Snapshots with other overrides don't match it
+	uint64_t mapChecksum() const { return m_mapChecksum; }
+
+	bool contains(const PointT& destination) const { return m_index.count(destination) != 0; }
+
+	/// \return code of the first move of an optimal route from the cell to the destination or NO_MOVE
+	uint8_t firstMove(const PointT& from, const PointT& destination) const
+	{
+		const auto found = m_index.find(destination);
+		if (found == m_index.end() || from.first < 0 || from.second < 0 ||
+			static_cast<size_t>(from.first) >= m_sizeX || static_cast<size_t>(from.second) >= m_sizeY)
+		{
+			return NO_MOVE;
+		}
+		const uint32_t* begin = &m_runs[0] + m_offsets[found->second];
+		const uint32_t* end = &m_runs[0] + m_offsets[found->second + 1];
+		// The last run that starts not after the cell. The first run starts at 0
+		const uint32_t key = (morton(from) << MOVE_BITS) | MOVE_MASK;
+		return static_cast<uint8_t>(*(std::upper_bound(begin, end, key) - 1) & MOVE_MASK);
+	}
+
+	/** Route from the start to the destination by first moves. Times of moves are of the simulation.
+		\param steps points of the route without the start with times of moves to them (see RouteBuilder::forEachStep)
+		\return false if the destination is not in the tables or it can't be reached from the start
+	*/
+	template<typename SimulationT>
+	bool walk(const SimulationT& simEngine, const PointT& start, const PointT& destination, std::vector<MeasuredPointT>& steps) const;
+
+	/// Size of runs in memory and in the file
+	size_t bytes() const { return m_runs.size() * sizeof(uint32_t); }
+
+	size_t runs() const { return m_runs.size(); }
+
+	size_t count() const { return m_destinations.size(); }
+
+private:
+	/// Record of the file
+	struct Destination
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t runs;
+	};
+
+	FirstMoves(uint64_t mapChecksum, size_t sizeX, size_t sizeY) :
+		m_mapChecksum(mapChecksum),
+		m_sizeX(sizeX),
+		m_sizeY(sizeY)
+	{}
+
+	static uint32_t morton(const PointT& pnt)
+	{
+		return spread(static_cast<uint32_t>(pnt.first)) | (spread(static_cast<uint32_t>(pnt.second)) << 1);
+	}
+
+	/// Bits of the value are moved to even positions
+	static uint32_t spread(uint32_t value)
+	{
+		value &= 0xFFFF;
+		value = (value | (value << 8)) & 0x00FF00FF;
+		value = (value | (value << 4)) & 0x0F0F0F0F;
+		value = (value | (value << 2)) & 0x33333333;
+		value = (value | (value << 1)) & 0x55555555;
+		return value;
+	}
+
+	/// Bits of even positions of the value are moved to the lowest ones
+	static uint32_t compact(uint32_t value)
+	{
+		value &= 0x55555555;
+		value = (value | (value >> 1)) & 0x33333333;
+		value = (value | (value >> 2)) & 0x0F0F0F0F;
+		value = (value | (value >> 4)) & 0x00FF00FF;
+		value = (value | (value >> 8)) & 0x0000FFFF;
+		return value;
+	}
+
+	/// Side of the square of the Morton curve over the map
+	static size_t curveSide(size_t sizeX, size_t sizeY)
+	{
+		size_t side = 1;
+		while (side < std::max(sizeX, sizeY))
+		{
+			side *= 2;
+		}
+		return side;
+	}
+
+	void addIndex()
+	{
+		for (size_t id = 0; id < m_destinations.size(); ++id)
+		{
+			m_index[m_destinations[id]] = id;
+		}
+	}
+
+	/// State of Dijkstra of one thread. Only touched cells are reset
+	template<typename SimulationT>
+	struct Worker
+	{
+		explicit Worker(const MapsModel& model) :
+			simEngine(model.elevation(), model.overrides(), std::numeric_limits<TimeT>::quiet_NaN()),
+			times(model.getSizeX() * model.getSizeY(), std::numeric_limits<TimeT>::infinity())
+		{}
+
+		SimulationT simEngine;
+		std::vector<TimeT> times;
+		std::vector<uint32_t> touched;
+	};
+
+	/// \return runs of the table of the destination
+	template<typename SimulationT>
+	std::vector<uint32_t> search(Worker<SimulationT>& worker, const PointT& destination) const;
+
+	/** Bits of moves that start optimal routes from the drivable cell by times of the search, (1 << NO_MOVE) if there are none.
+		Sums of times are compared with a relative tolerance: the same route is summed in different orders.
+		The time to arrive strictly drops by every optimal move, so walks end at the destination.
+	*/
+	template<typename SimulationT>
+	uint16_t optimalMoves(const Worker<SimulationT>& worker, const PointT& pnt) const
+	{
+		const TimeT time = worker.times[pnt.second * m_sizeX + pnt.first];
+		if (time == 0.0 || time == std::numeric_limits<TimeT>::infinity())
+		{
+			return 1 << NO_MOVE;
+		}
+		uint16_t result = 0;
+		for (uint8_t code = 0; code < 8; ++code)
+		{
+			const PointT neighbor(pnt.first + RouteCodec::offset(code)[0], pnt.second + RouteCodec::offset(code)[1]);
+			if (neighbor.first < 0 || neighbor.second < 0 ||
+				static_cast<size_t>(neighbor.first) >= m_sizeX || static_cast<size_t>(neighbor.second) >= m_sizeY)
+			{
+				continue;
+			}
+			const TimeT move = worker.simEngine.getTimeToNeighbour(pnt, neighbor);
+			if (move == move && move + worker.times[neighbor.second * m_sizeX + neighbor.first] <= time * (1.0 + 1e-12))
+			{
+				result |= 1 << code;
+			}
+		}
+		return result;
+	}
+
+	static const uint32_t MOVE_BITS = 4;
+	static const uint32_t MOVE_MASK = 0xF;
+
+private:
+	const uint64_t m_mapChecksum;
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	std::vector<PointT> m_destinations;
+	std::map<PointT, size_t> m_index;// destination -> its id
+	std::vector<uint64_t> m_offsets;// first run of every destination in m_runs and the end of the last one
+	std::vector<uint32_t> m_runs;
+};
+
+template<typename SimulationT>
+std::shared_ptr<const FirstMoves> FirstMoves::build(const MapsModel& model, const std::vector<PointT>& destinations,
+													size_t threadsCount, std::function<void(size_t)> progress)
+{
+	const size_t side = curveSide(model.getSizeX(), model.getSizeY());
+	if (side * side > (static_cast<size_t>(std::numeric_limits<uint32_t>::max()) >> MOVE_BITS) + 1)
+	{
+		throw std::invalid_argument("The map is too large for first moves");
+	}
+	std::shared_ptr<FirstMoves> result(new FirstMoves(model.checksum(), model.getSizeX(), model.getSizeY()));
+	const SimulationT simEngine(model.elevation(), model.overrides(), std::numeric_limits<TimeT>::quiet_NaN());
+	for (const auto& destination : destinations)
+	{
+		if (destination.first < 0 || destination.second < 0 || static_cast<size_t>(destination.first) >= model.getSizeX() ||
+			static_cast<size_t>(destination.second) >= model.getSizeY() || !simEngine.isDrivable(destination))
+		{
+			throw std::invalid_argument("Destination of first moves is not drivable");
+		}
+		if (std::find(result->m_destinations.begin(), result->m_destinations.end(), destination) == result->m_destinations.end())
+		{
+			result->m_destinations.push_back(destination);
+		}
+	}
+
+	const size_t count = result->m_destinations.size();
+	std::vector<std::vector<uint32_t>> tables(count);
+	std::atomic<size_t> next(0);
+	std::atomic<size_t> done(0);
+	auto work = [&]() {
+		Worker<SimulationT> worker(model);
+		for (size_t id = next++; id < count; id = next++)
+		{
+			tables[id] = result->search(worker, result->m_destinations[id]);
+			const size_t doneCount = ++done;
+			if (progress)
+			{
+				progress(doneCount);
+			}
+		}
+	};
+	threadsCount = threadsCount ? threadsCount : std::max<size_t>(1, std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	for (size_t id = 1; id < std::min(threadsCount, count); ++id)
+	{
+		threads.push_back(std::thread(work));
+	}
+	work();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	result->m_offsets.push_back(0);
+	for (const auto& table : tables)
+	{
+		result->m_runs.insert(result->m_runs.end(), table.begin(), table.end());
+		result->m_offsets.push_back(result->m_runs.size());
+	}
+	result->addIndex();
+	return result;
+}
+
+template<typename SimulationT>
+std::vector<uint32_t> FirstMoves::search(Worker<SimulationT>& worker, const PointT& destination) const
+{
+	const int sizeX = static_cast<int>(m_sizeX);
+	const int sizeY = static_cast<int>(m_sizeY);
+	for (uint32_t id : worker.touched)
+	{
+		worker.times[id] = std::numeric_limits<TimeT>::infinity();
+	}
+	worker.touched.clear();
+
+	// Routes are backward: the cell is reached from the neighbor by the move of the neighbor to the cell
+	typedef std::pair<TimeT, uint32_t> NodeT;
+	std::priority_queue<NodeT, std::vector<NodeT>, std::greater<NodeT>> queue;
+	const uint32_t destinationId = static_cast<uint32_t>(destination.second * sizeX + destination.first);
+	worker.times[destinationId] = 0.0;
+	worker.touched.push_back(destinationId);
+	queue.push(std::make_pair(0.0, destinationId));
+	while (!queue.empty())
+	{
+		const NodeT node = queue.top();
+		queue.pop();
+		if (worker.times[node.second] < node.first)
+		{
+			continue;
+		}
+		const PointT pnt(static_cast<int>(node.second % sizeX), static_cast<int>(node.second / sizeX));
+		for (uint8_t code = 0; code < 8; ++code)
+		{
+			const PointT neighbor(pnt.first + RouteCodec::offset(code)[0], pnt.second + RouteCodec::offset(code)[1]);
+			if (neighbor.first < 0 || neighbor.second < 0 || neighbor.first >= sizeX || neighbor.second >= sizeY)
+			{
+				continue;
+			}
+			const TimeT time = worker.simEngine.getTimeToNeighbour(neighbor, pnt);
+			if (time != time)
+			{
+				continue;
+			}
+			const uint32_t neighborId = static_cast<uint32_t>(neighbor.second * sizeX + neighbor.first);
+			const TimeT newTime = node.first + time;
+			if (!(newTime < worker.times[neighborId]))
+			{
+				continue;
+			}
+			if (worker.times[neighborId] == std::numeric_limits<TimeT>::infinity())
+			{
+				worker.touched.push_back(neighborId);
+			}
+			worker.times[neighborId] = newTime;
+			queue.push(std::make_pair(newTime, neighborId));
+		}
+	}
+
+	// Runs along the curve. A run keeps the moves that are optimal for all of its cells, one of them is stored.
+	// Cells out of the map are skipped as not drivable ones
+	std::vector<uint32_t> runs;
+	uint32_t runStart = 0;
+	uint16_t runMoves = 0;
+	auto addRun = [&]() {
+		uint32_t move = 0;
+		while (!(runMoves & (1 << move)))
+		{
+			++move;
+		}
+		runs.push_back((runStart << MOVE_BITS) | move);
+	};
+	const size_t side = curveSide(m_sizeX, m_sizeY);
+	for (uint32_t index = 0; index < side * side; ++index)
+	{
+		const PointT pnt(static_cast<int>(compact(index)), static_cast<int>(compact(index >> 1)));
+		if (pnt.first >= sizeX || pnt.second >= sizeY || !worker.simEngine.isDrivable(pnt))
+		{
+			continue;
+		}
+		const uint16_t moves = optimalMoves(worker, pnt);
+		if (runMoves & moves)
+		{
+			runMoves &= moves;
+			continue;
+		}
+		if (runMoves)
+		{
+			addRun();
+		}
+		// The first run starts at 0 to cover cells before it
+		runStart = runMoves ? index : 0;
+		runMoves = moves;
+	}
+	if (!runMoves)
+	{
+		runMoves = 1 << NO_MOVE;
+	}
+	addRun();
+	return runs;
+}
+
+template<typename SimulationT>
+bool FirstMoves::walk(const SimulationT& simEngine, const PointT& start, const PointT& destination, std::vector<MeasuredPointT>& steps) const
+{
+	if (!contains(destination) || !simEngine.isDrivable(start))
+	{
+		return false;
+	}
+	const size_t firstStep = steps.size();
+	PointT pnt = start;
+	// Moves of the table are a tree of routes. More moves than cells is a table of another map
+	for (size_t count = 0; pnt != destination; ++count)
+	{
+		const uint8_t move = firstMove(pnt, destination);
+		if (move == NO_MOVE)
+		{
+			steps.resize(firstStep);
+			return false;
+		}
+		if (count == m_sizeX * m_sizeY)
+		{
+			throw std::logic_error("First moves don't lead to the destination");
+		}
+		const PointT next(pnt.first + RouteCodec::offset(move)[0], pnt.second + RouteCodec::offset(move)[1]);
+		const TimeT time = simEngine.getTimeToNeighbour(pnt, next);
+		if (time != time)
+		{
+			throw std::logic_error("First move is not drivable");
+		}
+		steps.push_back(std::make_pair(next, time));
+		pnt = next;
+	}
+	return true;
+}
+
+inline std::shared_ptr<const FirstMoves> FirstMoves::load(const std::string& filename, const MapsModel& model)
+{
+	std::ifstream in(filename, std::ifstream::binary);
+	if (!in.good())
+	{
+		throw std::runtime_error("Can't open first moves");
+	}
+	FirstMovesHeader header;
+	in.read((char*)&header, sizeof(header));
+	if (!in.good() || memcmp(header.signature, "ISLEFMOV", sizeof(header.signature)) != 0)
+	{
+		throw std::runtime_error("It is not a first moves file");
+	}
+	if (header.version != VERSION)
+	{
+		throw std::runtime_error("Unsupported version of first moves: " + std::to_string(header.version));
+	}
+	if (header.sizeX != model.getSizeX() || header.sizeY != model.getSizeY() || header.mapChecksum != model.checksum())
+	{
+		throw std::runtime_error("First moves are built for another map");
+	}
+	std::shared_ptr<FirstMoves> result(new FirstMoves(header.mapChecksum, header.sizeX, header.sizeY));
+	std::vector<Destination> destinations(header.count);
+	if (header.count)
+	{
+		in.read((char*)&destinations[0], destinations.size() * sizeof(Destination));
+	}
+	result->m_offsets.push_back(0);
+	for (const auto& destination : destinations)
+	{
+		if (destination.x >= header.sizeX || destination.y >= header.sizeY || destination.runs == 0)
+		{
+			throw std::runtime_error("Wrong destination of first moves");
+		}
+		result->m_destinations.push_back(PointT(static_cast<int>(destination.x), static_cast<int>(destination.y)));
+		result->m_offsets.push_back(result->m_offsets.back() + destination.runs);
+	}
+	result->m_runs.resize(static_cast<size_t>(result->m_offsets.back()));
+	if (!result->m_runs.empty())
+	{
+		in.read((char*)&result->m_runs[0], result->bytes());
+	}
+	if (!in.good())
+	{
+		throw std::runtime_error("First moves file is truncated");
+	}
+	result->addIndex();
+	return result;
+}
+
+inline void FirstMoves::save(const std::string& filename) const
+{
+	std::ofstream out(filename, std::ofstream::binary);
+	FirstMovesHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, "ISLEFMOV", sizeof(header.signature));
+	header.version = VERSION;
+	header.mapChecksum = m_mapChecksum;
+	header.sizeX = static_cast<uint32_t>(m_sizeX);
+	header.sizeY = static_cast<uint32_t>(m_sizeY);
+	header.count = static_cast<uint32_t>(m_destinations.size());
+	out.write((const char*)&header, sizeof(header));
+	for (size_t id = 0; id < m_destinations.size(); ++id)
+	{
+		const Destination destination = { static_cast<uint32_t>(m_destinations[id].first), static_cast<uint32_t>(m_destinations[id].second),
+			static_cast<uint32_t>(m_offsets[id + 1] - m_offsets[id]) };
+		out.write((const char*)&destination, sizeof(destination));
+	}
+	if (!m_runs.empty())
+	{
+		out.write((const char*)&m_runs[0], bytes());
+	}
+	out.flush();
+	if (!out.good())
+	{
+		throw std::runtime_error("Can't write first moves");
+	}
+}
+
+#endif // __FIRST_MOVES_H__
@@ -0,0 +1,343 @@
+#ifndef __GOAL_BOUNDS_H__
+#define __GOAL_BOUNDS_H__
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include <maps.h>
+#include "model.h"
+
+/** Goal bounding: offline pruning of moves that can't start an optimal route to the goal.
+For every drivable source cell and every of its 8 moves there is the bounding box of all cells whose optimal route
+from the source starts with this move. It is found by Dijkstra from the source over the whole map.
+RouteBuilder skips a move if the goal is out of its box (see SearchOptions::goalBounds).
+Routes stay optimal: the move of the Dijkstra tree of every cell towards the goal is never skipped,
+so the route along these moves is kept. Weighted and anytime searches keep their bounds too.
+
+There is one Dijkstra per source cell, it is the whole work. So sources are a rectangle of the map (the area).
+Moves of cells out of the area are never skipped. Searches that run inside the area take the speedup.
+Dijkstras of different sources are independent, they run in parallel.
+File layout: GoalBoundsHeader, Box boxes[area height][area width][8]. Boxes are for directions of offset().
+*/
+#pragma pack(push, 1)
+struct GoalBoundsHeader
+{
+	char signature[8];
+	uint32_t version;
+	uint64_t mapChecksum;// MapsModel::checksum()
+	uint32_t sizeX;
+	uint32_t sizeY;
+	uint32_t left;// area of sources
+	uint32_t top;
+	uint32_t width;
+	uint32_t height;
+};
+#pragma pack(pop)
+
+struct GoalBounds
+{
+	static const uint32_t VERSION = 1;
+
+	/// Inclusive box of cells. It is empty if minX > maxX
+	struct Box
+	{
+		uint16_t minX;
+		uint16_t minY;
+		uint16_t maxX;
+		uint16_t maxY;
+
+		bool contains(const PointT& pnt) const
+		{
+			return pnt.first >= minX && pnt.first <= maxX && pnt.second >= minY && pnt.second <= maxY;
+		}
+
+		void add(int x, int y)
+		{
+			minX = std::min<uint16_t>(minX, static_cast<uint16_t>(x));
+			minY = std::min<uint16_t>(minY, static_cast<uint16_t>(y));
+			maxX = std::max<uint16_t>(maxX, static_cast<uint16_t>(x));
+			maxY = std::max<uint16_t>(maxY, static_cast<uint16_t>(y));
+		}
+	};
+
+	/** Runs Dijkstra from every drivable cell of the area by SimulationT rules of moves.
+		\param threadsCount 0 is all cores
+		\param progress it is called with count of done sources, from any thread. It could be empty
+	*/
+	template<typename SimulationT>
+	static std::shared_ptr<const GoalBounds> build(const MapsModel& model, size_t left, size_t top, size_t width, size_t height,
+													size_t threadsCount = 0, std::function<void(size_t)> progress = nullptr);
+
+	/// Boxes stored by save(). The map of the model has to be the same
+	static std::shared_ptr<const GoalBounds> load(const std::string& filename, const MapsModel& model);
+
+	void save(const std::string& filename) const;
+
+	/// MapsModel::checksum() of the map of the boxes. Snapshots with other overrides don't match it
+	uint64_t mapChecksum() const { return m_mapChecksum; }
+
+	/// \return false if no optimal route from 'from' to the goal starts by the move to 'to'
+	bool mayLeadTo(const PointT& from, const PointT& to, const PointT& goal) const
+	{
+		if (!covers(from))
+		{
+			return true;
+		}
+		const size_t cell = (from.second - m_top) * m_width + (from.first - m_left);
+		return m_boxes[cell * 8 + direction(to.first - from.first, to.second - from.second)].contains(goal);
+	}
+
+	/// \return true if moves of the cell are bounded
+	bool covers(const PointT& pnt) const
+	{
+		return pnt.first >= static_cast<int>(m_left) && pnt.second >= static_cast<int>(m_top) &&
+			static_cast<size_t>(pnt.first) < m_left + m_width && static_cast<size_t>(pnt.second) < m_top + m_height;
+	}
+
+	/// Size of boxes in memory and in the file
+	size_t bytes() const { return m_boxes.size() * sizeof(Box); }
+
+private:
+	GoalBounds(uint64_t mapChecksum, size_t sizeX, size_t sizeY, size_t left, size_t top, size_t width, size_t height) :
+		m_mapChecksum(mapChecksum),
+		m_sizeX(sizeX),
+		m_sizeY(sizeY),
+		m_left(left),
+		m_top(top),
+		m_width(width),
+		m_height(height)
+	{}
+
+	/// Offset of the neighbor by direction. The same order as BaseMap::getNeighbors
+	static const int* offset(int direction)
+	{
+		static const int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+		return offsets[direction];
+	}
+
+	/// \return direction of offset
+	static int direction(int dX, int dY)
+	{
+		static const int directions[3][3] = { {0, 1, 2}, {6, -1, 7}, {3, 4, 5} };
+		return directions[dX + 1][dY + 1];
+	}
+
+	static Box emptyBox()
+	{
+		Box box;
+		box.minX = box.minY = std::numeric_limits<uint16_t>::max();
+		box.maxX = box.maxY = 0;
+		return box;
+	}
+
+	/// State of Dijkstra of one thread. Only touched cells are reset
+	template<typename SimulationT>
+	struct Worker
+	{
+		explicit Worker(const MapsModel& model) :
+			simEngine(model.elevation(), model.overrides(), std::numeric_limits<TimeT>::quiet_NaN()),
+			times(model.getSizeX() * model.getSizeY(), std::numeric_limits<TimeT>::infinity()),
+			firstMove(model.getSizeX() * model.getSizeY(), 0)
+		{}
+
+		SimulationT simEngine;
+		std::vector<TimeT> times;
+		std::vector<uint8_t> firstMove;// direction of the first move of the route from the source
+		std::vector<uint32_t> touched;
+	};
+
+	template<typename SimulationT>
+	void search(Worker<SimulationT>& worker, const PointT& source, Box* boxes) const;
+
+private:
+	const uint64_t m_mapChecksum;
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	const size_t m_left;
+	const size_t m_top;
+	const size_t m_width;
+	const size_t m_height;
+	std::vector<Box> m_boxes;// [cell of the area * 8 + direction]
+};
+
+template<typename SimulationT>
+std::shared_ptr<const GoalBounds> GoalBounds::build(const MapsModel& model, size_t left, size_t top, size_t width, size_t height,
+													size_t threadsCount, std::function<void(size_t)> progress)
+{
+	if (model.getSizeX() > std::numeric_limits<uint16_t>::max() || model.getSizeY() > std::numeric_limits<uint16_t>::max())
+	{
+		throw std::invalid_argument("The map is too large for goal bounds");
+	}
+	if (width == 0 || height == 0 || left + width > model.getSizeX() || top + height > model.getSizeY())
+	{
+		throw std::invalid_argument("Area of goal bounds is out of the map");
+	}
+	std::shared_ptr<GoalBounds> result(new GoalBounds(model.checksum(), model.getSizeX(), model.getSizeY(), left, top, width, height));
+	result->m_boxes.assign(width * height * 8, emptyBox());
+
+	const size_t count = width * height;
+	std::atomic<size_t> next(0);
+	std::atomic<size_t> done(0);
+	auto work = [&]() {
+		Worker<SimulationT> worker(model);
+		for (size_t cell = next++; cell < count; cell = next++)
+		{
+			const PointT source(static_cast<int>(left + cell % width), static_cast<int>(top + cell / width));
+			result->search(worker, source, &result->m_boxes[cell * 8]);
+			const size_t doneCount = ++done;
+			if (progress)
+			{
+				progress(doneCount);
+			}
+		}
+	};
+	threadsCount = threadsCount ? threadsCount : std::max<size_t>(1, std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	for (size_t id = 1; id < std::min(threadsCount, count); ++id)
+	{
+		threads.push_back(std::thread(work));
+	}
+	work();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	return result;
+}
+
+template<typename SimulationT>
+void GoalBounds::search(Worker<SimulationT>& worker, const PointT& source, Box* boxes) const
+{
+	if (!worker.simEngine.isDrivable(source))
+	{
+		return;
+	}
+	const int sizeX = static_cast<int>(m_sizeX);
+	const int sizeY = static_cast<int>(m_sizeY);
+	for (uint32_t id : worker.touched)
+	{
+		worker.times[id] = std::numeric_limits<TimeT>::infinity();
+	}
+	worker.touched.clear();
+
+	typedef std::pair<TimeT, uint32_t> NodeT;
+	std::priority_queue<NodeT, std::vector<NodeT>, std::greater<NodeT>> queue;
+	const uint32_t sourceId = static_cast<uint32_t>(source.second * sizeX + source.first);
+	worker.times[sourceId] = 0.0;
+	worker.touched.push_back(sourceId);
+	queue.push(std::make_pair(0.0, sourceId));
+	while (!queue.empty())
+	{
+		const NodeT node = queue.top();
+		queue.pop();
+		if (worker.times[node.second] < node.first)
+		{
+			continue;
+		}
+		const PointT pnt(static_cast<int>(node.second % sizeX), static_cast<int>(node.second / sizeX));
+		if (node.second != sourceId)
+		{
+			boxes[worker.firstMove[node.second]].add(pnt.first, pnt.second);
+		}
+		for (int direction = 0; direction < 8; ++direction)
+		{
+			const PointT neighbor(pnt.first + offset(direction)[0], pnt.second + offset(direction)[1]);
+			if (neighbor.first < 0 || neighbor.second < 0 || neighbor.first >= sizeX || neighbor.second >= sizeY)
+			{
+				continue;
+			}
+			const TimeT time = worker.simEngine.getTimeToNeighbour(pnt, neighbor);
+			if (time != time)
+			{
+				continue;
+			}
+			const uint32_t neighborId = static_cast<uint32_t>(neighbor.second * sizeX + neighbor.first);
+			const TimeT newTime = node.first + time;
+			if (!(newTime < worker.times[neighborId]))
+			{
+				continue;
+			}
+			if (worker.times[neighborId] == std::numeric_limits<TimeT>::infinity())
+			{
+				worker.touched.push_back(neighborId);
+			}
+			worker.times[neighborId] = newTime;
+			worker.firstMove[neighborId] = (node.second == sourceId) ? static_cast<uint8_t>(direction) : worker.firstMove[node.second];
+			queue.push(std::make_pair(newTime, neighborId));
+		}
+	}
+}
+
+inline std::shared_ptr<const GoalBounds> GoalBounds::load(const std::string& filename, const MapsModel& model)
+{
+	std::ifstream in(filename, std::ifstream::binary);
+	if (!in.good())
+	{
+		throw std::runtime_error("Can't open goal bounds");
+	}
+	GoalBoundsHeader header;
+	in.read((char*)&header, sizeof(header));
+	if (!in.good() || memcmp(header.signature, "ISLEGBND", sizeof(header.signature)) != 0)
+	{
+		throw std::runtime_error("It is not a goal bounds file");
+	}
+	if (header.version != VERSION)
+	{
+		throw std::runtime_error("Unsupported version of goal bounds: " + std::to_string(header.version));
+	}
+	if (header.sizeX != model.getSizeX() || header.sizeY != model.getSizeY() || header.mapChecksum != model.checksum())
+	{
+		throw std::runtime_error("Goal bounds are built for another map");
+	}
+	if (header.width == 0 || header.height == 0 ||
+		static_cast<uint64_t>(header.left) + header.width > header.sizeX || static_cast<uint64_t>(header.top) + header.height > header.sizeY)
+	{
+		throw std::runtime_error("Wrong area of goal bounds");
+	}
+	std::shared_ptr<GoalBounds> result(new GoalBounds(header.mapChecksum, header.sizeX, header.sizeY,
+		header.left, header.top, header.width, header.height));
+	result->m_boxes.resize(static_cast<size_t>(header.width) * header.height * 8);
+	in.read((char*)&result->m_boxes[0], result->bytes());
+	if (!in.good())
+	{
+		throw std::runtime_error("Goal bounds file is truncated");
+	}
+	return result;
+}
+
+inline void GoalBounds::save(const std::string& filename) const
+{
+	std::ofstream out(filename, std::ofstream::binary);
+	GoalBoundsHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, "ISLEGBND", sizeof(header.signature));
+	header.version = VERSION;
+	header.mapChecksum = m_mapChecksum;
+	header.sizeX = static_cast<uint32_t>(m_sizeX);
+	header.sizeY = static_cast<uint32_t>(m_sizeY);
+	header.left = static_cast<uint32_t>(m_left);
+	header.top = static_cast<uint32_t>(m_top);
+	header.width = static_cast<uint32_t>(m_width);
+	header.height = static_cast<uint32_t>(m_height);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)&m_boxes[0], bytes());
+	out.flush();
+	if (!out.good())
+	{
+		throw std::runtime_error("Can't write goal bounds");
+	}
+}
+
+#endif // __GOAL_BOUNDS_H__
@@ -0,0 +1,101 @@
+#ifndef __MAPS_STORE_H__
+#define __MAPS_STORE_H__
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <stdint.h>
+
+#include <rcu_pointer.h>
+#include "model.h"
+#include "corridor.h"
+
+/// Immutable version of maps: the model and tables derived from it. It is never changed after it is published
+struct MapSnapshot
+{
+	uint64_t version;// MapsModel::version()
+	std::shared_ptr<const MapsModel> model;
+	std::shared_ptr<const MapsPyramid> pyramid;// or nullptr if the store has no pyramid
+};
+
+/** Versions of maps that are updated under load (e.g. closures of roads come while routes are served).
+Readers take the current snapshot without locks (see RcuPointer) and keep it for the whole query,
+so a query sees one version of maps even if updates are published meanwhile.
+An update makes the next model by MapsModel::withOverrides and derived tables of it: connected components and
+the pyramid. The pyramid is recalculated only in dirty tiles around edited cells (see MapsPyramid::update).
+Components are global, they are shared if drivability is the same and are calculated again otherwise.
+All of it is done before the snapshot is published, so readers never see half-built tables.
+Updates are serialized, every one is based on the previous one. Old versions are freed with their last reader.
+Goal bounds, swamps and first moves are built for a map checksum. They don't match new versions and should be rebuilt offline,
+RouteBuilder ignores them for snapshots of other checksums.
+*/
+template<typename SimulationT>
+struct MapsStore
+{
+	/// \param pyramid snapshots have the pyramid of the coarse-to-fine search
+	explicit MapsStore(std::shared_ptr<const MapsModel> model, bool pyramid = false)
+		: m_current(makeSnapshot(model, (model && pyramid) ? MapsPyramid::build<SimulationT>(*model) : nullptr))
+	{}
+
+	MapsStore(const MapsStore&) = delete;
+	MapsStore& operator=(const MapsStore&) = delete;
+
+	/// \return the last published version. It is lock-free and could be called from any thread
+	std::shared_ptr<const MapSnapshot> current() const
+	{
+		return m_current.load();
+	}
+
+	/** Publishes the version with edits of overrides. It blocks until the version is built.
+		\return the version of the snapshot
+	*/
+	uint64_t update(const std::vector<OverrideEdit>& edits)
+	{
+		std::lock_guard<std::mutex> lock(m_updates);
+		const auto previous = m_current.load();
+		std::shared_ptr<const MapsModel> model = previous->model->withOverrides(edits);
+		model->components();
+		std::shared_ptr<const MapsPyramid> pyramid;
+		if (previous->pyramid)
+		{
+			std::vector<PointT> changed;
+			changed.reserve(edits.size());
+			for (const auto& edit : edits)
+			{
+				changed.push_back(edit.pnt);
+			}
+			pyramid = MapsPyramid::update<SimulationT>(*previous->pyramid, *model, changed);
+		}
+		auto snapshot = makeSnapshot(model, pyramid);
+		m_current.store(snapshot);
+		return snapshot->version;
+	}
+
+	/// The same as update in a background thread. Readers are served by the previous version until it is ready
+	std::future<uint64_t> updateAsync(const std::vector<OverrideEdit>& edits)
+	{
+		return std::async(std::launch::async, [this, edits]() { return update(edits); });
+	}
+
+private:
+	static std::shared_ptr<const MapSnapshot> makeSnapshot(std::shared_ptr<const MapsModel> model, std::shared_ptr<const MapsPyramid> pyramid)
+	{
+		if (!model)
+		{
+			throw std::invalid_argument("Snapshot should have a model");
+		}
+		std::shared_ptr<MapSnapshot> result(new MapSnapshot());
+		result->version = model->version();
+		result->model = model;
+		result->pyramid = pyramid;
+		return result;
+	}
+
+private:
+	RcuPointer<MapSnapshot> m_current;
+	std::mutex m_updates;// writers
+};
+
+#endif // __MAPS_STORE_H__
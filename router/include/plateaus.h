@@ -0,0 +1,164 @@
+#ifndef __PLATEAUS_H__
+#define __PLATEAUS_H__
+
+#include <memory>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include <maps.h>
+#include "model.h"
+
+/** Plateaus: cells of the map whose 3x3 neighborhood has one elevation (see SearchOptions::plateaus).
+Moves between these cells are uniform: straight ones take a, diagonal ones take b of the vehicle.
+The grid of them has many routes of the same time (moves in another order). A* relaxes all of them.
+
+Jump point search prunes moves of a plateau cell by the move it is reached from (its parent p).
+A move of the cell c to m is pruned if there is a route from p to m around c that is faster than p -> c -> m.
+Then c -> m is not a move of any optimal route: the route through p is faster. So all optimal routes are kept,
+times of routes are the same as of plain A*, and other pruning (goal bounds, swamps) is not broken.
+Routes around c are inside the 3x3 neighborhood of c, so they are uniform if a < b < 2 * a:
+	straight parent (1, 0): (0, +-1) is a diagonal from p (b < 2 * a), (-1, +-1) is straight from p (a < a + b).
+		Moves (1, 0), (1, 1), (1, -1) are left.
+	diagonal parent (1, 1): (0, -1) and (-1, 0) are straight from p (a < a + b), (-1, 1) is two straight moves from p
+		(2 * a < 2 * b) through (-1, 0) of c. If (-1, 0) is not drivable, the move is kept (a forced neighbor of JPS).
+		Moves (1, 1), (1, 0), (0, 1) and forced ones are left.
+Only dominated moves are pruned. JPS prunes moves of equal routes too, they are kept here: then a cell reached
+from two directions by the same time needs no extra state of the search. There are no jumps either,
+the path is extracted by times of all its cells.
+Plateaus depend on elevation only. They are the same for all vehicles and overrides of the map.
+*/
+struct PlateauMask
+{
+	/// Kept moves of a plateau cell. It is a range of neighbors for RouteBuilder
+	struct Moves
+	{
+		PointT points[5];
+		size_t count;
+
+		const PointT* begin() const { return points; }
+		const PointT* end() const { return points + count; }
+	};
+
+	static std::shared_ptr<const PlateauMask> build(const MapsModel& model)
+	{
+		std::shared_ptr<PlateauMask> result(new PlateauMask(model.getSizeX(), model.getSizeY()));
+		const MapExplorer& elevation = model.elevation();
+		const int sizeX = static_cast<int>(model.getSizeX());
+		const int sizeY = static_cast<int>(model.getSizeY());
+		for (int y = 1; y + 1 < sizeY; ++y)
+		{
+			for (int x = 1; x + 1 < sizeX; ++x)
+			{
+				const uint8_t height = elevation.get(PointT(x, y));
+				bool flat = true;
+				for (int dY = -1; flat && dY <= 1; ++dY)
+				{
+					for (int dX = -1; flat && dX <= 1; ++dX)
+					{
+						flat = (elevation.get(PointT(x + dX, y + dY)) == height);
+					}
+				}
+				if (flat)
+				{
+					const size_t id = static_cast<size_t>(y) * result->m_sizeX + x;
+					result->m_bits[id / 64] |= uint64_t(1) << (id % 64);
+					result->m_count += 1;
+				}
+			}
+		}
+		return result;
+	}
+
+	/// \return true if the cell and its neighbors have one elevation. Cells at edges of the map are not in plateaus
+	bool contains(const PointT& pnt) const
+	{
+		if (pnt.first < 0 || pnt.second < 0 || static_cast<size_t>(pnt.first) >= m_sizeX || static_cast<size_t>(pnt.second) >= m_sizeY)
+		{
+			return false;
+		}
+		const size_t id = static_cast<size_t>(pnt.second) * m_sizeX + pnt.first;
+		return (m_bits[id / 64] >> (id % 64)) & 1;
+	}
+
+	/** Calls function(cell) for plateau cells until it returns true.
+		\return false if the function returns false for all of them
+	*/
+	template<typename FunctionT>
+	bool find(FunctionT function) const
+	{
+		for (size_t word = 0; word < m_bits.size(); ++word)
+		{
+			for (size_t bit = 0; bit < 64 && (m_bits[word] >> bit); ++bit)
+			{
+				const size_t id = word * 64 + bit;
+				if (((m_bits[word] >> bit) & 1) && function(PointT(static_cast<int>(id % m_sizeX), static_cast<int>(id / m_sizeX))))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	/** Moves of the plateau cell that are not pruned.
+		\param dX, dY the move of the parent to the cell
+		\param isDrivable it tells if a neighbor of the cell is drivable
+	*/
+	template<typename DrivableT>
+	static void moves(const PointT& cell, int dX, int dY, DrivableT isDrivable, Moves& result)
+	{
+		result.count = 0;
+		auto add = [&](int x, int y) { result.points[result.count++] = PointT(cell.first + x, cell.second + y); };
+		if (dY == 0)
+		{
+			add(dX, 0);
+			add(dX, 1);
+			add(dX, -1);
+			return;
+		}
+		if (dX == 0)
+		{
+			add(0, dY);
+			add(1, dY);
+			add(-1, dY);
+			return;
+		}
+		add(dX, dY);
+		add(dX, 0);
+		add(0, dY);
+		if (!isDrivable(PointT(cell.first - dX, cell.second)))
+		{
+			add(-dX, dY);
+		}
+		if (!isDrivable(PointT(cell.first, cell.second - dY)))
+		{
+			add(dX, -dY);
+		}
+	}
+
+	size_t getSizeX() const { return m_sizeX; }
+
+	size_t getSizeY() const { return m_sizeY; }
+
+	/// Count of plateau cells
+	size_t count() const { return m_count; }
+
+	size_t bytes() const { return m_bits.size() * sizeof(uint64_t); }
+
+private:
+	PlateauMask(size_t sizeX, size_t sizeY) :
+		m_sizeX(sizeX),
+		m_sizeY(sizeY),
+		m_count(0),
+		m_bits((sizeX * sizeY + 63) / 64, 0)
+	{}
+
+private:
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	size_t m_count;
+	std::vector<uint64_t> m_bits;// bit of the cell y * sizeX + x
+};
+
+#endif // __PLATEAUS_H__
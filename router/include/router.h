@@ -4,14 +4,197 @@
 #include <utility>
 #include <list>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <future>
 #include <limits>
 #include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string.h>
+#include <vector>
 
+#include <arena.h>
 #include <maps.h>
+#include <static_maps.h>
+#include <sparse_map.h>
+#include <tiled_map.h>
 #include <path.h>
+#include <perf_counters.h>
+#include <prioritized_queue.h>
+#include <query_log.h>
 #include "model.h"
+#include "corridor.h"
+#include "goal_bounds.h"
+#include "swamps.h"
+#include "climb_bound.h"
+#include "first_moves.h"
+#include "plateaus.h"
+#include "alternatives.h"
+#include "target_grid.h"
+#include "maps_store.h"
 #include "maps_viewer.h"
 
+/// Cooperative cancellation of a query. The owner cancels it from any thread, the search checks it periodically
+struct CancellationToken
+{
+	CancellationToken() : m_cancelled(false)
+	{}
+
+	void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+	bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<bool> m_cancelled;
+};
+
+/// Progress of a running query
+struct SearchProgress
+{
+	SearchProgress() : explored(0), best(-1, -1), bestTime(0.0), bestRemaining(std::numeric_limits<TimeT>::infinity())
+	{}
+
+	size_t explored;// nodes taken from the queue
+	PointT best;// expanded node that is the closest to the destination by the estimation
+	TimeT bestTime;// time to arrive to the best node
+	TimeT bestRemaining;// minimal time to arrive from the best node to the destination
+};
+
+/// Options of RouteBuilder::moveTo
+struct SearchOptions
+{
+	SearchOptions() :
+		epsilon(0.0),
+		anytime(false),
+		epsilonStep(0.5),
+		deadline(std::chrono::steady_clock::time_point::max()),
+		state(SS_AUTO)
+	{}
+
+	/// Weighted A*: time of the route is within (1 + epsilon) of the optimal one. 0 is the optimal route
+	TimeT epsilon;
+	/// Anytime mode: the first route is found with epsilon quickly. Then epsilon is decreased by epsilonStep 
+	/// and the route is improved until the deadline or until it is optimal
+	bool anytime;
+	TimeT epsilonStep;
+	/// The search is stopped at the deadline. Anytime mode keeps the route of the last pass, other modes find nothing
+	std::chrono::steady_clock::time_point deadline;
+	/// The search is stopped and finds nothing if the token is cancelled
+	std::shared_ptr<const CancellationToken> cancellation;
+	/// It is called from the search thread every RouteBuilder::DEADLINE_CHECK_PERIOD expansions
+	std::function<void(const SearchProgress&)> progress;
+	/// Search state backend. SS_AUTO takes the sparse one for queries not longer than SPARSE_DISTANCE_LIMIT,
+	/// the tiled one for longer queries on tiled maps and the dense one for others
+	enum StateBackend
+	{
+		SS_AUTO,
+		SS_DENSE,   ///< grid of the whole map (ArrivalMapT of RouteBuilder)
+		SS_SPARSE,  ///< hash of visited cells (SparseRWMap)
+		SS_TILED    ///< tiles of the grid allocated on the first write (TiledRWMap). Memory scales with the explored area
+	};
+	StateBackend state;
+	/// Coarse-to-fine search: the search is restricted by the corridor (see MapsPyramid::corridor).
+	/// The route is optimal (or bounded) inside the corridor. The whole map is searched if there is no way inside.
+	std::shared_ptr<const CorridorMask> corridor;
+	/// Moves that can't start an optimal route to the destination are skipped (see GoalBounds). Routes stay optimal.
+	/// Bounds of another map (e.g. a snapshot of MapsStore with closures) are not used
+	std::shared_ptr<const GoalBounds> goalBounds;
+	/// Swamps are not entered unless the start or the destination is inside (see SwampRegions). Routes stay optimal.
+	/// Swamps of another map are not used
+	std::shared_ptr<const SwampRegions> swamps;
+	/// The estimation of time to arrive takes the climb to the destination (see ClimbBound). Routes stay optimal.
+	/// It should be built for the vehicle of the query
+	std::shared_ptr<const ClimbBound> climbBound;
+	/// Destinations of the tables are reached by their first moves without search (see FirstMoves). Routes stay optimal.
+	/// Other destinations and snapshots of other maps are searched as usual
+	std::shared_ptr<const FirstMoves> firstMoves;
+	/// Dominated moves of flat plateaus are skipped (see PlateauMask). Routes stay optimal.
+	/// Suboptimal searches and searches in a corridor expand all moves
+	std::shared_ptr<const PlateauMask> plateaus;
+	/// Vehicle of the query (see VehicleCosts::compile). nullptr is the default vehicle of the simulation.
+	/// Goal bounds, swamps and first moves are built for the default vehicle, they can't be used with other ones
+	std::shared_ptr<const VehicleCosts> vehicle;
+};
+
+/// Result of RouteBuilder::moveTo
+struct SearchResult
+{
+	SearchResult() : found(false), time(0.0), bound(1.0), iterations(0), expansions(0), corridorFallback(false), stateBytes(0),
+		timedOut(false), cancelled(false), pruned(0)
+	{}
+
+	bool found;
+	TimeT time;// time to arrive to the destination
+	TimeT bound;// achieved bound: time <= bound * optimal time. It is 1 for the optimal route
+	size_t iterations;// passes of search. More than 1 in anytime mode
+	size_t expansions;// nodes taken from the queue
+	bool corridorFallback;// there was no way inside the corridor. The whole map was searched
+	size_t stateBytes;// memory of times to arrive of the search
+	bool timedOut;// a pass of the search was stopped by the deadline
+	bool cancelled;// the search was stopped by the cancellation token
+	size_t pruned;// moves skipped by goal bounds, swamps and plateaus
+	PerfCounts searchCounts;// hardware counters of the search (see RouteBuilder::setPerfCounters)
+	PerfCounts pathCounts;// hardware counters of the path extraction
+};
+
+/// Target of RouteBuilder::nearest
+struct NearestTarget
+{
+	size_t index;// in targets of the query
+	TimeT time;// time to arrive
+	std::vector<MeasuredPointT> steps;// route without the start: points with times of moves to them (see RouteBuilder::forEachStep)
+};
+
+/// Length of the route of RouteBuilder. RouteBuilder::rollback drops legs driven after it
+struct RouteMark
+{
+	size_t stops;// stop points
+	size_t steps;// points of the path
+};
+
+/// Creates a map of times to arrive for RouteBuilder. Maps with compile-time predicates need only sizes
+template<typename MapT>
+struct ArrivalMapFactory
+{
+	static MapT create(size_t sizeX, size_t sizeY, TimeT /*unreachable*/)
+	{
+		return MapT(sizeX, sizeY);
+	}
+};
+
+template<>
+struct ArrivalMapFactory<RWMap>
+{
+	static RWMap create(size_t sizeX, size_t sizeY, TimeT unreachable)
+	{
+		return RWMap(sizeX, sizeY, unreachable,
+					std::function<bool(const TimeT&)>([](TimeT t) {return t != t; })); // t is Nan if t != t
+	}
+};
+
+/// Creates a queue of RouteBuilder. Queues with ArenaAllocator take nodes from the arena of the query.
+template<typename QueueT>
+struct QueueFactory
+{
+	static QueueT create(Arena& /*arena*/)
+	{
+		return QueueT();
+	}
+};
+
+template<typename PriorityT, typename ValueT>
+struct QueueFactory<ArenaPrioritizedQueue<PriorityT, ValueT>>
+{
+	static ArenaPrioritizedQueue<PriorityT, ValueT> create(Arena& arena)
+	{
+		return ArenaPrioritizedQueue<PriorityT, ValueT>(ArenaAllocator<std::pair<const PriorityT, ValueT>>(arena));
+	}
+};
+
 /** This class implements logic of optimal path build
 The idea is simple
 1)	calculate path from the Current point to a new destination
@@ -40,8 +223,19 @@ The algorithm is stop to work if
 1)	the queue processing is over
 2)	Destination point has value to arrive point that is lower than any value of neighbors in queue.
 There is no path to destination point if the value of it DEAFAULT after finish of the queue processing.
+
+SearchOptions trade the quality of the route for speed: weighted A* with 1 + epsilon weight of the estimation
+and anytime search (ARA*) that improves the route until the deadline. lastResult() tells the achieved bound.
+A corridor from a coarse route (corridor.h) restricts the search to cells near it.
+moveToAsync runs the query in another thread. The deadline and the cancellation token stop it, the search state is
+reset by the next query anyway. setQueryLog captures queries for tools/route_replay.cpp.
+
+ArrivalMapT is a map of times to arrive. RWMap is configured at runtime.
+StaticRWMap (static_maps.h) together with StaticEvaluationStategy makes the hot path known at compile time.
+Short queries keep times to arrive in SparseRWMap (sparse_map.h) instead. The dense map is created by the first long query.
+Long queries on tiled maps keep them in TiledRWMap (tiled_map.h): the dense map of them could be larger than memory.
 */
-template<typename SimulationT, typename QueueT>
+template<typename SimulationT, typename QueueT, typename ArrivalMapT = RWMap>
 struct RouteBuilder
 {	
 	static const double UNREACHABLE; // is NaN
@@ -53,95 +247,1011 @@ struct RouteBuilder
 		return val != val;
 	}
 
-	RouteBuilder(MapsModel& model, visualizer::MapsViewer& viewer, const PointT& start):
-		m_model(model),
+	RouteBuilder(const MapsModel& model, visualizer::MapsViewer& viewer, const PointT& start):
+		m_model(&model),
+		m_store(nullptr),
 		m_viewer(viewer),
-		m_timeToArrive(model.getSizeX(), model.getSizeY(), UNREACHABLE,
-						std::function<bool(const TimeT&)>([](TimeT t) {return t != t; })), // t is Nan if t != t
-		m_simEngine(model.elevation(), model.overrides(), UNREACHABLE),
+		m_sparseTimeToArrive(model.getSizeX(), model.getSizeY()),
+		m_simEngine(new SimulationT(model.elevation(), model.overrides(), UNREACHABLE)),
+		m_baseRoutePoints(ArenaAllocator<PointT>(m_routeArena)),
+		m_path(ArenaAllocator<std::pair<const PointT, TimeT>>(m_routeArena)),
+		m_steps(ArenaAllocator<MeasuredPointT>(m_routeArena)),
 		m_totalCheckedItems(0),
 		m_enquedItems(0),
-		m_cutted(0)
+		m_cutted(0),
+		m_rejected(0),
+		m_pruned(0),
+		m_perfCounters(false),
+		m_corridor(nullptr),
+		m_goalBounds(nullptr),
+		m_swamps(nullptr),
+		m_climb(nullptr),
+		m_plateaus(nullptr),
+		m_flatStraight(UNREACHABLE),
+		m_flatDiagonal(UNREACHABLE),
+		m_finishElevation(0),
+		m_startSwamp(SwampRegions::NO_SWAMP),
+		m_finishSwamp(SwampRegions::NO_SWAMP)
 	{
 		m_baseRoutePoints.push_back(start);
 	}
 
+	/// Maps are taken from the store. Every query takes the current snapshot and sees one version of maps
+	RouteBuilder(const MapsStore<SimulationT>& store, visualizer::MapsViewer& viewer, const PointT& start):
+		RouteBuilder(*store.current()->model, viewer, start)
+	{
+		m_store = &store;
+		bindSnapshot(store.current());
+	}
+
 	/*! Build path to a new point on the map
 		\return true if a path is found. In other cases returns false.
 	*/
 	bool moveTo(const PointT& finishPnt)
 	{
-		m_timeToArrive.reset();
-		if (!m_simEngine.isDrivable(finishPnt))
+		return moveTo(finishPnt, SearchOptions());
+	}
+
+	/*! Build path to a new point on the map with bounded suboptimal or anytime search (see SearchOptions)
+		\return true if a path is found. In other cases returns false. Details are in lastResult().
+	*/
+	bool moveTo(const PointT& finishPnt, const SearchOptions& options)
+	{
+		if (!m_queryLog)
+		{
+			return route(finishPnt, options);
+		}
+		const PointT startPnt = m_baseRoutePoints.back();
+		const auto begin = ClockT::now();
+		const bool found = route(finishPnt, options);
+		logQuery(startPnt, finishPnt, options, begin);
+		return found;
+	}
+
+	/*! Build path to a new point on the map in another thread. The builder must not be used until the future is ready.
+		The route is added as by moveTo if it is found. Exceptions of the search are passed through the future.
+		\return details of the query as lastResult()
+	*/
+	std::future<SearchResult> moveToAsync(const PointT& finishPnt, const SearchOptions& options)
+	{
+		return std::async(std::launch::async, [this, finishPnt, options]() {
+			moveTo(finishPnt, options);
+			return m_lastResult;
+		});
+	}
+
+	/*! Finds the nearest of targets by time to arrive with one search (e.g. the closest of charging points).
+		It is Dijkstra with the estimation to the closest remaining target (see TargetGrid). A target is settled when
+		no node in the queue could lead to it faster. The search stops when count targets are settled.
+		The route is not changed, moveTo drives to the chosen target.
+		Options of one destination (corridor, goal bounds, swamps, climb bound, first moves), plateaus and suboptimal searches
+		are not supported.
+		Targets that are not drivable or are on another island fragment are skipped.
+		\return up to count targets ordered by time. Targets settled before the deadline are returned if the search is stopped
+	*/
+	std::vector<NearestTarget> nearest(const std::vector<PointT>& targets, size_t count, const SearchOptions& options = SearchOptions())
+	{
+		m_lastResult = SearchResult();
+		syncSnapshot();
+		if (options.corridor || options.goalBounds || options.swamps || options.climbBound || options.firstMoves ||
+			options.plateaus || options.epsilon != 0 || options.anytime)
+		{
+			throw std::invalid_argument("Nearest targets are found by the optimal search without options of one destination");
+		}
+		m_simEngine->setVehicle(options.vehicle);
+		const PointT startPnt = m_baseRoutePoints.back();
+		const bool otherVehicle = options.vehicle && options.vehicle != VehicleCosts::standard();
+		const bool checkComponents = m_model->hasComponents() &&
+			(!otherVehicle || options.vehicle->isRestrictionOf(*VehicleCosts::standard()));
+		TargetGrid grid(m_model->getSizeX(), m_model->getSizeY(), targets.size());
+		for (size_t id = 0; id < targets.size(); ++id)
+		{
+			if (m_simEngine->isDrivable(targets[id]) && (!checkComponents || m_model->components().mayReach(startPnt, targets[id])))
+			{
+				grid.add(targets[id], id);
+			}
+		}
+		std::vector<NearestTarget> result;
+		m_progress = SearchProgress();
+		if (grid.empty() || count == 0)
+		{
+			return result;
+		}
+
+		m_queryArena.release();
+		const size_t enquedBefore = m_enquedItems;
+		PerfPhase phase(m_perfCounters);
+		if (options.state == SearchOptions::SS_SPARSE)
+		{
+			SearchState<SparseMapT> state = { m_sparseTimeToArrive, m_sparseClosedPass };
+			nearestSearch(state, startPnt, grid, count, options, result);
+			m_lastResult.stateBytes = m_sparseTimeToArrive.allocatedBytes();
+		}
+		else if (useTiledState(options.state))
+		{
+			SearchState<TiledMapT> state = { tiledTimeToArrive(), m_tiledClosedPass };
+			nearestSearch(state, startPnt, grid, count, options, result);
+			m_lastResult.stateBytes = m_tiledTimeToArrive->allocatedBytes();
+		}
+		else
+		{
+			if (!m_timeToArrive)
+			{
+				m_timeToArrive.reset(new ArrivalMapT(ArrivalMapFactory<ArrivalMapT>::create(m_model->getSizeX(), m_model->getSizeY(), UNREACHABLE)));
+			}
+			SearchState<ArrivalMapT> state = { *m_timeToArrive, m_closedPass };
+			nearestSearch(state, startPnt, grid, count, options, result);
+			m_lastResult.stateBytes = m_model->getSizeX() * m_model->getSizeY() * sizeof(TimeT);
+		}
+		// Paths are extracted while targets are settled, they are counted with the search
+		phase.stop(m_lastResult.searchCounts);
+		m_lastResult.expansions = m_enquedItems - enquedBefore;
+		m_lastResult.iterations = 1;
+		m_lastResult.found = !result.empty();
+		m_lastResult.time = result.empty() ? 0.0 : result.front().time;
+		return result;
+	}
+
+	/*! Finds routes to the destination that are alternatives of the optimal one by the plateau method (see AlternativeRoutes).
+		There are two searches bounded by the stretch of alternatives, whatever the count of them.
+		The route is not changed. Alternatives are local optimal: their parts not longer than AlternativeRoute::plateau are optimal.
+		\param state backend of maps of trees. It is chosen as the search state of moveTo (see SearchOptions::state)
+		\return up to count routes: the optimal one and alternatives ordered by time. Nothing if the destination is not reached
+	*/
+	std::vector<AlternativeRoute> alternatives(const PointT& finishPnt, size_t count, const AlternativeOptions& options = AlternativeOptions(),
+												SearchOptions::StateBackend state = SearchOptions::SS_AUTO)
+	{
+		m_lastResult = SearchResult();
+		syncSnapshot();
+		m_simEngine->setVehicle(options.vehicle);
+		const PointT startPnt = m_baseRoutePoints.back();
+		const bool otherVehicle = options.vehicle && options.vehicle != VehicleCosts::standard();
+		const bool checkComponents = m_model->hasComponents() &&
+			(!otherVehicle || options.vehicle->isRestrictionOf(*VehicleCosts::standard()));
+		if (!m_simEngine->isDrivable(startPnt) || !m_simEngine->isDrivable(finishPnt))
+		{
+			return std::vector<AlternativeRoute>();
+		}
+		if (checkComponents && !m_model->components().mayReach(startPnt, finishPnt))
+		{
+			m_rejected += 1;
+			return std::vector<AlternativeRoute>();
+		}
+		m_queryArena.release();
+		std::vector<AlternativeRoute> result;
+		if (useSparseState(startPnt, finishPnt, state))
+		{
+			result = findAlternatives(m_sparseAlternatives, startPnt, finishPnt, count, options);
+		}
+		else if (useTiledState(state))
+		{
+			result = findAlternatives(m_tiledAlternatives, startPnt, finishPnt, count, options);
+		}
+		else
+		{
+			result = findAlternatives(m_alternatives, startPnt, finishPnt, count, options);
+		}
+		m_lastResult.found = !result.empty();
+		m_lastResult.time = result.empty() ? 0.0 : result.front().time;
+		return result;
+	}
+
+	/// \return details of the last moveTo, nearest or alternatives
+	const SearchResult& lastResult() const { return m_lastResult; }
+
+	/// \return maps of the last query or nullptr if the builder is not on a store
+	std::shared_ptr<const MapSnapshot> snapshot() const { return m_snapshot; }
+
+	/// \return the last stop point of the route
+	const PointT& location() const { return m_baseRoutePoints.back(); }
+
+	/// Every moveTo is appended to the log (see query_log.h). nullptr stops capture
+	void setQueryLog(std::shared_ptr<QueryLogWriter> queryLog)
+	{
+		m_queryLog = queryLog;
+	}
+
+	/** Hardware counters of phases of queries are reported in lastResult() and lastRenderCounts() (see perf_counters.h).
+		They are not read if counters are disabled or not available
+	*/
+	void setPerfCounters(bool enabled)
+	{
+		m_perfCounters = enabled;
+	}
+
+	/// \return hardware counters of the last showRoute or renderRoute
+	const PerfCounts& lastRenderCounts() const { return m_renderCounts; }
+
+	/// Forgets the route. The next moveTo starts from the start point. Search state and memory are kept
+	void restart(const PointT& start)
+	{
+		m_path.clear();
+		m_steps.clear();
+		m_baseRoutePoints.clear();
+		m_baseRoutePoints.push_back(start);
+	}
+
+	/// \return the mark of the current route for rollback()
+	RouteMark mark() const
+	{
+		RouteMark result = { m_baseRoutePoints.size(), m_steps.size() };
+		return result;
+	}
+
+	/// Drops legs driven after the mark. Memory of them is kept until the builder is destroyed
+	void rollback(const RouteMark& mark)
+	{
+		if (mark.stops == 0 || mark.stops > m_baseRoutePoints.size() || mark.steps > m_steps.size())
+		{
+			throw std::invalid_argument("The mark is not of the current route");
+		}
+		m_baseRoutePoints.resize(mark.stops);
+		m_steps.resize(mark.steps);
+		// Times of points visited twice are of the last visit. They are restored by the drive again
+		m_path.clear();
+		for (const auto& step : m_steps)
+		{
+			m_path.add(step.first, step.second);
+		}
+	}
+
+	/** Calls function(point, time of the move to the point) for points of the route in order of the drive.
+		The first one is the start point with 0 time. It is a source of RouteCodec (see route_codec.h)
+	*/
+	template<typename FunctionT>
+	void forEachStep(FunctionT function) const
+	{
+		function(m_baseRoutePoints.front(), 0.0);
+		for (const auto& step : m_steps)
+		{
+			function(step.first, step.second);
+		}
+	}
+
+	/// \return detailed path with points and estimation time for drive though each one.
+	void showRoute()
+	{
+		PerfPhase phase(m_perfCounters);
+		m_renderCounts = PerfCounts();
+		m_viewer.showRoute(m_path, m_baseRoutePoints);
+		phase.stop(m_renderCounts);
+	}
+
+	/// Renders the route into an image (see MapsViewer::renderRoute)
+	visualizer::Image renderRoute(const visualizer::RenderOptions& options)
+	{
+		PerfPhase phase(m_perfCounters);
+		m_renderCounts = PerfCounts();
+		auto image = m_viewer.renderRoute(m_path, m_baseRoutePoints, options);
+		phase.stop(m_renderCounts);
+		return image;
+	}
+private:
+	using SparseMapT = SparseRWMap<>;
+	using TiledMapT = TiledRWMap<>;
+	using ClockT = std::chrono::steady_clock;
+
+	/// Maps of the snapshot are taken by the search. The snapshot is kept until the next one
+	void bindSnapshot(std::shared_ptr<const MapSnapshot> snapshot)
+	{
+		m_snapshot = std::move(snapshot);
+		m_model = m_snapshot->model.get();
+		m_simEngine.reset(new SimulationT(m_model->elevation(), m_model->overrides(), UNREACHABLE));
+	}
+
+	/// Takes the current snapshot of the store if it is changed
+	void syncSnapshot()
+	{
+		if (m_store)
+		{
+			auto snapshot = m_store->current();
+			if (snapshot != m_snapshot)
+			{
+				bindSnapshot(std::move(snapshot));
+			}
+		}
+	}
+
+	bool route(const PointT& finishPnt, const SearchOptions& options)
+	{
+		m_lastResult = SearchResult();
+		syncSnapshot();
+		if (!(options.epsilon >= 0) || (options.anytime && !(options.epsilonStep > 0)))
+		{
+			throw std::invalid_argument("Epsilon should be >= 0 and epsilon step should be > 0");
+		}
+		const bool otherVehicle = options.vehicle && options.vehicle != VehicleCosts::standard();
+		if (otherVehicle && (options.goalBounds || options.swamps || options.firstMoves))
+		{
+			throw std::invalid_argument("Goal bounds, swamps and first moves are built for the default vehicle");
+		}
+		m_simEngine->setVehicle(options.vehicle);
+		if (options.climbBound && options.climbBound->vehicle() != (options.vehicle ? options.vehicle : VehicleCosts::standard()))
+		{
+			throw std::invalid_argument("Climb bound is built for another vehicle");
+		}
+		if (options.plateaus && (options.plateaus->getSizeX() != m_model->getSizeX() || options.plateaus->getSizeY() != m_model->getSizeY()))
+		{
+			throw std::invalid_argument("Plateaus are built for another map");
+		}
+		if (!m_simEngine->isDrivable(finishPnt))
 		{
 			return false;
 		}
 
 		const auto& curLocation = m_baseRoutePoints.back();
-		m_timeToArrive.put(curLocation, 0);
+		// Destination on another island fragment. There is no need to explore the whole fragment of the start to know it.
+		// Components are of the default vehicle. They reject queries of vehicles that can't go where it can't.
+		// Tiled maps have no components, searches of them find that there is no way
+		const bool checkComponents = m_model->hasComponents() &&
+			(!otherVehicle || options.vehicle->isRestrictionOf(*VehicleCosts::standard()));
+		if (checkComponents && !m_model->components().mayReach(curLocation, finishPnt))
+		{
+			m_rejected += 1;
+			return false;
+		}
+		if (isOfModel(options.firstMoves) && options.firstMoves->contains(finishPnt))
+		{
+			return walkFirstMoves(*options.firstMoves, curLocation, finishPnt);
+		}
+
+		m_queryArena.release();
+		if (useSparseState(curLocation, finishPnt, options.state))
+		{
+			m_sparseTimeToArrive.reserve(expectedCells(curLocation, finishPnt));
+			SearchState<SparseMapT> state = { m_sparseTimeToArrive, m_sparseClosedPass };
+			const bool found = query(state, curLocation, finishPnt, options);
+			m_lastResult.stateBytes = m_sparseTimeToArrive.allocatedBytes();
+			return found;
+		}
+		if (useTiledState(options.state))
+		{
+			SearchState<TiledMapT> state = { tiledTimeToArrive(), m_tiledClosedPass };
+			const bool found = query(state, curLocation, finishPnt, options);
+			m_lastResult.stateBytes = m_tiledTimeToArrive->allocatedBytes();
+			return found;
+		}
+		if (!m_timeToArrive)
+		{
+			m_timeToArrive.reset(new ArrivalMapT(ArrivalMapFactory<ArrivalMapT>::create(m_model->getSizeX(), m_model->getSizeY(), UNREACHABLE)));
+		}
+		SearchState<ArrivalMapT> state = { *m_timeToArrive, m_closedPass };
+		m_lastResult.stateBytes = m_model->getSizeX() * m_model->getSizeY() * sizeof(TimeT);
+		return query(state, curLocation, finishPnt, options);
+	}
+
+	void logQuery(const PointT& startPnt, const PointT& finishPnt, const SearchOptions& options, const ClockT::time_point& begin)
+	{
+		QueryRecord record;
+		memset(&record, 0, sizeof(record));
+		record.startX = startPnt.first;
+		record.startY = startPnt.second;
+		record.finishX = finishPnt.first;
+		record.finishY = finishPnt.second;
+		record.mode = static_cast<uint8_t>((options.anytime ? QM_ANYTIME : 0) | (options.corridor ? QM_CORRIDOR : 0) |
+			(options.climbBound ? QM_CLIMB_BOUND : 0) | (options.goalBounds ? QM_GOAL_BOUNDS : 0) |
+			(options.swamps ? QM_SWAMPS : 0) | (options.firstMoves ? QM_FIRST_MOVES : 0) | (options.plateaus ? QM_PLATEAUS : 0));
+		record.state = static_cast<uint8_t>(options.state);
+		record.found = m_lastResult.found ? 1 : 0;
+		record.epsilon = static_cast<float>(options.epsilon);
+		record.epsilonStep = static_cast<float>(options.epsilonStep);
+		if (options.corridor)
+		{
+			record.corridorFactor = static_cast<uint32_t>(options.corridor->factor());
+			record.corridorWidth = static_cast<uint32_t>(options.corridor->width());
+		}
+		if (options.vehicle)
+		{
+			const VehicleProfile& profile = options.vehicle->profile();
+			record.vehicle = static_cast<uint8_t>(loggedVehicle(profile));
+			record.vehicleForbidden = profile.forbiddenFlags;
+			record.vehicleMaxClimb = profile.maxClimb;
+			record.vehicleMaxDescent = profile.maxDescent;
+			record.vehicleSpeed = profile.speed;
+			record.vehicleSlopeScale = profile.slopeScale;
+		}
+		if (options.deadline != ClockT::time_point::max())
+		{
+			const auto budget = std::chrono::duration_cast<std::chrono::microseconds>(options.deadline - begin).count();
+			record.deadlineUs = static_cast<uint32_t>(std::max<long long>(1, budget));
+		}
+		record.time = m_lastResult.time;
+		record.expansions = m_lastResult.expansions;
+		record.latencyUs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(ClockT::now() - begin).count());
+		m_queryLog->append(record);
+	}
+
+	/// One of built-in profiles or QV_CUSTOM
+	static QueryVehicle loggedVehicle(const VehicleProfile& profile)
+	{
+		const auto isSame = [&profile](const VehicleProfile& other) {
+			return profile.name == other.name && profile.forbiddenFlags == other.forbiddenFlags && profile.speed == other.speed &&
+				profile.slopeScale == other.slopeScale && profile.maxClimb == other.maxClimb && profile.maxDescent == other.maxDescent;
+		};
+		if (isSame(VehicleProfile::rover()))
+		{
+			return QV_ROVER;
+		}
+		if (isSame(VehicleProfile::truck()))
+		{
+			return QV_TRUCK;
+		}
+		return isSame(VehicleProfile::bike()) ? QV_BIKE : QV_CUSTOM;
+	}
+
+
+	/// Maps of one search: times to arrive and passes of anytime search when nodes were closed
+	template<typename MapT>
+	struct SearchState
+	{
+		MapT& times;
+		std::unique_ptr<MapT>& closed;//< It is created on demand
+	};
+
+	/// Short queries explore a small area. A hash of visited cells is far smaller than the grid of the map
+	bool useSparseState(const PointT& startPnt, const PointT& finishPnt, SearchOptions::StateBackend state) const
+	{
+		switch (state)
+		{
+		case SearchOptions::SS_DENSE:
+		case SearchOptions::SS_TILED:
+			return false;
+		case SearchOptions::SS_SPARSE:
+			return true;
+		default:
+			return octileDistance(startPnt, finishPnt) <= SPARSE_DISTANCE_LIMIT;
+		}
+	}
+
+	/// Maps of tiled models are larger than memory. The dense grid of them is not allocated unless it is asked for
+	bool useTiledState(SearchOptions::StateBackend state) const
+	{
+		return state == SearchOptions::SS_TILED ||
+			(state == SearchOptions::SS_AUTO && m_model->elevation().isTiled());
+	}
+
+	/// Goal bounds, swamps and first moves are built for one version of maps (see MapsModel::checksum)
+	template<typename TableT>
+	bool isOfModel(const std::shared_ptr<const TableT>& table) const
+	{
+		return table && table->mapChecksum() == m_model->checksum();
+	}
+
+	/// Trees of alternatives are created on demand by the first query with their state backend
+	template<typename MapT>
+	std::vector<AlternativeRoute> findAlternatives(std::unique_ptr<AlternativeRoutes<SimulationT, MapT>>& trees, const PointT& startPnt,
+													const PointT& finishPnt, size_t count, const AlternativeOptions& options)
+	{
+		const size_t sizeX = m_model->getSizeX();
+		const size_t sizeY = m_model->getSizeY();
+		if (!trees || trees->getSizeX() != sizeX || trees->getSizeY() != sizeY)
+		{
+			trees.reset(new AlternativeRoutes<SimulationT, MapT>(sizeX, sizeY, [sizeX, sizeY]() {
+				return ArrivalMapFactory<MapT>::create(sizeX, sizeY, UNREACHABLE);
+			}));
+		}
+		trees->reserve(expectedCells(startPnt, finishPnt));
+		PerfPhase phase(m_perfCounters);
+		auto result = trees->find(*m_simEngine, m_queryArena, startPnt, finishPnt, count, options);
+		// Paths are taken from trees, they are counted with the search
+		phase.stop(m_lastResult.searchCounts);
+		m_lastResult.expansions = trees->expansions();
+		m_lastResult.iterations = 1;
+		m_lastResult.stateBytes = trees->bytes();
+		return result;
+	}
+
+	TiledMapT& tiledTimeToArrive()
+	{
+		if (!m_tiledTimeToArrive)
+		{
+			m_tiledTimeToArrive.reset(new TiledMapT(m_model->getSizeX(), m_model->getSizeY()));
+		}
+		return *m_tiledTimeToArrive;
+	}
+
+	/// Estimation of explored cells. A* explores an ellipse around start and finish. The hash grows if it is more
+	static size_t expectedCells(const PointT& startPnt, const PointT& finishPnt)
+	{
+		const size_t radius = octileDistance(startPnt, finishPnt) + 16;
+		return radius * radius * 2;
+	}
+
+	static size_t octileDistance(const PointT& from, const PointT& to)
+	{
+		const size_t dX = std::abs(from.first - to.first);
+		const size_t dY = std::abs(from.second - to.second);
+		return std::max(dX, dY) + std::min(dX, dY) / 2;
+	}
+
+	template<typename MapT>
+	bool query(SearchState<MapT>& state, const PointT& curLocation, const PointT& finishPnt, const SearchOptions& options)
+	{
+		const size_t enquedBefore = m_enquedItems;
+		const size_t prunedBefore = m_pruned;
+		m_progress = SearchProgress();
+		m_corridor = options.corridor.get();
+		// Tables of another version of maps could prune the only optimal route. They are ignored as first moves are
+		m_goalBounds = isOfModel(options.goalBounds) ? options.goalBounds.get() : nullptr;
+		m_swamps = isOfModel(options.swamps) ? options.swamps.get() : nullptr;
+		m_climb = options.climbBound.get();
+		// Dominated moves are not dominated in a corridor. Suboptimal searches expand cells before their times are optimal
+		m_plateaus = (!options.corridor && options.epsilon == 0 && !options.anytime) ? options.plateaus.get() : nullptr;
+		m_flatStraight = m_flatDiagonal = UNREACHABLE;
+		m_finishElevation = m_model->elevation().get(finishPnt);
+		if (m_swamps)
+		{
+			m_startSwamp = m_swamps->region(curLocation);
+			m_finishSwamp = m_swamps->region(finishPnt);
+		}
+		PerfPhase phase(m_perfCounters);
+		TimeT bound = search(state, curLocation, finishPnt, options);
+		if (m_corridor && !isStopped() && isUnreachable(state.times.get(finishPnt)))
+		{
+			// The corridor blocks the way. Coarse levels could be wrong about narrow passes
+			m_lastResult.corridorFallback = true;
+			m_corridor = nullptr;
+			bound = search(state, curLocation, finishPnt, options);
+		}
+		m_corridor = nullptr;
+		m_goalBounds = nullptr;
+		m_swamps = nullptr;
+		m_climb = nullptr;
+		m_plateaus = nullptr;
+		m_lastResult.expansions = m_enquedItems - enquedBefore;
+		m_lastResult.pruned = m_pruned - prunedBefore;
+		phase.stop(m_lastResult.searchCounts);
+
+		// Check if path is not found. The search state is not consistent after cancellation, it is reset by the next query
+		if (m_lastResult.cancelled || isUnreachable(bound) || isUnreachable(state.times.get(finishPnt)))
+		{
+			return false;
+		}
+		m_lastResult.found = true;
+		m_lastResult.time = state.times.get(finishPnt);
+		m_lastResult.bound = bound;
+		//form result path
+		auto path = extractPath(state, curLocation, finishPnt);
+		for (auto node : path)
+		{
+			m_path.add(node.first, node.second);
+			m_steps.push_back(node);
+		}
+		//Add stop point Finish Point
+		m_baseRoutePoints.push_back(finishPnt);
+		phase.stop(m_lastResult.pathCounts);
+
+		return true;
+	}
+
+	/// Route to a destination of first moves. There is no search, the walk is counted as the path extraction
+	bool walkFirstMoves(const FirstMoves& firstMoves, const PointT& curLocation, const PointT& finishPnt)
+	{
+		PerfPhase phase(m_perfCounters);
+		std::vector<MeasuredPointT> steps;
+		const bool found = firstMoves.walk(*m_simEngine, curLocation, finishPnt, steps);
+		if (found)
+		{
+			m_lastResult.found = true;
+			for (const auto& step : steps)
+			{
+				m_lastResult.time += step.second;
+				m_path.add(step.first, step.second);
+				m_steps.push_back(step);
+			}
+			m_baseRoutePoints.push_back(finishPnt);
+		}
+		phase.stop(m_lastResult.pathCounts);
+		return found;
+	}
+
+	/// Search of RouteBuilder::nearest. Settled targets are removed from the grid and added to the result
+	template<typename MapT>
+	void nearestSearch(SearchState<MapT>& state, const PointT& startPnt, TargetGrid& grid, size_t count, const SearchOptions& options,
+		std::vector<NearestTarget>& result)
+	{
+		state.times.reset();
+		state.times.put(startPnt, 0);
+		auto estimate = [&](const PointT& pnt) {
+			PointT target;
+			return grid.nearest(pnt, target) ? m_simEngine->getMinTimeToArrive(pnt, target) : 0.0;
+		};
+		// Targets by times they are reached. An item is old if the target is settled or is reached faster later
+		std::vector<MeasuredPointT> reached;
+		auto later = [](const MeasuredPointT& first, const MeasuredPointT& second) { return first.second > second.second; };
+		auto reach = [&](const PointT& pnt, TimeT time) {
+			if (grid.contains(pnt))
+			{
+				reached.push_back(std::make_pair(pnt, time));
+				std::push_heap(reached.begin(), reached.end(), later);
+			}
+		};
+		QueueT queue = QueueFactory<QueueT>::create(m_queryArena);
+		queue.push(estimate(startPnt), std::make_pair(startPnt, 0.0));
+		reach(startPnt, 0.0);
+		size_t expanded = 0;
+		while (result.size() < count)
+		{
+			// Keys of the queue are lower bounds of times to remaining targets through queued nodes
+			if (!reached.empty() && (queue.empty() || !(reached.front().second > queue.front().first)))
+			{
+				std::pop_heap(reached.begin(), reached.end(), later);
+				const MeasuredPointT target = reached.back();
+				reached.pop_back();
+				if (grid.contains(target.first) && state.times.get(target.first) == target.second)
+				{
+					std::vector<MeasuredPointT> steps;
+					for (const auto& node : extractPath(state, startPnt, target.first))
+					{
+						steps.push_back(node);
+					}
+					grid.remove(target.first, [&](size_t id) { result.push_back(NearestTarget{ id, target.second, steps }); });
+				}
+				continue;
+			}
+			if (queue.empty() || grid.empty())
+			{
+				break;
+			}
+			if ((++expanded % DEADLINE_CHECK_PERIOD == 0) && checkStop(options))
+			{
+				break;
+			}
+			m_enquedItems += 1;
+			const auto curNode = queue.front().second;
+			queue.pop();
+			if (isLower(state.times.get(curNode.first), curNode.second))
+			{
+				continue;
+			}
+			auto neighbors = state.times.getNeighbors(curNode.first, ArenaAllocator<PointT>(m_queryArena));
+			for (const auto& neighbor : neighbors)
+			{
+				const TimeT timeForMove = m_simEngine->getTimeToNeighbour(curNode.first, neighbor);
+				if (isUnreachable(timeForMove))
+				{
+					continue;
+				}
+				const TimeT newTime = curNode.second + timeForMove;
+				const TimeT oldTime = state.times.get(neighbor);
+				if (!isUnreachable(oldTime) && !(newTime < oldTime))
+				{
+					continue;
+				}
+				state.times.put(neighbor, newTime);
+				queue.push(newTime + estimate(neighbor), std::make_pair(neighbor, newTime));
+				reach(neighbor, newTime);
+			}
+		}
+		// Targets of a cell are added by indexes. Times are equal
+		if (result.size() > count)
+		{
+			result.resize(count);
+		}
+	}
+
+	using InconsT = std::vector<MeasuredPointT, ArenaAllocator<MeasuredPointT>>;
+	using PathNodesT = std::list<std::pair<PointT, SpeedT>, ArenaAllocator<std::pair<PointT, SpeedT>>>;
+	static const size_t DEADLINE_CHECK_PERIOD = 1024; // expansions between checks of deadline, cancellation and progress reports
+	static const size_t SPARSE_DISTANCE_LIMIT = 256; // octile distance in cells of the longest query with sparse state
+	static constexpr TimeT PATH_TOLERANCE = 1e-9; // relative to the time of a cell, a move of the path arrives not later
+
+	/// \return achieved bound of suboptimality. It is NaN if the search is stopped before the first route
+	template<typename MapT>
+	TimeT search(SearchState<MapT>& state, const PointT& startPnt, const PointT& finishPnt, const SearchOptions& options)
+	{
+		state.times.reset();
+		state.times.put(startPnt, 0);
+		if (options.epsilon > 0 || options.anytime)
+		{
+			return boundedSearch(state, startPnt, finishPnt, options);
+		}
+		return optimalSearch(state, startPnt, finishPnt, options) ? 1.0 : UNREACHABLE;
+	}
+
+	/*! Classic A*. The priority in the queue is time to point + minimal time to arrive
+		\return false if the search is stopped
+	*/
+	template<typename MapT>
+	bool optimalSearch(SearchState<MapT>& state, const PointT& startPnt, const PointT& finishPnt, const SearchOptions& options)
+	{
 		// The Key of the queue - is a priority. It measure minimum estimated time of arrival through this point to the finish
 		// The Value of the queue is a pair with a Point and time to arrive from start to this point
-		QueueT queue; 
+		QueueT queue = QueueFactory<QueueT>::create(m_queryArena);
 		TimeT timeToPoint = 0.0;
-		auto minTimeToArrive = m_simEngine.getMinTimeToArrive(curLocation, finishPnt);
-		queue.push(timeToPoint + minTimeToArrive, std::make_pair(curLocation, timeToPoint));
-		while (!queue.empty() && needProcessQueue(m_timeToArrive.get(finishPnt), queue.front().first))
+		auto minTimeToArrive = estimateTimeToArrive(startPnt, finishPnt);
+		queue.push(timeToPoint + minTimeToArrive, std::make_pair(startPnt, timeToPoint));
+		m_lastResult.iterations += 1;
+		const bool completed = improvePath(state, finishPnt, 1.0, queue, 0, nullptr, options);
+		m_cutted += queue.size();
+		return completed;
+	}
+
+	/*! Weighted A* and Anytime Repairing A* (M. Likhachev, G. Gordon, S. Thrun).
+		The priority in the queue is time to point + weight * minimal time to arrive.
+		The first pass is weighted A* with 1 + epsilon weight. In anytime mode weight is decreased by epsilon step
+		and the route is improved until the deadline or until the optimal route is found.
+		Passes reuse times to arrive. A node is expanded once per pass. If a closed node gets a lower time 
+		it waits in the inconsistent list for the next pass.
+		\return achieved bound of suboptimality. It is NaN if the first pass is stopped
+	*/
+	template<typename MapT>
+	TimeT boundedSearch(SearchState<MapT>& state, const PointT& startPnt, const PointT& finishPnt, const SearchOptions& options)
+	{
+		if (!state.closed)
+		{
+			state.closed.reset(new MapT(ArrivalMapFactory<MapT>::create(m_model->getSizeX(), m_model->getSizeY(), UNREACHABLE)));
+		}
+		state.closed->reset();
+
+		TimeT weight = 1.0 + options.epsilon;
+		QueueT queue = QueueFactory<QueueT>::create(m_queryArena);
+		queue.push(weight * estimateTimeToArrive(startPnt, finishPnt), std::make_pair(startPnt, 0.0));
+		InconsT incons = InconsT(ArenaAllocator<MeasuredPointT>(m_queryArena));
+		TimeT bound = std::numeric_limits<TimeT>::infinity();
+		TimeT lastLowerBound = 0.0;
+		for (TimeT pass = 1; ; pass += 1)
+		{
+			m_lastResult.iterations += 1;
+			const bool completed = improvePath(state, finishPnt, weight, queue, pass, &incons, options);
+			if ((!completed && pass == 1) || m_lastResult.cancelled)
+			{
+				// There is no bound for the route yet
+				bound = UNREACHABLE;
+				break;
+			}
+			if (isUnreachable(state.times.get(finishPnt)))
+			{
+				break;
+			}
+			if (!completed)
+			{
+				// The route could be improved in the interrupted pass. The lower bound of the previous pass is still valid
+				bound = std::min(bound, achievedBound(state, finishPnt, bound, lastLowerBound));
+				break;
+			}
+			lastLowerBound = lowerBound(finishPnt, queue, incons);
+			bound = achievedBound(state, finishPnt, weight, lastLowerBound);
+			if (!options.anytime || bound <= 1.0 || weight <= 1.0 || ClockT::now() >= options.deadline)
+			{
+				break;
+			}
+
+			// Next pass with lower weight. The queue is built from open and inconsistent nodes with new priorities
+			weight = std::max(1.0, weight - options.epsilonStep);
+			QueueT nextQueue = QueueFactory<QueueT>::create(m_queryArena);
+			auto reopen = [&](const MeasuredPointT& node) {
+				const TimeT timeToPoint = state.times.get(node.first);
+				// Skip outdated items, there is an item with the lower time
+				if (isLower(timeToPoint, node.second))
+				{
+					return;
+				}
+				nextQueue.push(timeToPoint + weight * estimateTimeToArrive(node.first, finishPnt),
+								std::make_pair(node.first, timeToPoint));
+			};
+			queue.forEach([&](const TimeT&, const MeasuredPointT& node) { reopen(node); });
+			for (const auto& node : incons)
+			{
+				reopen(node);
+			}
+			incons.clear();
+			queue = std::move(nextQueue);
+		}
+		m_cutted += queue.size();
+		return bound;
+	}
+
+	/*! Expands nodes while the destination could be improved by nodes in the queue.
+		\param closedPass if it is not 0, nodes closed in this pass are not expanded again and go to incons.
+		\return false if the search is stopped by the deadline or cancellation earlier
+	*/
+	template<typename MapT>
+	bool improvePath(SearchState<MapT>& state, const PointT& finishPnt, TimeT weight, QueueT& queue, TimeT closedPass, InconsT* incons,
+					const SearchOptions& options)
+	{
+		size_t expanded = 0;
+		while (!queue.empty() && needProcessQueue(state.times.get(finishPnt), queue.front().first))
 		{
+			if ((++expanded % DEADLINE_CHECK_PERIOD == 0) && checkStop(options))
+			{
+				return false;
+			}
 			m_enquedItems += 1;
 			auto curNode = queue.front().second;
 			auto& curPoint = curNode.first;
 			auto& timeToPoint = curNode.second;
 			queue.pop();
-			auto curValue = m_timeToArrive.get(curPoint);
+			auto curValue = state.times.get(curPoint);
 			// If the node is processed and has a lower time value - skip it
 			if (isLower(curValue, timeToPoint))
 			{
 				continue;
 			}
-			m_timeToArrive.put(curPoint, timeToPoint);
-			std::list<PointT> neighbors = m_timeToArrive.getNeighbors(curPoint);
-			processNeighbors(curPoint, timeToPoint, neighbors, finishPnt, queue);
+			if (closedPass)
+			{
+				if (state.closed->get(curPoint) == closedPass)
+				{
+					continue;
+				}
+				state.closed->put(curPoint, closedPass);
+			}
+			state.times.put(curPoint, timeToPoint);
+			if (options.progress)
+			{
+				updateProgress(curPoint, timeToPoint, finishPnt);
+			}
+			PlateauMask::Moves moves;
+			if (m_plateaus && m_plateaus->contains(curPoint) && plateauMoves(state, curPoint, timeToPoint, moves))
+			{
+				m_pruned += 8 - moves.count;
+				processNeighbors(state, curPoint, timeToPoint, moves, finishPnt, queue, weight, closedPass, incons);
+				continue;
+			}
+			auto neighbors = state.times.getNeighbors(curPoint, ArenaAllocator<PointT>(m_queryArena));
+			processNeighbors(state, curPoint, timeToPoint, neighbors, finishPnt, queue, weight, closedPass, incons);
 		}
-		m_cutted += queue.size();
+		return true;
+	}
 
-		// Check if path is not found
-		if (isUnreachable(m_timeToArrive.get(finishPnt)))
+	/** Moves of the plateau cell that are not dominated (see PlateauMask).
+		The parent is the neighbor whose time and the move give the time of the cell.
+		\return false if all moves have to be expanded: the parent is not known (e.g. the start) or pruning doesn't fit the vehicle
+	*/
+	template<typename MapT>
+	bool plateauMoves(const SearchState<MapT>& state, const PointT& curPoint, TimeT timeToPoint, PlateauMask::Moves& moves)
+	{
+		if (isUnreachable(m_flatStraight) || isUnreachable(m_flatDiagonal))
 		{
-			return false;
+			// Times of flat moves are of the vehicle. They are taken from moves of the first plateau cell with drivable neighbors
+			for (const auto& neighbor : state.times.getNeighbors(curPoint, ArenaAllocator<PointT>(m_queryArena)))
+			{
+				const TimeT time = m_simEngine->getTimeToNeighbour(curPoint, neighbor);
+				if (!isUnreachable(time))
+				{
+					(neighbor.first == curPoint.first || neighbor.second == curPoint.second ? m_flatStraight : m_flatDiagonal) = time;
+				}
+			}
+			if (isUnreachable(m_flatStraight) || isUnreachable(m_flatDiagonal))
+			{
+				return false;
+			}
+			if (!(m_flatStraight < m_flatDiagonal && m_flatDiagonal < 2 * m_flatStraight))
+			{
+				m_plateaus = nullptr;
+				return false;
+			}
 		}
-		//form result path
-		auto path = extractPath(curLocation, finishPnt);
-		for (auto node : path)
+		for (int dX = -1; dX <= 1; ++dX)
 		{
-			m_path.add(node.first, node.second);
+			for (int dY = -1; dY <= 1; ++dY)
+			{
+				if (dX == 0 && dY == 0)
+				{
+					continue;
+				}
+				const TimeT parentTime = state.times.get(PointT(curPoint.first - dX, curPoint.second - dY));
+				if (!isUnreachable(parentTime) && parentTime + ((dX && dY) ? m_flatDiagonal : m_flatStraight) == timeToPoint)
+				{
+					PlateauMask::moves(curPoint, dX, dY, [this](const PointT& pnt) { return m_simEngine->isDrivable(pnt); }, moves);
+					return true;
+				}
+			}
 		}
-		//Add stop point Finish Point
-		m_baseRoutePoints.push_back(finishPnt);
+		return false;
+	}
 
-		return true;
+	/// Estimation of time to arrive of the simulation or the climb bound if it is greater
+	TimeT estimateTimeToArrive(const PointT& from, const PointT& to)
+	{
+		const TimeT estimation = m_simEngine->getMinTimeToArrive(from, to);
+		if (!m_climb)
+		{
+			return estimation;
+		}
+		const TimeT dX = std::abs(from.first - to.first);
+		const TimeT dY = std::abs(from.second - to.second);
+		const TimeT distance = std::max(dX, dY) + (sqrt(2.0) - 1.0) * std::min(dX, dY);
+		return std::max(estimation, m_climb->time(distance, m_finishElevation - m_model->elevation().get(from)));
+	}
 
+	/// Reports progress. \return true if the search has to be stopped
+	bool checkStop(const SearchOptions& options)
+	{
+		if (options.progress)
+		{
+			options.progress(m_progress);
+		}
+		if (options.cancellation && options.cancellation->isCancelled())
+		{
+			m_lastResult.cancelled = true;
+			return true;
+		}
+		if (ClockT::now() >= options.deadline)
+		{
+			m_lastResult.timedOut = true;
+			return true;
+		}
+		return false;
 	}
 
-	/// \return detailed path with points and estimation time for drive though each one.
-	void showRoute()
+	bool isStopped() const
 	{
-		m_viewer.showRoute(m_path, m_baseRoutePoints);
+		return m_lastResult.cancelled || m_lastResult.timedOut;
 	}
-private:
+
+	void updateProgress(const PointT& curPoint, TimeT timeToPoint, const PointT& finishPnt)
+	{
+		m_progress.explored += 1;
+		const TimeT remaining = estimateTimeToArrive(curPoint, finishPnt);
+		if (remaining < m_progress.bestRemaining)
+		{
+			m_progress.best = curPoint;
+			m_progress.bestTime = timeToPoint;
+			m_progress.bestRemaining = remaining;
+		}
+	}
+
+	/// Lower bound of the optimal time: min(time to point + minimal time to arrive) by open and inconsistent nodes
+	TimeT lowerBound(const PointT& finishPnt, const QueueT& queue, const InconsT& incons)
+	{
+		TimeT result = std::numeric_limits<TimeT>::infinity();
+		auto update = [&](const MeasuredPointT& node) {
+			result = std::min(result, node.second + estimateTimeToArrive(node.first, finishPnt));
+		};
+		queue.forEach([&](const TimeT&, const MeasuredPointT& node) { update(node); });
+		for (const auto& node : incons)
+		{
+			update(node);
+		}
+		return result;
+	}
+
+	/// \return time to arrive / lower bound limited by the weight. 1 if the route is optimal for sure
+	template<typename MapT>
+	TimeT achievedBound(const SearchState<MapT>& state, const PointT& finishPnt, TimeT weight, TimeT lowerBound) const
+	{
+		const TimeT time = state.times.get(finishPnt);
+		if (!(lowerBound < time))
+		{
+			return 1.0;
+		}
+		return std::max(1.0, std::min(weight, time / lowerBound));
+	}
+
 	/* neighbors of current point are add in the queue if it is necessary */
-	void processNeighbors(const PointT& curPoint, const TimeT& timeToPoint, const std::list<PointT>& neighbors, const PointT& finishPoint,  QueueT& queue)
+	template<typename MapT, typename NeighborsT>
+	void processNeighbors(SearchState<MapT>& state, const PointT& curPoint, const TimeT& timeToPoint, const NeighborsT& neighbors, const PointT& finishPoint,  QueueT& queue,
+						TimeT weight, TimeT closedPass, InconsT* incons)
 	{
 		// Let's enqueue neighbors
 		for (auto& neighbor : neighbors)
 		{
 			m_totalCheckedItems += 1;
 			// Skip not drivable neighbors
-			if (!m_simEngine.isDrivable(neighbor))
+			if (!m_simEngine->isDrivable(neighbor))
 			{
 				continue;
 			}
 
-			TimeT timeForMove = m_simEngine.getTimeToNeighbour(curPoint, neighbor);
+			if (m_corridor && !m_corridor->contains(neighbor))
+			{
+				continue;
+			}
+
+			if (m_goalBounds && !m_goalBounds->mayLeadTo(curPoint, neighbor, finishPoint))
+			{
+				m_pruned += 1;
+				continue;
+			}
+
+			if (m_swamps && !m_swamps->mayEnter(neighbor, m_startSwamp, m_finishSwamp))
+			{
+				m_pruned += 1;
+				continue;
+			}
+
+			TimeT timeForMove = m_simEngine->getTimeToNeighbour(curPoint, neighbor);
 			if (isUnreachable(timeForMove))
 			{
 				continue;
@@ -152,63 +1262,69 @@ private:
 			}
 
 			auto newTime = timeToPoint + timeForMove;
-			auto oldTime = m_timeToArrive.get(neighbor);
-			// If time in neighbor node is lower newTime, skip this node
-			if (isLower(oldTime, newTime))
+			auto oldTime = state.times.get(neighbor);
+			// If time in neighbor node is not greater than newTime, skip this node.
+			// Paths of equal time are common on plains (sums of the same moves in another order), one of them is enough
+			if (!isUnreachable(oldTime) && !(newTime < oldTime))
 			{
 				continue;
 			}
 
-			m_timeToArrive.put(neighbor, newTime);
+			state.times.put(neighbor, newTime);
+			// Closed in this pass of anytime search. It will be opened in the next pass
+			if (closedPass && state.closed->get(neighbor) == closedPass)
+			{
+				incons->push_back(std::make_pair(neighbor, newTime));
+				continue;
+			}
 			// if Node is already has a value in queue it could be removed (timeFromMap, pnt). But it will fast skipped. So keep code simple
-			auto minTimeToArrive = m_simEngine.getMinTimeToArrive(neighbor, finishPoint);
-			queue.push(newTime + minTimeToArrive, std::make_pair(neighbor, newTime));
+			auto minTimeToArrive = estimateTimeToArrive(neighbor, finishPoint);
+			queue.push(newTime + weight * minTimeToArrive, std::make_pair(neighbor, newTime));
 		}
 	}
 	
-	bool findMinValuePoint(const std::list<PointT>& neighbors, PointT& minPoint, TimeT& minValue)
+	/** The neighbor the search came from: the move from it is allowed and arrives not later than curTime.
+		Moves of vehicles could be allowed in one direction only (see VehicleProfile::maxClimb), so a neighbor
+		of the lowest time is not enough. The neighbor of the lowest time is taken among predecessors
+		\param moveTime time of the move from the predecessor
+	*/
+	template<typename MapT, typename NeighborsT>
+	bool findPredecessor(const MapT& times, const NeighborsT& neighbors, const PointT& curPoint, const TimeT& curTime,
+						PointT& prevPoint, TimeT& prevTime, TimeT& moveTime)
 	{
-		if (neighbors.empty())
-			return false;
-
-		minValue = UNREACHABLE;
-		for (auto neighbor : neighbors)
+		prevTime = UNREACHABLE;
+		for (const auto& neighbor : neighbors)
 		{
-			auto value = m_timeToArrive.get(neighbor);
-			if (isUnreachable(minValue))
+			const auto value = times.get(neighbor);
+			if (isUnreachable(value) || (!isUnreachable(prevTime) && !(value < prevTime)))
 			{
-				minValue = value;
-				minPoint = neighbor;
 				continue;
 			}
-
-			//get min and not NaN
-			if (isUnreachable(value))
-			{
-				continue;
-			}
-
-			if (value < minValue)
+			const auto timeForMove = m_simEngine->getTimeToNeighbour(neighbor, curPoint);
+			// Times of the search are sums of the same moves, the tolerance is for their rounding
+			if (!isUnreachable(timeForMove) && value + timeForMove <= curTime * (1.0 + PATH_TOLERANCE))
 			{
-				minValue = value;
-				minPoint = neighbor;
+				prevTime = value;
+				prevPoint = neighbor;
+				moveTime = timeForMove;
 			}
 		}
-		return !isUnreachable(minValue);
+		return !isUnreachable(prevTime);
 	}
 
-	std::list<std::pair<PointT, SpeedT>> extractPath(const PointT& startPoint, const PointT& finishPnt)
+	template<typename MapT>
+	PathNodesT extractPath(const SearchState<MapT>& state, const PointT& startPoint, const PointT& finishPnt)
 	{
-		std::list<std::pair<PointT, TimeT>> path; //or deque. But we don't know items count.
+		PathNodesT path = PathNodesT(ArenaAllocator<std::pair<PointT, SpeedT>>(m_queryArena)); //or deque. But we don't know items count.
 		auto curPoint = finishPnt;
-		auto curTime = m_timeToArrive.get(finishPnt);
+		auto curTime = state.times.get(finishPnt);
 		PointT nextPoint;
 		TimeT nextTime;
+		TimeT moveTime;
 		while (curPoint != startPoint)
 		{
-			std::list<PointT> neighbors = m_timeToArrive.getReachableNeighbors(curPoint);//m_timeToArrive.getReachableNeighbors(curPoint);
-			//This simple solution could cut edges of route but doesn't impact on time estimations.
-			if (!findMinValuePoint(neighbors, nextPoint, nextTime))
+			auto neighbors = state.times.getReachableNeighbors(curPoint, ArenaAllocator<PointT>(m_queryArena));
+			if (!findPredecessor(state.times, neighbors, curPoint, curTime, nextPoint, nextTime, moveTime))
 			{
 				throw std::logic_error("Can't extract path from backward iteration by valued map from finish point");
 			}
@@ -216,8 +1332,8 @@ private:
 			{
 				throw std::logic_error("Can't create a back way to start point. New points min time is greater then in current point. It's impossible");
 			}
-			const auto dT = (curTime - nextTime);
-			const auto speed = dT;//* 1.0 / m_simEngine.getNeighboursDistance(nextPoint, curPoint);
+			// Time of the real move. Suboptimal searches could keep a later time of the cell than the move gives
+			const auto speed = moveTime;//* 1.0 / m_simEngine->getNeighboursDistance(nextPoint, curPoint);
 			path.push_front(std::make_pair(curPoint, speed));
 			curPoint = nextPoint;
 			curTime = nextTime;
@@ -246,17 +1362,47 @@ private:
 	}
 
 private:
-	MapsModel& m_model;// Source of all start data about the Island
+	const MapsModel* m_model;// Source of all start data about the Island
+	const MapsStore<SimulationT>* m_store;// or nullptr. It is a source of versions of the model
+	std::shared_ptr<const MapSnapshot> m_snapshot;// version of maps of the last query. It keeps them alive
 	visualizer::MapsViewer& m_viewer; // can show data to user
-	RWMap m_timeToArrive;//<Map with the minimal time to arrive to  a node from start point
-	SimulationT m_simEngine;//< Simulation of move between points
-	std::list<PointT> m_baseRoutePoints;//< stop points
-	PathTimes m_path;//< All point of route with elapsed time for each point
+	std::unique_ptr<ArrivalMapT> m_timeToArrive;//<Map with the minimal time to arrive to  a node from start point. It is created on demand
+	SparseMapT m_sparseTimeToArrive;//< The same for short queries. Only visited nodes are kept
+	std::unique_ptr<SimulationT> m_simEngine;//< Simulation of move between points
+	Arena m_routeArena;//< memory of the route: stop points and points of the path
+	Arena m_queryArena;//< memory of containers of one query. It is released in one shot at the start of the next query
+	std::list<PointT, ArenaAllocator<PointT>> m_baseRoutePoints;//< stop points
+	ArenaPathTimes m_path;//< All point of route with elapsed time for each point
+	std::list<MeasuredPointT, ArenaAllocator<MeasuredPointT>> m_steps;//< the same points in order of the drive
 	size_t m_totalCheckedItems;//statistic
 	size_t m_enquedItems;//statistic
 	size_t m_cutted;//statistic
+	size_t m_rejected;//statistic: queries rejected by connected components
+	size_t m_pruned;//statistic: moves skipped by goal bounds, swamps and plateaus
+	std::unique_ptr<ArrivalMapT> m_closedPass;//< pass of anytime search when a node was closed. It is created on demand
+	std::unique_ptr<SparseMapT> m_sparseClosedPass;
+	std::unique_ptr<TiledMapT> m_tiledTimeToArrive;//< The same for long queries on tiled maps. It is created on demand
+	std::unique_ptr<TiledMapT> m_tiledClosedPass;
+	std::unique_ptr<AlternativeRoutes<SimulationT, ArrivalMapT>> m_alternatives;//< trees of alternatives. They are created on demand
+	std::unique_ptr<AlternativeRoutes<SimulationT, SparseMapT>> m_sparseAlternatives;//< The same for the sparse and tiled state
+	std::unique_ptr<AlternativeRoutes<SimulationT, TiledMapT>> m_tiledAlternatives;
+	SearchResult m_lastResult;
+	SearchProgress m_progress;// of the running query
+	std::shared_ptr<QueryLogWriter> m_queryLog;// or nullptr
+	bool m_perfCounters;//< phases are measured by hardware counters
+	PerfCounts m_renderCounts;//< of the last rendering
+	const CorridorMask* m_corridor;//< corridor of the current search or nullptr
+	const GoalBounds* m_goalBounds;//< goal bounds of the current search or nullptr
+	const SwampRegions* m_swamps;//< swamps of the current search or nullptr
+	const ClimbBound* m_climb;//< climb bound of the current search or nullptr
+	const PlateauMask* m_plateaus;//< plateaus of the current search or nullptr if moves are not pruned
+	TimeT m_flatStraight;//< times of moves on plateaus for the vehicle of the search. They are NaN until the first plateau cell
+	TimeT m_flatDiagonal;
+	int m_finishElevation;//< elevation of the destination of the current search
+	uint32_t m_startSwamp;//< swamps of the start and the destination are entered
+	uint32_t m_finishSwamp;
 };
 
-template<typename SimulationT, typename QueueT> 
-const double RouteBuilder<SimulationT, QueueT>::UNREACHABLE = std::numeric_limits<double>::quiet_NaN();
+template<typename SimulationT, typename QueueT, typename ArrivalMapT>
+const double RouteBuilder<SimulationT, QueueT, ArrivalMapT>::UNREACHABLE = std::numeric_limits<double>::quiet_NaN();
 #endif // __ROUTER_H__
\ No newline at end of file
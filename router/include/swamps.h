@@ -0,0 +1,658 @@
+#ifndef __SWAMPS_H__
+#define __SWAMPS_H__
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include <maps.h>
+#include "model.h"
+
+/** Swamps: regions of the map that no optimal route between cells out of them has to enter.
+Bays, valleys fenced by water and marsh, hills that are cheaper to go around are searched by A* in vain.
+RouteBuilder skips swamps unless the start or the goal is inside (see SearchOptions::swamps). Times of routes stay optimal.
+
+The map is split into tiles of regionSize x regionSize cells. Connected drivable cells of a tile are a region.
+Candidates are checked in two passes:
+1)	Dead ends: bays and valleys behind a narrow neck. They are parts of the graph of regions that are connected to the rest
+	through one region only (an articulation point). Larger dead ends are checked first.
+2)	Regions one by one: e.g. hills that are cheaper to go around. Regions near new swamps are checked again until
+	there are no new swamps, so swamps grow from inner corners of bays to their mouths.
+A candidate is a swamp if a route around it is not longer than a route through it for every pair of its boundary cells
+(drivable cells out of it with a move to it or from it). Routes are found by Dijkstra from every boundary cell with and
+without the region. Swamps are found one by one, later candidates are checked without earlier swamps.
+So swamps are valid together: an optimal route out of all swamps exists between any cells out of them.
+Adjacent swamps get one id at the end. If the start is in a swamp, the optimal route leaves it to a cell
+out of all swamps and goes around other swamps.
+Equal routes are compared with SAME_TIME_TOLERANCE, sums of the same moves in another order differ by rounding.
+
+File layout: SwampsHeader, uint32 regions[sizeY][sizeX]. It is the swamp id of the cell, NO_SWAMP out of swamps.
+*/
+#pragma pack(push, 1)
+struct SwampsHeader
+{
+	char signature[8];
+	uint32_t version;
+	uint64_t mapChecksum;// MapsModel::checksum()
+	uint32_t sizeX;
+	uint32_t sizeY;
+	uint32_t regionSize;
+	uint32_t count;// of swamps
+};
+#pragma pack(pop)
+
+struct SwampRegions
+{
+	static const uint32_t VERSION = 1;
+	static const uint32_t NO_SWAMP = 0;
+	static const size_t DEFAULT_REGION_SIZE = 1; // cells peel from inner corners of bays. Larger regions rarely pass the check
+	static constexpr double SAME_TIME_TOLERANCE = 1e-9; // relative
+
+	/** Finds swamps of the map by SimulationT rules of moves.
+		\param progress it is called with count of checked tiles, tiles near new swamps are checked again. It could be empty
+	*/
+	template<typename SimulationT>
+	static std::shared_ptr<const SwampRegions> build(const MapsModel& model, size_t regionSize = DEFAULT_REGION_SIZE,
+													std::function<void(size_t)> progress = nullptr);
+
+	/// Swamps stored by save(). The map of the model has to be the same
+	static std::shared_ptr<const SwampRegions> load(const std::string& filename, const MapsModel& model);
+
+	void save(const std::string& filename) const;
+
+	/// MapsModel::checksum() of the map of the swamps. Snapshots with other overrides don't match it
+	uint64_t mapChecksum() const { return m_mapChecksum; }
+
+	/// \return id of the swamp of the cell or NO_SWAMP
+	uint32_t region(const PointT& pnt) const
+	{
+		if (pnt.first < 0 || pnt.second < 0 || static_cast<size_t>(pnt.first) >= m_sizeX || static_cast<size_t>(pnt.second) >= m_sizeY)
+		{
+			return NO_SWAMP;
+		}
+		return m_regions[m_sizeX * pnt.second + pnt.first];
+	}
+
+	/// \return false if the search from startRegion to goalRegion doesn't need the cell
+	bool mayEnter(const PointT& pnt, uint32_t startRegion, uint32_t goalRegion) const
+	{
+		const uint32_t id = region(pnt);
+		return id == NO_SWAMP || id == startRegion || id == goalRegion;
+	}
+
+	/// Count of swamps
+	size_t count() const { return m_count; }
+
+	/// Count of cells in swamps
+	size_t cells() const
+	{
+		return m_regions.size() - std::count(m_regions.begin(), m_regions.end(), static_cast<uint32_t>(NO_SWAMP));
+	}
+
+private:
+	SwampRegions(uint64_t mapChecksum, size_t sizeX, size_t sizeY, size_t regionSize) :
+		m_mapChecksum(mapChecksum),
+		m_sizeX(sizeX),
+		m_sizeY(sizeY),
+		m_regionSize(regionSize),
+		m_count(0),
+		m_regions(sizeX * sizeY, static_cast<uint32_t>(NO_SWAMP))
+	{}
+
+	/// Offset of the neighbor by direction. The same order as BaseMap::getNeighbors
+	static const int* offset(int direction)
+	{
+		static const int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+		return offsets[direction];
+	}
+
+	/// Adjacent swamps get one id. So a route from a swamp leaves it to a cell out of all swamps
+	template<typename SimulationT>
+	void joinAdjacent(const SimulationT& simEngine);
+
+	/// Checks of candidates. Cells of found swamps are removed from the graph of moves
+	template<typename SimulationT>
+	struct Builder
+	{
+		Builder(const MapsModel& model, const SwampRegions& swamps) :
+			simEngine(model.elevation(), model.overrides(), std::numeric_limits<TimeT>::quiet_NaN()),
+			sizeX(static_cast<int>(model.getSizeX())),
+			sizeY(static_cast<int>(model.getSizeY())),
+			swamps(swamps),
+			times(model.getSizeX() * model.getSizeY(), std::numeric_limits<TimeT>::infinity()),
+			mark(model.getSizeX() * model.getSizeY(), 0),
+			stamp(0)
+		{}
+
+		/// Move time from a cell to its neighbor in the graph without swamps. NaN if there is no move
+		TimeT moveTime(const PointT& from, int direction, PointT& to) const
+		{
+			to = PointT(from.first + offset(direction)[0], from.second + offset(direction)[1]);
+			if (to.first < 0 || to.second < 0 || to.first >= sizeX || to.second >= sizeY || swamps.region(to) != NO_SWAMP)
+			{
+				return std::numeric_limits<TimeT>::quiet_NaN();
+			}
+			return simEngine.getTimeToNeighbour(from, to);
+		}
+
+		uint32_t id(const PointT& pnt) const { return static_cast<uint32_t>(pnt.second * sizeX + pnt.first); }
+
+		/// Regions of the tile: connected drivable cells out of swamps
+		std::vector<std::vector<PointT>> regions(int left, int top, int right, int bottom);
+
+		/** Parts of the graph of regions behind articulation regions, smaller than the rest of their island fragment.
+			\return indexes of regions of every part. Larger parts go first
+		*/
+		std::vector<std::vector<size_t>> deadEnds(const std::vector<std::vector<PointT>>& regions);
+
+		/// Drivable cells out of the region and swamps with a move to the region or from it
+		std::vector<PointT> boundary(const std::vector<PointT>& region);
+
+		/** Dijkstra from the source until all targets are settled or times exceed the limit.
+			\param avoid the region is not entered if it is not nullptr. Its cells are marked by the current stamp
+		*/
+		void search(const PointT& source, const std::vector<PointT>& targets, bool avoid, TimeT limit, std::vector<TimeT>& result);
+
+		/// \param boundary of the last region of boundary()
+		bool isSwamp(const std::vector<PointT>& boundary);
+
+		SimulationT simEngine;
+		const int sizeX;
+		const int sizeY;
+		const SwampRegions& swamps;
+		std::vector<TimeT> times;
+		std::vector<uint32_t> touched;
+		std::vector<uint32_t> mark;// == stamp for cells of the current region
+		uint32_t stamp;
+	};
+
+private:
+	const uint64_t m_mapChecksum;
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	const size_t m_regionSize;
+	size_t m_count;
+	std::vector<uint32_t> m_regions;
+};
+
+template<typename SimulationT>
+std::shared_ptr<const SwampRegions> SwampRegions::build(const MapsModel& model, size_t regionSize, std::function<void(size_t)> progress)
+{
+	if (regionSize == 0)
+	{
+		throw std::invalid_argument("Size of regions should be positive");
+	}
+	std::shared_ptr<SwampRegions> result(new SwampRegions(model.checksum(), model.getSizeX(), model.getSizeY(), regionSize));
+	Builder<SimulationT> builder(model, *result);
+	const size_t tilesX = (model.getSizeX() + regionSize - 1) / regionSize;
+	const size_t tilesY = (model.getSizeY() + regionSize - 1) / regionSize;
+	std::vector<uint8_t> dirty(tilesX * tilesY, 1);// tiles to check again
+	auto accept = [&](const std::vector<PointT>& swamp, const std::vector<PointT>& boundary) {
+		result->m_count += 1;
+		for (const auto& pnt : swamp)
+		{
+			result->m_regions[builder.id(pnt)] = static_cast<uint32_t>(result->m_count);
+		}
+		// Regions near the swamp have new boundaries
+		for (const auto& pnt : boundary)
+		{
+			dirty[(pnt.second / regionSize) * tilesX + pnt.first / regionSize] = 1;
+		}
+	};
+
+	std::vector<std::vector<PointT>> regions;
+	for (size_t top = 0; top < model.getSizeY(); top += regionSize)
+	{
+		for (size_t left = 0; left < model.getSizeX(); left += regionSize)
+		{
+			const int right = static_cast<int>(std::min(model.getSizeX(), left + regionSize));
+			const int bottom = static_cast<int>(std::min(model.getSizeY(), top + regionSize));
+			for (auto& region : builder.regions(static_cast<int>(left), static_cast<int>(top), right, bottom))
+			{
+				regions.push_back(std::move(region));
+			}
+		}
+	}
+	for (const auto& deadEnd : builder.deadEnds(regions))
+	{
+		// Parts are nested. Cells of smaller ones could be taken by a larger swamp already
+		std::vector<PointT> candidate;
+		for (size_t id : deadEnd)
+		{
+			for (const auto& pnt : regions[id])
+			{
+				if (result->region(pnt) == NO_SWAMP)
+				{
+					candidate.push_back(pnt);
+				}
+			}
+		}
+		if (candidate.empty())
+		{
+			continue;
+		}
+		const auto boundary = builder.boundary(candidate);
+		if (builder.isSwamp(boundary))
+		{
+			accept(candidate, boundary);
+		}
+	}
+	regions.clear();
+
+	// Sweeps until there are no new swamps
+	size_t checked = 0;
+	for (bool changed = true; changed; )
+	{
+		changed = false;
+		for (size_t tile = 0; tile < dirty.size(); ++tile)
+		{
+			if (!dirty[tile])
+			{
+				continue;
+			}
+			dirty[tile] = 0;
+			const size_t left = (tile % tilesX) * regionSize;
+			const size_t top = (tile / tilesX) * regionSize;
+			const int right = static_cast<int>(std::min(model.getSizeX(), left + regionSize));
+			const int bottom = static_cast<int>(std::min(model.getSizeY(), top + regionSize));
+			for (const auto& region : builder.regions(static_cast<int>(left), static_cast<int>(top), right, bottom))
+			{
+				const auto boundary = builder.boundary(region);
+				if (builder.isSwamp(boundary))
+				{
+					accept(region, boundary);
+					changed = true;
+				}
+			}
+			checked += 1;
+			if (progress)
+			{
+				progress(checked);
+			}
+		}
+	}
+	result->joinAdjacent(builder.simEngine);
+	return result;
+}
+
+template<typename SimulationT>
+void SwampRegions::joinAdjacent(const SimulationT& simEngine)
+{
+	const uint32_t UNLABELED = std::numeric_limits<uint32_t>::max();
+	for (auto& id : m_regions)
+	{
+		if (id != NO_SWAMP)
+		{
+			id = UNLABELED;
+		}
+	}
+	m_count = 0;
+	std::vector<PointT> front;
+	for (size_t cell = 0; cell < m_regions.size(); ++cell)
+	{
+		if (m_regions[cell] != UNLABELED)
+		{
+			continue;
+		}
+		m_count += 1;
+		m_regions[cell] = static_cast<uint32_t>(m_count);
+		front.assign(1, PointT(static_cast<int>(cell % m_sizeX), static_cast<int>(cell / m_sizeX)));
+		while (!front.empty())
+		{
+			const PointT pnt = front.back();
+			front.pop_back();
+			for (int direction = 0; direction < 8; ++direction)
+			{
+				const PointT neighbor(pnt.first + offset(direction)[0], pnt.second + offset(direction)[1]);
+				if (region(neighbor) != UNLABELED)
+				{
+					continue;
+				}
+				const TimeT there = simEngine.getTimeToNeighbour(pnt, neighbor);
+				const TimeT back = simEngine.getTimeToNeighbour(neighbor, pnt);
+				if (there == there || back == back)
+				{
+					m_regions[m_sizeX * neighbor.second + neighbor.first] = static_cast<uint32_t>(m_count);
+					front.push_back(neighbor);
+				}
+			}
+		}
+	}
+}
+
+template<typename SimulationT>
+std::vector<std::vector<PointT>> SwampRegions::Builder<SimulationT>::regions(int left, int top, int right, int bottom)
+{
+	std::vector<std::vector<PointT>> result;
+	stamp += 1;
+	for (int y = top; y < bottom; ++y)
+	{
+		for (int x = left; x < right; ++x)
+		{
+			const PointT start(x, y);
+			if (mark[id(start)] == stamp || swamps.region(start) != NO_SWAMP || !simEngine.isDrivable(start))
+			{
+				continue;
+			}
+			// Flood fill inside the tile. Moves between drivable cells are allowed in both directions
+			std::vector<PointT> region(1, start);
+			mark[id(start)] = stamp;
+			for (size_t next = 0; next < region.size(); ++next)
+			{
+				const PointT pnt = region[next];
+				for (int direction = 0; direction < 8; ++direction)
+				{
+					PointT neighbor;
+					const TimeT time = moveTime(pnt, direction, neighbor);
+					if (time != time || neighbor.first < left || neighbor.second < top || neighbor.first >= right || neighbor.second >= bottom ||
+						mark[id(neighbor)] == stamp)
+					{
+						continue;
+					}
+					mark[id(neighbor)] = stamp;
+					region.push_back(neighbor);
+				}
+			}
+			result.push_back(std::move(region));
+		}
+	}
+	return result;
+}
+
+template<typename SimulationT>
+std::vector<std::vector<size_t>> SwampRegions::Builder<SimulationT>::deadEnds(const std::vector<std::vector<PointT>>& regions)
+{
+	const size_t NONE = std::numeric_limits<size_t>::max();
+	// Graph of regions. Cells are labeled by regions
+	std::vector<uint32_t> labels(times.size(), std::numeric_limits<uint32_t>::max());
+	for (size_t region = 0; region < regions.size(); ++region)
+	{
+		for (const auto& pnt : regions[region])
+		{
+			labels[id(pnt)] = static_cast<uint32_t>(region);
+		}
+	}
+	std::vector<std::vector<size_t>> links(regions.size());
+	for (size_t region = 0; region < regions.size(); ++region)
+	{
+		for (const auto& pnt : regions[region])
+		{
+			for (int direction = 0; direction < 8; ++direction)
+			{
+				PointT neighbor;
+				const TimeT time = moveTime(pnt, direction, neighbor);
+				if (time == time && labels[id(neighbor)] != region)
+				{
+					links[region].push_back(labels[id(neighbor)]);
+				}
+			}
+		}
+		std::sort(links[region].begin(), links[region].end());
+		links[region].erase(std::unique(links[region].begin(), links[region].end()), links[region].end());
+	}
+
+	// Articulation points by iterative DFS (Tarjan). Subtree of a node is a range of the preorder
+	std::vector<size_t> order;// preorder
+	std::vector<size_t> index(regions.size(), NONE);// in the preorder
+	std::vector<size_t> low(regions.size(), 0);
+	std::vector<size_t> subtreeEnd(regions.size(), 0);
+	std::vector<std::pair<size_t, size_t>> parts;// (child, root of the fragment) of parts behind articulation regions
+	std::vector<std::pair<size_t, size_t>> stack;// (region, next link)
+	std::vector<size_t> parent(regions.size(), NONE);
+	for (size_t root = 0; root < regions.size(); ++root)
+	{
+		if (index[root] != NONE)
+		{
+			continue;
+		}
+		index[root] = low[root] = order.size();
+		order.push_back(root);
+		stack.push_back(std::make_pair(root, 0));
+		while (!stack.empty())
+		{
+			const size_t node = stack.back().first;
+			if (stack.back().second < links[node].size())
+			{
+				const size_t next = links[node][stack.back().second++];
+				if (index[next] == NONE)
+				{
+					parent[next] = node;
+					index[next] = low[next] = order.size();
+					order.push_back(next);
+					stack.push_back(std::make_pair(next, 0));
+				}
+				else if (next != parent[node])
+				{
+					low[node] = std::min(low[node], index[next]);
+				}
+				continue;
+			}
+			stack.pop_back();
+			subtreeEnd[node] = order.size();
+			if (parent[node] != NONE)
+			{
+				low[parent[node]] = std::min(low[parent[node]], low[node]);
+				// The root separates all its children, other nodes separate children without back links above them
+				if (low[node] >= index[parent[node]])
+				{
+					parts.push_back(std::make_pair(node, root));
+				}
+			}
+		}
+	}
+
+	std::vector<size_t> prefixCells(order.size() + 1, 0);
+	for (size_t id = 0; id < order.size(); ++id)
+	{
+		prefixCells[id + 1] = prefixCells[id] + regions[order[id]].size();
+	}
+	auto subtreeCells = [&](size_t node) { return prefixCells[subtreeEnd[node]] - prefixCells[index[node]]; };
+	std::vector<std::pair<size_t, size_t>> candidates;// (cells, child)
+	for (const auto& part : parts)
+	{
+		const size_t cells = subtreeCells(part.first);
+		if (2 * cells <= subtreeCells(part.second))
+		{
+			candidates.push_back(std::make_pair(cells, part.first));
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<size_t, size_t>>());
+	std::vector<std::vector<size_t>> result;
+	for (const auto& candidate : candidates)
+	{
+		const size_t child = candidate.second;
+		result.push_back(std::vector<size_t>(order.begin() + index[child], order.begin() + subtreeEnd[child]));
+	}
+	return result;
+}
+
+template<typename SimulationT>
+std::vector<PointT> SwampRegions::Builder<SimulationT>::boundary(const std::vector<PointT>& region)
+{
+	// Cells of the region are marked by one stamp, boundary cells by the next one
+	const uint32_t regionStamp = ++stamp;
+	const uint32_t boundaryStamp = ++stamp;
+	std::vector<PointT> result;
+	for (const auto& pnt : region)
+	{
+		mark[id(pnt)] = regionStamp;
+	}
+	for (const auto& pnt : region)
+	{
+		for (int direction = 0; direction < 8; ++direction)
+		{
+			PointT neighbor;
+			const TimeT time = moveTime(pnt, direction, neighbor);
+			if (time != time || mark[id(neighbor)] == regionStamp || mark[id(neighbor)] == boundaryStamp)
+			{
+				continue;
+			}
+			mark[id(neighbor)] = boundaryStamp;
+			result.push_back(neighbor);
+		}
+	}
+	// Keep the region marked for search()
+	stamp += 1;
+	for (const auto& pnt : region)
+	{
+		mark[id(pnt)] = stamp;
+	}
+	return result;
+}
+
+template<typename SimulationT>
+void SwampRegions::Builder<SimulationT>::search(const PointT& source, const std::vector<PointT>& targets, bool avoid, TimeT limit,
+												std::vector<TimeT>& result)
+{
+	for (uint32_t cell : touched)
+	{
+		times[cell] = std::numeric_limits<TimeT>::infinity();
+	}
+	touched.clear();
+
+	typedef std::pair<TimeT, uint32_t> NodeT;
+	std::priority_queue<NodeT, std::vector<NodeT>, std::greater<NodeT>> queue;
+	times[id(source)] = 0.0;
+	touched.push_back(id(source));
+	queue.push(std::make_pair(0.0, id(source)));
+	size_t remaining = targets.size();
+	std::vector<uint32_t> targetIds;
+	for (const auto& target : targets)
+	{
+		targetIds.push_back(id(target));
+	}
+	std::sort(targetIds.begin(), targetIds.end());
+	while (!queue.empty() && remaining)
+	{
+		const NodeT node = queue.top();
+		queue.pop();
+		if (times[node.second] < node.first)
+		{
+			continue;
+		}
+		if (node.first > limit)
+		{
+			break;
+		}
+		if (std::binary_search(targetIds.begin(), targetIds.end(), node.second))
+		{
+			remaining -= 1;
+		}
+		const PointT pnt(static_cast<int>(node.second % sizeX), static_cast<int>(node.second / sizeX));
+		for (int direction = 0; direction < 8; ++direction)
+		{
+			PointT neighbor;
+			const TimeT time = moveTime(pnt, direction, neighbor);
+			if (time != time || (avoid && mark[id(neighbor)] == stamp))
+			{
+				continue;
+			}
+			const uint32_t neighborId = id(neighbor);
+			const TimeT newTime = node.first + time;
+			if (!(newTime < times[neighborId]))
+			{
+				continue;
+			}
+			if (times[neighborId] == std::numeric_limits<TimeT>::infinity())
+			{
+				touched.push_back(neighborId);
+			}
+			times[neighborId] = newTime;
+			queue.push(std::make_pair(newTime, neighborId));
+		}
+	}
+	result.clear();
+	for (const auto& target : targets)
+	{
+		result.push_back(times[id(target)]);
+	}
+}
+
+template<typename SimulationT>
+bool SwampRegions::Builder<SimulationT>::isSwamp(const std::vector<PointT>& cells)
+{
+	if (cells.empty())
+	{
+		// An islet, components reject routes to it
+		return false;
+	}
+	std::vector<TimeT> through;
+	std::vector<TimeT> around;
+	for (const auto& source : cells)
+	{
+		search(source, cells, false, std::numeric_limits<TimeT>::infinity(), through);
+		const TimeT limit = *std::max_element(through.begin(), through.end()) * (1.0 + SAME_TIME_TOLERANCE);
+		search(source, cells, true, limit, around);
+		for (size_t target = 0; target < cells.size(); ++target)
+		{
+			if (!(around[target] <= through[target] * (1.0 + SAME_TIME_TOLERANCE)))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+inline std::shared_ptr<const SwampRegions> SwampRegions::load(const std::string& filename, const MapsModel& model)
+{
+	std::ifstream in(filename, std::ifstream::binary);
+	if (!in.good())
+	{
+		throw std::runtime_error("Can't open swamps");
+	}
+	SwampsHeader header;
+	in.read((char*)&header, sizeof(header));
+	if (!in.good() || memcmp(header.signature, "ISLESWMP", sizeof(header.signature)) != 0)
+	{
+		throw std::runtime_error("It is not a swamps file");
+	}
+	if (header.version != VERSION)
+	{
+		throw std::runtime_error("Unsupported version of swamps: " + std::to_string(header.version));
+	}
+	if (header.sizeX != model.getSizeX() || header.sizeY != model.getSizeY() || header.mapChecksum != model.checksum())
+	{
+		throw std::runtime_error("Swamps are built for another map");
+	}
+	std::shared_ptr<SwampRegions> result(new SwampRegions(header.mapChecksum, header.sizeX, header.sizeY, header.regionSize));
+	result->m_count = header.count;
+	in.read((char*)&result->m_regions[0], result->m_regions.size() * sizeof(uint32_t));
+	if (!in.good())
+	{
+		throw std::runtime_error("Swamps file is truncated");
+	}
+	return result;
+}
+
+inline void SwampRegions::save(const std::string& filename) const
+{
+	std::ofstream out(filename, std::ofstream::binary);
+	SwampsHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, "ISLESWMP", sizeof(header.signature));
+	header.version = VERSION;
+	header.mapChecksum = m_mapChecksum;
+	header.sizeX = static_cast<uint32_t>(m_sizeX);
+	header.sizeY = static_cast<uint32_t>(m_sizeY);
+	header.regionSize = static_cast<uint32_t>(m_regionSize);
+	header.count = static_cast<uint32_t>(m_count);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)&m_regions[0], m_regions.size() * sizeof(uint32_t));
+	out.flush();
+	if (!out.good())
+	{
+		throw std::runtime_error("Can't write swamps");
+	}
+}
+
+#endif // __SWAMPS_H__
@@ -0,0 +1,142 @@
+#ifndef __TARGET_GRID_H__
+#define __TARGET_GRID_H__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <maps.h>
+
+/** Spatial index of targets of RouteBuilder::nearest. Targets are kept in square buckets of a grid over the map.
+The size of a bucket is chosen for about one target per bucket, so a lookup scans a few of them.
+The nearest target by octile distance is looked for in rings of buckets around the cell of the lookup.
+Cells of the ring r are not closer than (r - 1) * bucket size + 1 by both axes, so rings stop at the closest found one.
+Settled targets are removed, the estimation of the search grows to the remaining ones.
+*/
+struct TargetGrid
+{
+	/// Target cell and its index in targets of the query. A cell could have a few targets
+	using TargetT = std::pair<PointT, size_t>;
+
+	/// \param expected count of targets
+	TargetGrid(size_t sizeX, size_t sizeY, size_t expected) :
+		m_bucketSize(bucketSize(sizeX, sizeY, expected)),
+		m_bucketsX((sizeX + m_bucketSize - 1) / m_bucketSize),
+		m_bucketsY((sizeY + m_bucketSize - 1) / m_bucketSize),
+		m_buckets(m_bucketsX * m_bucketsY),
+		m_count(0)
+	{}
+
+	void add(const PointT& pnt, size_t id)
+	{
+		m_buckets[bucket(pnt)].push_back(TargetT(pnt, id));
+		m_count += 1;
+	}
+
+	bool empty() const { return m_count == 0; }
+
+	/// \return there is a target in the cell
+	bool contains(const PointT& pnt) const
+	{
+		const auto& targets = m_buckets[bucket(pnt)];
+		return std::any_of(targets.begin(), targets.end(), [&pnt](const TargetT& target) { return target.first == pnt; });
+	}
+
+	/// Removes targets of the cell. Function is called for indexes of them
+	template<typename FunctionT>
+	void remove(const PointT& pnt, FunctionT function)
+	{
+		auto& targets = m_buckets[bucket(pnt)];
+		auto last = std::remove_if(targets.begin(), targets.end(), [&](const TargetT& target) {
+			if (target.first != pnt)
+			{
+				return false;
+			}
+			function(target.second);
+			return true;
+		});
+		m_count -= targets.end() - last;
+		targets.erase(last, targets.end());
+	}
+
+	/** Finds the closest target by octile distance.
+		\return false if there are no targets
+	*/
+	bool nearest(const PointT& pnt, PointT& result) const
+	{
+		const size_t bucketX = std::min(static_cast<size_t>(std::max(0, pnt.first)) / m_bucketSize, m_bucketsX - 1);
+		const size_t bucketY = std::min(static_cast<size_t>(std::max(0, pnt.second)) / m_bucketSize, m_bucketsY - 1);
+		const size_t lastRing = std::max(std::max(bucketX, m_bucketsX - 1 - bucketX), std::max(bucketY, m_bucketsY - 1 - bucketY));
+		double best = std::numeric_limits<double>::infinity();
+		for (size_t ring = 0; ring <= lastRing; ++ring)
+		{
+			if (ring > 0 && static_cast<double>((ring - 1) * m_bucketSize + 1) > best)
+			{
+				break;
+			}
+			// Buckets of the ring: rows at the top and the bottom, columns at the left and the right between them
+			const long minX = static_cast<long>(bucketX) - static_cast<long>(ring);
+			const long maxX = static_cast<long>(bucketX + ring);
+			const long minY = static_cast<long>(bucketY) - static_cast<long>(ring);
+			const long maxY = static_cast<long>(bucketY + ring);
+			for (long y = minY; y <= maxY; ++y)
+			{
+				const long step = (y == minY || y == maxY || ring == 0) ? 1 : maxX - minX;
+				for (long x = minX; x <= maxX; x += step)
+				{
+					if (x < 0 || y < 0 || x >= static_cast<long>(m_bucketsX) || y >= static_cast<long>(m_bucketsY))
+					{
+						continue;
+					}
+					for (const auto& target : m_buckets[y * m_bucketsX + x])
+					{
+						const double distance = octile(pnt, target.first);
+						if (distance < best)
+						{
+							best = distance;
+							result = target.first;
+						}
+					}
+				}
+			}
+		}
+		return best < std::numeric_limits<double>::infinity();
+	}
+
+private:
+	static size_t bucketSize(size_t sizeX, size_t sizeY, size_t expected)
+	{
+		const double side = sqrt(static_cast<double>(sizeX * sizeY) / std::max<size_t>(1, expected));
+		size_t result = MIN_BUCKET;
+		while (result < side && result < std::max(sizeX, sizeY))
+		{
+			result *= 2;
+		}
+		return result;
+	}
+
+	size_t bucket(const PointT& pnt) const
+	{
+		return (pnt.second / m_bucketSize) * m_bucketsX + pnt.first / m_bucketSize;
+	}
+
+	static double octile(const PointT& from, const PointT& to)
+	{
+		const int dX = std::abs(from.first - to.first);
+		const int dY = std::abs(from.second - to.second);
+		return std::max(dX, dY) + (sqrt(2.0) - 1.0) * std::min(dX, dY);
+	}
+
+	static const size_t MIN_BUCKET = 8;
+
+private:
+	const size_t m_bucketSize;
+	const size_t m_bucketsX;
+	const size_t m_bucketsY;
+	std::vector<std::vector<TargetT>> m_buckets;
+	size_t m_count;
+};
+
+#endif // __TARGET_GRID_H__
@@ -0,0 +1,436 @@
+#ifndef __TRIP_PLANNER_H__
+#define __TRIP_PLANNER_H__
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include <arena.h>
+#include <sparse_map.h>
+#include "model.h"
+#include "router.h"
+
+/** This class plans the order of stops of a multi-stop trip (pickups of a rover).
+RouteBuilder drives stops in the order of moveTo calls. The planner chooses the order with the minimal time of the trip.
+1)	Table of travel times between all points. There is one Dijkstra per point. It stops when all stops are settled.
+	Searches of different points are independent, they run in parallel. Every thread has its own search state.
+	Moves are not symmetric in general (climbs are slower than descents), so the table is not symmetric too.
+2)	Order of stops. The trip starts at the current location and ends at the last stop.
+	Up to EXACT_LIMIT stops the order is exact by dynamic programming over subsets (Held-Karp).
+	Longer trips start from the nearest neighbor order. It is improved by 2-opt (reversal of a part of the trip)
+	and Or-opt (move of 1..3 stops to another place) until there are no improvements.
+3)	Routes of chosen legs only are built by RouteBuilder::moveTo.
+There is no way between some points if they are on different island fragments or moves are one way.
+Legs without a way cost UNREACHABLE_PENALTY. So heuristics still find an order with ways only if it exists.
+*/
+template<typename SimulationT, typename QueueT>
+struct TripPlanner
+{
+	static const double UNREACHABLE; // is NaN
+	static const size_t EXACT_LIMIT = 12; // stops count of the exact order. Work is 2^n * n^2
+	static const TimeT UNREACHABLE_PENALTY; // cost of a leg without a way
+
+	explicit TripPlanner(const MapsModel& model, size_t threadsCount = 0) :
+		m_model(model),
+		m_replicas(model),
+		m_threadsCount(threadsCount ? threadsCount : std::max<size_t>(1, std::thread::hardware_concurrency())),
+		m_searchedItems(0)
+	{}
+
+	/*! Moves the router through all stops in the order with the minimal time of the trip.
+		\param[out] order indexes of stops in the order of visit
+		\return false if some stop can't be reached. The route of the router is not changed then:
+		legs driven before a leg without a way (e.g. maps of the store are changed after planning) are rolled back.
+	*/
+	template<typename RouterT>
+	bool visit(RouterT& router, const std::vector<PointT>& stops, std::vector<size_t>& order)
+	{
+		std::vector<PointT> points(1, router.location());
+		points.insert(points.end(), stops.begin(), stops.end());
+		for (const auto& stop : stops)
+		{
+			if (m_model.hasComponents() && !m_model.components().mayReach(points[0], stop))
+			{
+				return false;
+			}
+		}
+		const auto times = travelTimes(points);
+		const auto trip = bestOrder(times, points.size());
+		if (!(tripTime(times, points.size(), trip) < UNREACHABLE_PENALTY))
+		{
+			return false;
+		}
+		const RouteMark mark = router.mark();
+		std::vector<size_t> visited;
+		try
+		{
+			for (size_t step = 1; step < trip.size(); ++step)
+			{
+				if (!router.moveTo(points[trip[step]]))
+				{
+					router.rollback(mark);
+					return false;
+				}
+				visited.push_back(trip[step] - 1);
+			}
+		}
+		catch (...)
+		{
+			router.rollback(mark);
+			throw;
+		}
+		order.swap(visited);
+		return true;
+	}
+
+	/*! Times of optimal routes between points.
+		\return times[from * count + to]. It is NaN if there is no way. Times to points[0] are not calculated.
+	*/
+	std::vector<TimeT> travelTimes(const std::vector<PointT>& points)
+	{
+		const size_t count = points.size();
+		std::vector<TimeT> times(count * count, UNREACHABLE);
+		std::atomic<size_t> next(0);
+		auto work = [&](size_t thread) {
+			// Maps of the node of the thread, the scratch grid of the worker is placed on the node too
+			Worker worker(m_replicas.bind(thread));
+			for (size_t from = next++; from < count; from = next++)
+			{
+				search(worker, points, from, &times[from * count]);
+			}
+			m_searchedItems += worker.searchedItems;
+		};
+		// The caller's thread only waits: workers are bound to NUMA nodes, its affinity is kept
+		std::vector<std::thread> threads;
+		for (size_t id = 0; id < std::min(m_threadsCount, count); ++id)
+		{
+			threads.push_back(std::thread(work, id));
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		return times;
+	}
+
+	/*! Order of visit of all points from points[0].
+		\return indexes of points, the first one is 0
+	*/
+	std::vector<size_t> bestOrder(const std::vector<TimeT>& times, size_t count) const
+	{
+		const auto costs = toCosts(times);
+		if (count <= EXACT_LIMIT + 1)
+		{
+			return exactOrder(costs, count);
+		}
+		auto order = nearestNeighborOrder(costs, count);
+		for (bool improved = true; improved; )
+		{
+			improved = twoOpt(costs, count, order);
+			improved = orOpt(costs, count, order) || improved;
+		}
+		return order;
+	}
+
+	/// \return time of the trip by the order. Legs without a way cost UNREACHABLE_PENALTY
+	static TimeT tripTime(const std::vector<TimeT>& times, size_t count, const std::vector<size_t>& order)
+	{
+		TimeT result = 0.0;
+		for (size_t step = 1; step < order.size(); ++step)
+		{
+			const TimeT time = times[order[step - 1] * count + order[step]];
+			result += (time != time) ? UNREACHABLE_PENALTY : time;
+		}
+		return result;
+	}
+
+	size_t searchedItems() const { return m_searchedItems; }//statistic
+
+private:
+	static constexpr TimeT MIN_IMPROVEMENT = 1e-6; // less changes are errors of rounding
+
+	/// Search state of a thread
+	struct Worker
+	{
+		explicit Worker(const MapsModel& model) :
+			simEngine(model.elevation(), model.overrides(), UNREACHABLE),
+			timeToArrive(model.getSizeX(), model.getSizeY()),
+			searchedItems(0)
+		{}
+
+		SimulationT simEngine;
+		SparseRWMap<> timeToArrive;// only the explored area is kept. It is a ball around the start
+		Arena arena;
+		size_t searchedItems;//statistic
+	};
+
+	/// Dijkstra from points[from]. It stops when all other points except points[0] are settled
+	void search(Worker& worker, const std::vector<PointT>& points, size_t from, TimeT* times) const
+	{
+		auto isLower = [](const TimeT& val1, const TimeT& val2) { return !(val1 != val1) && (val1 < val2); };
+		const PointT& start = points[from];
+		std::vector<PointT> targets;
+		for (size_t to = 1; to < points.size(); ++to)
+		{
+			if (points[to] != start && worker.simEngine.isDrivable(points[to]))
+			{
+				targets.push_back(points[to]);
+			}
+		}
+		std::sort(targets.begin(), targets.end());
+		targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+		std::vector<bool> settled(targets.size(), false);
+		size_t remaining = targets.size();
+
+		auto& timeToArrive = worker.timeToArrive;
+		timeToArrive.reset();
+		timeToArrive.put(start, 0);
+		worker.arena.release();
+		QueueT queue = QueueFactory<QueueT>::create(worker.arena);
+		queue.push(0.0, std::make_pair(start, 0.0));
+		while (remaining && !queue.empty())
+		{
+			auto curNode = queue.front().second;
+			auto& curPoint = curNode.first;
+			auto& timeToPoint = curNode.second;
+			queue.pop();
+			// If the node is processed and has a lower time value - skip it
+			if (isLower(timeToArrive.get(curPoint), timeToPoint))
+			{
+				continue;
+			}
+			worker.searchedItems += 1;
+			auto target = std::lower_bound(targets.begin(), targets.end(), curPoint);
+			if (target != targets.end() && *target == curPoint && !settled[target - targets.begin()])
+			{
+				settled[target - targets.begin()] = true;
+				remaining -= 1;
+			}
+			for (auto& neighbor : timeToArrive.getNeighbors(curPoint))
+			{
+				if (!worker.simEngine.isDrivable(neighbor))
+				{
+					continue;
+				}
+				TimeT timeForMove = worker.simEngine.getTimeToNeighbour(curPoint, neighbor);
+				if (timeForMove != timeForMove)
+				{
+					continue;
+				}
+				auto newTime = timeToPoint + timeForMove;
+				if (isLower(timeToArrive.get(neighbor), newTime))
+				{
+					continue;
+				}
+				timeToArrive.put(neighbor, newTime);
+				queue.push(newTime, std::make_pair(neighbor, newTime));
+			}
+		}
+		for (size_t to = 1; to < points.size(); ++to)
+		{
+			times[to] = (to == from) ? 0.0 : timeToArrive.get(points[to]);
+		}
+	}
+
+	static std::vector<TimeT> toCosts(const std::vector<TimeT>& times)
+	{
+		std::vector<TimeT> costs(times);
+		for (auto& cost : costs)
+		{
+			cost = (cost != cost) ? UNREACHABLE_PENALTY : cost;
+		}
+		return costs;
+	}
+
+	/// Held-Karp. cost[mask][last] is the minimal time from points[0] through stops of mask to the last stop
+	static std::vector<size_t> exactOrder(const std::vector<TimeT>& costs, size_t count)
+	{
+		const size_t stops = count - 1;
+		std::vector<size_t> order(1, 0);
+		if (!stops)
+		{
+			return order;
+		}
+		const size_t masks = size_t(1) << stops;
+		std::vector<TimeT> cost(masks * stops, std::numeric_limits<TimeT>::infinity());
+		std::vector<uint8_t> previous(masks * stops, 0);
+		for (size_t last = 0; last < stops; ++last)
+		{
+			cost[(size_t(1) << last) * stops + last] = costs[last + 1];
+		}
+		for (size_t mask = 1; mask < masks; ++mask)
+		{
+			for (size_t last = 0; last < stops; ++last)
+			{
+				const TimeT current = cost[mask * stops + last];
+				if (!(mask & (size_t(1) << last)) || current == std::numeric_limits<TimeT>::infinity())
+				{
+					continue;
+				}
+				for (size_t next = 0; next < stops; ++next)
+				{
+					if (mask & (size_t(1) << next))
+					{
+						continue;
+					}
+					const size_t nextId = (mask | (size_t(1) << next)) * stops + next;
+					const TimeT time = current + costs[(last + 1) * count + next + 1];
+					if (time < cost[nextId])
+					{
+						cost[nextId] = time;
+						previous[nextId] = static_cast<uint8_t>(last);
+					}
+				}
+			}
+		}
+		// The best last stop and back by previous stops
+		size_t mask = masks - 1;
+		size_t last = 0;
+		for (size_t id = 1; id < stops; ++id)
+		{
+			if (cost[mask * stops + id] < cost[mask * stops + last])
+			{
+				last = id;
+			}
+		}
+		std::vector<size_t> reversed;
+		while (mask)
+		{
+			reversed.push_back(last + 1);
+			const size_t prev = previous[mask * stops + last];
+			mask &= ~(size_t(1) << last);
+			last = prev;
+		}
+		order.insert(order.end(), reversed.rbegin(), reversed.rend());
+		return order;
+	}
+
+	static std::vector<size_t> nearestNeighborOrder(const std::vector<TimeT>& costs, size_t count)
+	{
+		std::vector<size_t> order(1, 0);
+		std::vector<bool> visited(count, false);
+		visited[0] = true;
+		for (size_t step = 1; step < count; ++step)
+		{
+			size_t best = count;
+			for (size_t next = 1; next < count; ++next)
+			{
+				if (!visited[next] && (best == count || costs[order.back() * count + next] < costs[order.back() * count + best]))
+				{
+					best = next;
+				}
+			}
+			visited[best] = true;
+			order.push_back(best);
+		}
+		return order;
+	}
+
+	/*! Reversal of order[i..j] if it makes the trip shorter. Times of a reversed part are taken backward
+		because the table is not symmetric. Sums of legs forward and backward make a check O(1).
+		\return true if the order is improved
+	*/
+	static bool twoOpt(const std::vector<TimeT>& costs, size_t count, std::vector<size_t>& order)
+	{
+		// by positions in the order
+		auto cost = [&](size_t from, size_t to) { return costs[order[from] * count + order[to]]; };
+		const size_t size = order.size();
+		std::vector<TimeT> forward(size, 0.0);// forward[k] is the time of legs before position k
+		std::vector<TimeT> backward(size, 0.0);// the same for legs driven backward
+		bool result = false;
+		for (bool improved = true; improved; )
+		{
+			improved = false;
+			for (size_t pos = 1; pos < size; ++pos)
+			{
+				forward[pos] = forward[pos - 1] + cost(pos - 1, pos);
+				backward[pos] = backward[pos - 1] + cost(pos, pos - 1);
+			}
+			for (size_t i = 1; i + 1 < size && !improved; ++i)
+			{
+				for (size_t j = i + 1; j < size && !improved; ++j)
+				{
+					const bool hasNext = (j + 1 < size);
+					const TimeT before = cost(i - 1, i) + (forward[j] - forward[i]) + (hasNext ? cost(j, j + 1) : 0.0);
+					const TimeT after = cost(i - 1, j) + (backward[j] - backward[i]) + (hasNext ? cost(i, j + 1) : 0.0);
+					if (after < before - MIN_IMPROVEMENT)
+					{
+						std::reverse(order.begin() + i, order.begin() + j + 1);
+						improved = true;
+						result = true;
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+	/*! Moves of order[i..i + length - 1] between other stops if it makes the trip shorter. The part is not reversed.
+		\return true if the order is improved
+	*/
+	static bool orOpt(const std::vector<TimeT>& costs, size_t count, std::vector<size_t>& order)
+	{
+		const size_t MAX_LENGTH = 3;
+		// by indexes of points, not by positions in the order
+		auto cost = [&](size_t from, size_t to) { return costs[from * count + to]; };
+		const size_t size = order.size();
+		bool result = false;
+		for (bool improved = true; improved; )
+		{
+			improved = false;
+			for (size_t length = 1; length <= MAX_LENGTH && !improved; ++length)
+			{
+				for (size_t i = 1; i + length <= size && !improved; ++i)
+				{
+					const size_t first = order[i];
+					const size_t last = order[i + length - 1];
+					const size_t prev = order[i - 1];
+					const bool hasNext = (i + length < size);
+					const TimeT removed = cost(prev, first) + (hasNext ? cost(last, order[i + length]) - cost(prev, order[i + length]) : 0.0);
+					// Insertion after position pos of the order without the part
+					for (size_t pos = 0; pos < size && !improved; ++pos)
+					{
+						if (pos + 1 >= i && pos < i + length)
+						{
+							continue;
+						}
+						const size_t after = order[pos];
+						const bool hasFollowing = (pos + 1 < size);
+						const TimeT added = cost(after, first) + (hasFollowing ? cost(last, order[pos + 1]) - cost(after, order[pos + 1]) : 0.0);
+						if (added < removed - MIN_IMPROVEMENT)
+						{
+							std::vector<size_t> part(order.begin() + i, order.begin() + i + length);
+							order.erase(order.begin() + i, order.begin() + i + length);
+							const size_t insertAt = (pos < i) ? pos + 1 : pos + 1 - length;
+							order.insert(order.begin() + insertAt, part.begin(), part.end());
+							improved = true;
+							result = true;
+						}
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+private:
+	const MapsModel& m_model;
+	MapsReplicas m_replicas;
+	const size_t m_threadsCount;
+	std::atomic<size_t> m_searchedItems;//statistic
+};
+
+template<typename SimulationT, typename QueueT>
+const double TripPlanner<SimulationT, QueueT>::UNREACHABLE = std::numeric_limits<double>::quiet_NaN();
+
+template<typename SimulationT, typename QueueT>
+const TimeT TripPlanner<SimulationT, QueueT>::UNREACHABLE_PENALTY = 1e9;
+
+template<typename SimulationT, typename QueueT>
+constexpr TimeT TripPlanner<SimulationT, QueueT>::MIN_IMPROVEMENT;
+
+#endif // __TRIP_PLANNER_H__
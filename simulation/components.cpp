@@ -0,0 +1,137 @@
+#include "components.h"
+#include <deque>
+#include <stdexcept>
+#include <string.h>
+
+constexpr uint32_t ConnectedComponents::NO_COMPONENT;
+
+std::shared_ptr<ConnectedComponents> ConnectedComponents::load(const uint8_t* data, size_t size, size_t sizeX, size_t sizeY,
+																std::shared_ptr<const void> owner)
+{
+	const size_t cells = sizeX * sizeY;
+	uint32_t counts[2] = { 0, 0 };
+	if (size < sizeof(counts))
+	{
+		throw std::runtime_error("Wrong size of components data");
+	}
+	memcpy(counts, data, sizeof(counts));
+	const size_t expectedSize = sizeof(counts) + cells * sizeof(uint32_t) +
+		counts[0] * sizeof(uint64_t) + counts[1] * 2 * sizeof(uint32_t);
+	if (size != expectedSize)
+	{
+		throw std::runtime_error("Wrong size of components data");
+	}
+
+	std::shared_ptr<ConnectedComponents> result(new ConnectedComponents(sizeX, sizeY));
+	const uint8_t* labels = data + sizeof(counts);
+	if (reinterpret_cast<uintptr_t>(labels) % alignof(uint32_t) == 0)
+	{
+		result->m_labels = reinterpret_cast<const uint32_t*>(labels);
+		result->m_owner = owner;
+	}
+	else
+	{
+		result->m_ownLabels.resize(cells);
+		memcpy(&result->m_ownLabels[0], labels, cells * sizeof(uint32_t));
+		result->m_labels = &result->m_ownLabels[0];
+	}
+	const uint8_t* sizes = labels + cells * sizeof(uint32_t);
+	result->m_sizes.resize(counts[0]);
+	if (counts[0])
+	{
+		memcpy(&result->m_sizes[0], sizes, counts[0] * sizeof(uint64_t));
+	}
+	const uint8_t* edges = sizes + counts[0] * sizeof(uint64_t);
+	for (uint32_t id = 0; id < counts[1]; ++id)
+	{
+		uint32_t edge[2];
+		memcpy(edge, edges + id * sizeof(edge), sizeof(edge));
+		result->m_edges.push_back(std::make_pair(edge[0], edge[1]));
+	}
+	return result;
+}
+
+std::vector<uint8_t> ConnectedComponents::serialize() const
+{
+	const size_t cells = m_sizeX * m_sizeY;
+	const uint32_t counts[2] = { static_cast<uint32_t>(m_sizes.size()), static_cast<uint32_t>(m_edges.size()) };
+	std::vector<uint8_t> data;
+	auto append = [&data](const void* from, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(from);
+		data.insert(data.end(), bytes, bytes + size);
+	};
+	append(counts, sizeof(counts));
+	append(m_labels, cells * sizeof(uint32_t));
+	if (!m_sizes.empty())
+	{
+		append(&m_sizes[0], m_sizes.size() * sizeof(uint64_t));
+	}
+	for (const auto& edge : m_edges)
+	{
+		const uint32_t pair[2] = { edge.first, edge.second };
+		append(pair, sizeof(pair));
+	}
+	return data;
+}
+
+bool ConnectedComponents::mayReach(const PointT& from, const PointT& to) const
+{
+	const uint32_t toComponent = label(to);
+	if (toComponent == NO_COMPONENT)
+	{
+		return false;
+	}
+	const uint32_t fromComponent = label(from);
+	if (fromComponent != NO_COMPONENT)
+	{
+		return isReachable(fromComponent, toComponent);
+	}
+	// Start is not drivable. Try to leave it to any neighbor
+	for (int dY = -1; dY <= 1; ++dY)
+	{
+		for (int dX = -1; dX <= 1; ++dX)
+		{
+			const uint32_t component = label(std::make_pair(from.first + dX, from.second + dY));
+			if (component != NO_COMPONENT && isReachable(component, toComponent))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool ConnectedComponents::isReachable(uint32_t fromComponent, uint32_t toComponent) const
+{
+	if (fromComponent == toComponent)
+	{
+		return true;
+	}
+	// Symmetric moves have no edges between components
+	if (m_edges.empty())
+	{
+		return false;
+	}
+	std::vector<bool> visited(m_sizes.size(), false);
+	std::deque<uint32_t> queue(1, fromComponent);
+	visited[fromComponent] = true;
+	while (!queue.empty())
+	{
+		const uint32_t component = queue.front();
+		queue.pop_front();
+		auto edge = std::lower_bound(m_edges.begin(), m_edges.end(), std::make_pair(component, uint32_t(0)));
+		for (; edge != m_edges.end() && edge->first == component; ++edge)
+		{
+			if (edge->second == toComponent)
+			{
+				return true;
+			}
+			if (!visited[edge->second])
+			{
+				visited[edge->second] = true;
+				queue.push_back(edge->second);
+			}
+		}
+	}
+	return false;
+}
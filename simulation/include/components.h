@@ -0,0 +1,198 @@
+#ifndef __COMPONENTS_H__
+#define __COMPONENTS_H__
+
+#include <maps.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+/*! Strongly connected components of drivable cells.
+There is an edge from a drivable cell to a neighbor if the simulation allows to move there (getTimeToNeighbour is not NaN).
+It is directional in general: a simulation could forbid steep climbs but allow descents.
+Every drivable cell has a label of its component. Not drivable cells have NO_COMPONENT.
+Components are connected by edges of the condensation graph (a DAG). It has no edges if moves are symmetric.
+
+It allows to reject a route to another island fragment before any search:
+the destination is reachable iff its component is reachable from a component of the start in the DAG.
+If components are the same it is O(1). The DAG is searched only if moves are not symmetric.
+*/
+struct ConnectedComponents
+{
+	static constexpr uint32_t NO_COMPONENT = 0xFFFFFFFF;
+
+	/// Calculates components by Tarjan's algorithm (iterative, the map is too large for recursion)
+	template<typename SimulationT>
+	static std::shared_ptr<ConnectedComponents> build(const MapExplorer& elevation, const MapExplorer& overrides);
+
+	/// Components stored by serialize(). Data is used in place, the owner keeps it alive
+	static std::shared_ptr<ConnectedComponents> load(const uint8_t* data, size_t size, size_t sizeX, size_t sizeY,
+													std::shared_ptr<const void> owner);
+
+	/// Layout: uint32 count, uint32 edges count, uint32 labels[sizeY][sizeX], uint64 sizes[count], uint32 edges[edges count][2]
+	std::vector<uint8_t> serialize() const;
+
+	uint32_t label(const PointT& pnt) const
+	{
+		if (pnt.first < 0 || pnt.second < 0 ||
+			static_cast<size_t>(pnt.first) >= m_sizeX || static_cast<size_t>(pnt.second) >= m_sizeY)
+		{
+			return NO_COMPONENT;
+		}
+		return m_labels[m_sizeX * pnt.second + pnt.first];
+	}
+
+	/// Count of components
+	size_t count() const { return m_sizes.size(); }
+
+	/// Count of cells in the component
+	uint64_t size(uint32_t component) const { return m_sizes[component]; }
+
+	/** \return false if there is no way from one point to another for sure.
+		The start point could be not drivable (e.g. a rover is on a shore). It leaves it to drivable neighbors then.
+	*/
+	bool mayReach(const PointT& from, const PointT& to) const;
+
+private:
+	ConnectedComponents(size_t sizeX, size_t sizeY) : m_sizeX(sizeX), m_sizeY(sizeY), m_labels(nullptr)
+	{}
+
+	bool isReachable(uint32_t fromComponent, uint32_t toComponent) const;
+
+private:
+	const size_t m_sizeX;
+	const size_t m_sizeY;
+	const uint32_t* m_labels;// labels of cells. Points to own storage or to the owner memory
+	std::vector<uint32_t> m_ownLabels;
+	std::shared_ptr<const void> m_owner;
+	std::vector<uint64_t> m_sizes;// cells count by component
+	std::vector<std::pair<uint32_t, uint32_t>> m_edges;// edges of the condensation graph, sorted
+};
+
+template<typename SimulationT>
+std::shared_ptr<ConnectedComponents> ConnectedComponents::build(const MapExplorer& elevation, const MapExplorer& overrides)
+{
+	const TimeT unreachable = std::numeric_limits<TimeT>::quiet_NaN();
+	const SimulationT simEngine(elevation, overrides, unreachable);
+	const size_t sizeX = elevation.sizeX();
+	const size_t sizeY = elevation.sizeY();
+	const size_t cells = sizeX * sizeY;
+	// Cells and indexes of the search are size_t: maps could have more than 2^32 cells
+	const size_t NOT_VISITED = std::numeric_limits<size_t>::max();
+	constexpr int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+
+	std::shared_ptr<ConnectedComponents> result(new ConnectedComponents(sizeX, sizeY));
+	result->m_ownLabels.assign(cells, NO_COMPONENT);
+	auto& labels = result->m_ownLabels;
+
+	auto toPoint = [sizeX](size_t cell) { return std::make_pair(static_cast<int>(cell % sizeX), static_cast<int>(cell / sizeX)); };
+	// \return next neighbor cell by direction starting from 'direction' or NOT_VISITED
+	auto nextNeighbor = [&](size_t cell, int& direction) -> size_t {
+		const PointT curPoint = toPoint(cell);
+		for (; direction < 8; ++direction)
+		{
+			const PointT neighbor(curPoint.first + offsets[direction][0], curPoint.second + offsets[direction][1]);
+			if (neighbor.first < 0 || neighbor.second < 0 ||
+				static_cast<size_t>(neighbor.first) >= sizeX || static_cast<size_t>(neighbor.second) >= sizeY ||
+				!simEngine.isDrivable(neighbor))
+			{
+				continue;
+			}
+			const TimeT timeForMove = simEngine.getTimeToNeighbour(curPoint, neighbor);
+			if (timeForMove != timeForMove)
+			{
+				continue;
+			}
+			return sizeX * neighbor.second + neighbor.first;
+		}
+		return NOT_VISITED;
+	};
+
+	std::vector<size_t> index(cells, NOT_VISITED);
+	std::vector<size_t> lowlink(cells, 0);
+	std::vector<bool> onStack(cells, false);
+	std::vector<size_t> stack;
+	std::vector<std::pair<size_t, int>> calls;// cell and the next direction to check
+	size_t counter = 0;
+	for (size_t root = 0; root < cells; ++root)
+	{
+		if (index[root] != NOT_VISITED || !simEngine.isDrivable(toPoint(root)))
+		{
+			continue;
+		}
+		calls.push_back(std::make_pair(root, 0));
+		index[root] = lowlink[root] = counter++;
+		stack.push_back(root);
+		onStack[root] = true;
+		while (!calls.empty())
+		{
+			auto& call = calls.back();
+			const size_t cell = call.first;
+			const size_t neighbor = nextNeighbor(cell, call.second);
+			if (neighbor != NOT_VISITED)
+			{
+				call.second += 1;
+				if (index[neighbor] == NOT_VISITED)
+				{
+					index[neighbor] = lowlink[neighbor] = counter++;
+					stack.push_back(neighbor);
+					onStack[neighbor] = true;
+					calls.push_back(std::make_pair(neighbor, 0));
+				}
+				else if (onStack[neighbor])
+				{
+					lowlink[cell] = std::min(lowlink[cell], index[neighbor]);
+				}
+				continue;
+			}
+			// All neighbors are processed
+			if (lowlink[cell] == index[cell])
+			{
+				const uint32_t component = static_cast<uint32_t>(result->m_sizes.size());
+				uint64_t componentSize = 0;
+				size_t member = NOT_VISITED;
+				do
+				{
+					member = stack.back();
+					stack.pop_back();
+					onStack[member] = false;
+					labels[member] = component;
+					componentSize += 1;
+				} while (member != cell);
+				result->m_sizes.push_back(componentSize);
+			}
+			calls.pop_back();
+			if (!calls.empty())
+			{
+				const size_t parent = calls.back().first;
+				lowlink[parent] = std::min(lowlink[parent], lowlink[cell]);
+			}
+		}
+	}
+
+	// Edges of the condensation graph
+	for (size_t cell = 0; cell < cells; ++cell)
+	{
+		if (labels[cell] == NO_COMPONENT)
+		{
+			continue;
+		}
+		int direction = 0;
+		for (size_t neighbor = nextNeighbor(cell, direction); neighbor != NOT_VISITED; neighbor = nextNeighbor(cell, ++direction))
+		{
+			if (labels[neighbor] != labels[cell])
+			{
+				result->m_edges.push_back(std::make_pair(labels[cell], labels[neighbor]));
+			}
+		}
+	}
+	std::sort(result->m_edges.begin(), result->m_edges.end());
+	result->m_edges.erase(std::unique(result->m_edges.begin(), result->m_edges.end()), result->m_edges.end());
+	result->m_labels = &labels[0];
+	return result;
+}
+
+#endif // __COMPONENTS_H__
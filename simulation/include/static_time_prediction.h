@@ -0,0 +1,182 @@
+#ifndef __STATIC_TIME_PREDICTION_H__
+#define __STATIC_TIME_PREDICTION_H__
+
+#include "time_prediction.h"
+#include <static_maps.h>
+
+#include <array>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+
+/*! Compile-time variant of EvaluationStategy (see time_prediction.h).
+Sizes of the map, the cost table and forbidden ground types are template parameters.
+The cost table is generated by constexpr functions. So getTimeToNeighbour is a couple of loads from memory.
+*/
+
+namespace costs
+{
+/// sqrt by Newton's iterations. std::sqrt is not constexpr
+constexpr double constSqrt(double value)
+{
+	double current = (value > 1.0) ? value : 1.0;
+	double previous = 0.0;
+	for (int iteration = 0; iteration < 128 && current != previous; ++iteration)
+	{
+		previous = current;
+		current = 0.5 * (current + value / current);
+	}
+	return current;
+}
+
+/** The same formula as EvaluationStategy uses
+	t = delta(l) / (cos(alpha) * (1 - sin(alpha))), alpha = arctangent(delta(h) / 1.0)
+But it is written without trigonometry to be constexpr. If x = tan(alpha) and s = sqrt(1 + x*x) then
+	cos(alpha) = 1 / s, sin(alpha) = x / s  =>  t = delta(l) * s * s / (s - x)
+For climbs s - x is replaced with 1 / (s + x) to avoid cancellation.
+Values are equal to the runtime ones up to rounding of trigonometric functions.
+*/
+struct SlopeByAtan
+{
+	static constexpr TimeT time(int deltaH, TimeT distance)
+	{
+		const double x = static_cast<double>(deltaH);
+		const double s2 = 1.0 + x * x;
+		const double s = constSqrt(s2);
+		return (x >= 0) ? distance * s2 * (s + x) : distance * s2 / (s - x);
+	}
+};
+
+constexpr int MAX_DELTA = 255;
+constexpr size_t TABLE_SIZE = (2 * MAX_DELTA + 1) * 2;
+using TableT = std::array<TimeT, TABLE_SIZE>;
+
+/// Table of move times [(deltaH + 255) * 2 + isDiagonal] by SlopeT formula
+template<typename SlopeT>
+constexpr TableT generateTable()
+{
+	TableT table{};
+	for (int deltaH = -MAX_DELTA; deltaH <= MAX_DELTA; ++deltaH)
+	{
+		table[(deltaH + MAX_DELTA) * 2] = SlopeT::time(deltaH, 1.0);
+		table[(deltaH + MAX_DELTA) * 2 + 1] = SlopeT::time(deltaH, constSqrt(2.0));
+	}
+	return table;
+}
+
+/// The minimum of time per unit of distance. It makes the estimation of time to arrive admissible
+template<typename SlopeT>
+constexpr TimeT lowestTimeCorrection()
+{
+	TimeT lowest = std::numeric_limits<TimeT>::max();
+	for (int deltaH = -MAX_DELTA; deltaH <= MAX_DELTA; ++deltaH)
+	{
+		const TimeT straight = SlopeT::time(deltaH, 1.0);
+		const TimeT diagonal = SlopeT::time(deltaH, constSqrt(2.0)) / constSqrt(2.0);
+		lowest = (straight < lowest) ? straight : lowest;
+		lowest = (diagonal < lowest) ? diagonal : lowest;
+	}
+	return lowest;
+}
+
+/// Cost table generated at compile time
+template<typename SlopeT>
+struct CostTable
+{
+	static constexpr int MAX_DELTA = costs::MAX_DELTA;
+	static constexpr TableT times = generateTable<SlopeT>();
+	static constexpr TimeT LOWEST_TIME_CORRECTION = costs::lowestTimeCorrection<SlopeT>();
+};
+
+template<typename SlopeT>
+constexpr TableT CostTable<SlopeT>::times;
+}
+
+template<size_t SizeX, size_t SizeY,
+	typename CostTableT = costs::CostTable<costs::SlopeByAtan>,
+	uint8_t ForbiddenFlags = (OF_WATER_BASIN | OF_RIVER_MARSH)>
+struct StaticEvaluationStategy
+{
+	using MapT = StaticBaseMap<SizeX, SizeY>;
+
+	StaticEvaluationStategy(const MapExplorer& elevation, const MapExplorer& overrides, TimeT unreachableValue) :
+		m_elevation(elevation.rawData()),
+		m_overrides(overrides.rawData()),
+		m_unreachable(unreachableValue)
+	{
+		if (elevation.sizeX() != SizeX || elevation.sizeY() != SizeY ||
+			overrides.sizeX() != SizeX || overrides.sizeY() != SizeY)
+		{
+			throw std::invalid_argument("Map sizes differ from compile-time sizes");
+		}
+	}
+
+	/// See EvaluationStategy::isDrivable
+	bool isDrivable(const PointT& node) const
+	{
+		if (MapT::isOutOfRange(node))
+			return false;
+		const size_t id = MapT::index(node);
+		return !(m_overrides[id] & ForbiddenFlags) && (m_elevation[id] > 0);
+	}
+
+	/// See EvaluationStategy::getTimeToNeighbour
+	TimeT getTimeToNeighbour(const PointT& from, const PointT& to) const
+	{
+		if (!isDrivable(to))
+		{
+			return unreachable();
+		}
+		const int dX = to.first - from.first;
+		const int dY = to.second - from.second;
+		if (dX == 0 && dY == 0)
+		{
+			return 0.0;
+		}
+		if (dX < -1 || dX > 1 || dY < -1 || dY > 1)
+		{
+			throw std::out_of_range("requested for measure node is not a neighbor");
+		}
+		const int deltaH = static_cast<int>(m_elevation[MapT::index(to)]) - static_cast<int>(m_elevation[MapT::index(from)]);
+		const size_t isDiagonal = (dX != 0 && dY != 0) ? 1 : 0;
+		return CostTableT::times[(deltaH + CostTableT::MAX_DELTA) * 2 + isDiagonal];
+	}
+
+	static double getNeighboursDistance(const PointT& from, const PointT& to)
+	{
+		return EvaluationStategy::getNeighboursDistance(from, to);
+	}
+
+	/// Returns predefined value of unreachable item
+	TimeT unreachable() const { return m_unreachable; }
+
+	/// Costs are known at compile time (CostTableT). There is no other vehicle than the default one (nullptr)
+	void setVehicle(const std::shared_ptr<const VehicleCosts>& vehicle)
+	{
+		if (vehicle)
+		{
+			throw std::invalid_argument("Vehicle of StaticEvaluationStategy is a template parameter");
+		}
+	}
+
+	/// See EvaluationStategy::getMinTimeToArrive. The correction is taken from the cost table.
+	TimeT getMinTimeToArrive(const PointT& from, const PointT& to) const
+	{
+		constexpr TimeT correction = CostTableT::LOWEST_TIME_CORRECTION;
+		constexpr TimeT diagonalTime = costs::constSqrt(2.0);
+		const int dX = abs(from.first - to.first);
+		const int dY = abs(from.second - to.second);
+		const int diagonal = (dX < dY) ? dX : dY;
+		const int straight = abs(dX - dY);
+		return (1.0 * straight + diagonalTime * diagonal) * correction;
+	}
+
+private:
+	const uint8_t* m_elevation;///< info about elevations on map
+	const uint8_t* m_overrides;///< info about ground type
+	TimeT m_unreachable; ///< const with value of unreachable destination time
+};
+
+#endif // __STATIC_TIME_PREDICTION_H__
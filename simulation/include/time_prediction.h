@@ -3,11 +3,13 @@
 
 #define _USE_MATH_DEFINES
 #include <maps.h>
+#include "vehicle_profile.h"
 
 #include <math.h>
 #include <vector>
 #include <utility>
 #include <map>
+#include <memory>
 #include <stdint.h>
 // Bits used in the overrides image bytes
 enum OverrideFlags
@@ -28,17 +30,28 @@ delta(time_by_plain) = 1 if move straight or sqrt(2)  if move diagonally. delta(
 See the chart of formula in the file -simulation/time_graph_by_delta_alpha_in_pi.png�.
 
 You can find details of the solution in appropriate methods.
+Parameters of the formula and drivable ground types are given by the vehicle (see VehicleProfile).
+Tables of vehicles are shared, the strategy keeps a pointer to them. So the vehicle is changed without copy of maps.
 */
 struct EvaluationStategy
 {
+	/// \param vehicle nullptr is VehicleCosts::standard()
 	EvaluationStategy(const MapExplorer& elevation,
-		const MapExplorer& overrides, TimeT unreachableValue) :
+		const MapExplorer& overrides, TimeT unreachableValue, std::shared_ptr<const VehicleCosts> vehicle = nullptr) :
 		m_elevation(elevation),
 		m_overrides(overrides),
-		m_unreachable(unreachableValue),
-		m_maxHightDiff(0),
-		m_maxAngle(0.0)
-	{}
+		m_unreachable(unreachableValue)
+	{
+		setVehicle(std::move(vehicle));
+	}
+
+	/// Costs of moves are taken from the vehicle. nullptr is VehicleCosts::standard()
+	void setVehicle(std::shared_ptr<const VehicleCosts> vehicle)
+	{
+		m_vehicle = vehicle ? std::move(vehicle) : VehicleCosts::standard();
+	}
+
+	const VehicleCosts& vehicle() const { return *m_vehicle; }
 
 	/*!
 		Returns possibility to get from one point to another and time for movement.
@@ -91,38 +104,16 @@ struct EvaluationStategy
 
 	/// It calculates time estimation of the most positive scenario to come from one point to another
 	TimeT getMinTimeToArrive(const PointT& from, const PointT& to);
-private:
-
 
-	/** Alpha is an angle of road line, that could be calculated as alpha = arctangent(delta(h) / delta(l)).
-		There is no exact data about delta(h) and delta(l). We just know that delta(l) is a some 1 
-			unit value and h is measured in some another units.
-		That's why I will suggest to calculate  alpha as
-		delta(l) = delta(h). 
-		I made experiments (see aidTask_pic_results.7z, DeltaTimeByDeltaHigh.xlsx). 
-		I like the result formula and penalty for big angles on this map.
-		
-		But, it also not a bad with delta(l) = delta(h). 
-		It something as speed 40 km/h and 8 units for island second. 
-		
-		Route in this case is trivial - see images (aidTask_pic_results.7z in root directory)
-		There is excel file DeltaTimeByDeltaHigh.xlsx with tables by formula Time(dH).
-		Look at aidTask_pic_results.7z archive to see routes for different simulation angle calculations.
-	*/
-	double getAlpha(int16_t dElevation) const;
-
-	// Get Angles array  Ar[dh] = angles
-	std::vector<double> getAnglesArray() const;
-
-	static double calculateAlpha(size_t id);
+	/// Precalculated move times of the vehicle. See VehicleCosts::times for the layout
+	const std::vector<TimeT>& timesTable() const { return m_vehicle->times(); }
 
 private:
 	const MapExplorer& m_elevation;///< info about elevations on map
 	const MapExplorer& m_overrides;///< info about ground type
 	TimeT m_unreachable; ///< const with value of unreachable destination time
-	mutable int8_t m_maxHightDiff; ///< statistic metric for investigation
-	mutable double m_maxAngle; ///< statistic metric for investigation
-	
+	std::shared_ptr<const VehicleCosts> m_vehicle; ///< precalculated times of move between neighbors and drivable ground
+
 };
 
 #endif // __TIME_PREDICTION_H__
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef __VEHICLE_PROFILE_H__
+#define __VEHICLE_PROFILE_H__
+
+#include <maps.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*! Rules of a vehicle: ground types it can't drive, its speed and how slopes slow it down.
+Time of a move is the formula of EvaluationStategy (see time_prediction.h) with parameters of the vehicle
+	t = delta(l) / speed / (cos(alpha) * (1 - sin(alpha))), alpha = arctangent(slopeScale * delta(h))
+Moves steeper than the limits are forbidden. rover() is the vehicle the formula was made for.
+*/
+struct VehicleProfile
+{
+	/// The rover
+	VehicleProfile();
+
+	std::string name;
+	uint8_t forbiddenFlags;// OverrideFlags of ground that is not drivable
+	double speed;// cells per island second on a plain
+	double slopeScale;// a bigger one makes slopes steeper for the vehicle (e.g. a loaded truck)
+	int maxClimb;// the steepest move up by elevation units. Moves up more are forbidden
+	int maxDescent;// the same for moves down
+
+	/// The default vehicle of EvaluationStategy
+	static VehicleProfile rover();
+
+	/// Heavy and fast on plains. It can't take steep slopes
+	static VehicleProfile truck();
+
+	/// Light and slow. It crosses river marshes and takes steep climbs slowly
+	static VehicleProfile bike();
+};
+
+/*! Tables of a vehicle that are used by the search: times of moves by elevation difference, drivability by overrides
+and the correction of the estimation of time to arrive. They are compiled once and shared by strategies of all threads
+and queries. Maps are the same for all vehicles, so a query selects the vehicle without loading or copying maps.
+*/
+struct VehicleCosts
+{
+	static const int MAX_DELTA = 255;
+
+	static std::shared_ptr<const VehicleCosts> compile(const VehicleProfile& profile);
+
+	/// Costs of VehicleProfile::rover(). They are compiled on the first call
+	static const std::shared_ptr<const VehicleCosts>& standard();
+
+	/// Time of the move or NaN if it is forbidden
+	TimeT time(int deltaH, size_t isDiagonal) const { return m_times[(deltaH + MAX_DELTA) * 2 + isDiagonal]; }
+
+	/// Drivability of a cell by its overrides. Cells with zero elevation are not drivable for any vehicle
+	bool isDrivable(uint8_t overrides) const { return m_drivable[overrides] != 0; }
+
+	/// The minimum of time per unit of distance. It makes the estimation of time to arrive admissible
+	TimeT lowestTimeCorrection() const { return m_lowestTimeCorrection; }
+
+	/// Table of move times. Index is (deltaH + 255) * 2 + (isDiagonal ? 1 : 0)
+	const std::vector<TimeT>& times() const { return m_times; }
+
+	const VehicleProfile& profile() const { return m_profile; }
+
+	/** Every move of this vehicle is allowed for the other one (times could differ).
+		Then a cell that is unreachable for the other vehicle is unreachable for this one (see ConnectedComponents)
+	*/
+	bool isRestrictionOf(const VehicleCosts& other) const;
+
+private:
+	explicit VehicleCosts(const VehicleProfile& profile) : m_profile(profile), m_lowestTimeCorrection(1.0)
+	{}
+
+private:
+	const VehicleProfile m_profile;
+	std::vector<TimeT> m_times;
+	std::vector<uint8_t> m_drivable;// by value of overrides
+	TimeT m_lowestTimeCorrection;
+};
+
+#endif // __VEHICLE_PROFILE_H__
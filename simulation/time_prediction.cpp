@@ -1,6 +1,7 @@
 #include "time_prediction.h"
 #include <cmath>
 #include <algorithm>
+#include <stdexcept>
 
 
 bool EvaluationStategy::isDrivable(const PointT& node) const
@@ -8,8 +9,7 @@ bool EvaluationStategy::isDrivable(const PointT& node) const
 	if (m_overrides.isOutOfRange(node))
 		return false;
 
-	auto flags = m_overrides.get(node);
-	bool isNotDrivable = (m_overrides.get(node) & (OF_WATER_BASIN | OF_RIVER_MARSH));
+	bool isNotDrivable = !m_vehicle->isDrivable(m_overrides.get(node));
 	// There is no information in the rules that zero evaluation of lend is forbidden to drive there. 
 	// There is separated flags for this case in m_overrides for this information.
 	// But check if elevation is 0 and ground is marked as drivable - set it as indrivable to reduce risks of route
@@ -29,26 +29,15 @@ TimeT EvaluationStategy::getTimeToNeighbour(const PointT& from, const PointT& to
 	}
 
 	const double distance = getNeighboursDistance(from, to);
-	const int16_t deltaH = m_elevation.get(to) - m_elevation.get(from);
-	auto key = std::make_pair(deltaH, distance);
-	// it could be optimized by use of unordered_map. But we also need to add some hash function.
-	static std::map<std::pair<int16_t, double>, TimeT> timesCache; // thread unsafe trick
-	auto it = timesCache.find(key);
-	if (it != timesCache.end())
+	if (distance == 0.0)
 	{
-		return it->second;
+		return 0.0;
 	}
-	const double alpha = getAlpha(deltaH);
-	const auto tm = distance / cos(alpha) / (1 - sin(alpha));
-	timesCache[key] = tm;
-	return tm;
-}
-
-double lowestTimeCorrection()
-{
-	// It is the minimum of getTimeToNeighbour .
-	// I hardcode it by time optimization reasons.
-	return 0.75;
+	const int16_t deltaH = m_elevation.get(to) - m_elevation.get(from);
+	const size_t isDiagonal = (distance > 1.0) ? 1 : 0;
+	// The slope could be too steep for the vehicle
+	const TimeT time = m_vehicle->time(deltaH, isDiagonal);
+	return (time == time) ? time : unreachable();
 }
 
 double EvaluationStategy::getNeighboursDistance(const PointT& from, const PointT& to)
@@ -72,47 +61,6 @@ double EvaluationStategy::getNeighboursDistance(const PointT& from, const PointT
 	return 1.0;
 }
 
-namespace 
-{
-template <typename T> int sign(T val) 
-{
-	return (T(0) < val) - (val < T(0));
-}
-}
-
-double EvaluationStategy::getAlpha(int16_t dElevation) const
-{
-	static const std::vector<double> anglesArray = EvaluationStategy::getAnglesArray(); //thread unsafe
-	const int sgn = sign(dElevation);
-	const uint8_t index = static_cast<uint8_t>(abs(dElevation));
-	if (index > m_maxHightDiff) 
-	{
-		m_maxHightDiff = index;
-		m_maxAngle = anglesArray[index]/ M_PI*180.0;
-	}
-	return sgn * anglesArray[index];
-}
-
-std::vector<double> EvaluationStategy::getAnglesArray() const
- {
-	constexpr size_t Values = 256;
-	std::vector<double> angles(Values, 0);
-	for (size_t id = 0; id < Values; ++id)
-	{
-		angles[id] = EvaluationStategy::calculateAlpha(id);
-	}
-	return angles;
-}
-
-double EvaluationStategy::calculateAlpha(size_t id)
-{
-	// See aidTask_pic_results.7z archive to see different routes for different simulation angle calculation
-
-	// See declaration of getAlpha functions for details
-	return atan(static_cast<double>(id) / 1.0);
-
-}
-
 TimeT EvaluationStategy::getMinTimeToArrive(const PointT& from, const PointT& to)
 {
 	auto dX = abs(from.first - to.first);
@@ -120,5 +68,5 @@ TimeT EvaluationStategy::getMinTimeToArrive(const PointT& from, const PointT& to
 	auto diagonal = std::min(dX, dY);
 	auto straight = abs(dX - dY);
 	auto planeTime = 1.0*straight + sqrt(2.0)*diagonal;
-	return planeTime * lowestTimeCorrection();
+	return planeTime * m_vehicle->lowestTimeCorrection();
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "vehicle_profile.h"
+#include "time_prediction.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+VehicleProfile::VehicleProfile() :
+	name("rover"),
+	forbiddenFlags(OF_WATER_BASIN | OF_RIVER_MARSH),
+	speed(1.0),
+	slopeScale(1.0),
+	maxClimb(VehicleCosts::MAX_DELTA),
+	maxDescent(VehicleCosts::MAX_DELTA)
+{}
+
+VehicleProfile VehicleProfile::rover()
+{
+	return VehicleProfile();
+}
+
+VehicleProfile VehicleProfile::truck()
+{
+	VehicleProfile result;
+	result.name = "truck";
+	result.speed = 1.5;
+	result.slopeScale = 2.0;
+	result.maxClimb = 2;
+	result.maxDescent = 3;
+	return result;
+}
+
+VehicleProfile VehicleProfile::bike()
+{
+	VehicleProfile result;
+	result.name = "bike";
+	result.forbiddenFlags = OF_WATER_BASIN;
+	result.speed = 0.5;
+	result.slopeScale = 1.5;
+	result.maxClimb = 4;
+	return result;
+}
+
+std::shared_ptr<const VehicleCosts> VehicleCosts::compile(const VehicleProfile& profile)
+{
+	if (!(profile.speed > 0) || !(profile.slopeScale >= 0) || profile.maxClimb < 0 || profile.maxDescent < 0)
+	{
+		throw std::invalid_argument("Speed of the vehicle should be > 0, slope scale and limits should be >= 0");
+	}
+	std::shared_ptr<VehicleCosts> result(new VehicleCosts(profile));
+	const TimeT forbidden = std::numeric_limits<TimeT>::quiet_NaN();
+	TimeT lowest = std::numeric_limits<TimeT>::infinity();
+	result->m_times.assign((2 * MAX_DELTA + 1) * 2, forbidden);
+	for (int deltaH = -MAX_DELTA; deltaH <= MAX_DELTA; ++deltaH)
+	{
+		if (deltaH > profile.maxClimb || -deltaH > profile.maxDescent)
+		{
+			continue;
+		}
+		/* See EvaluationStategy::getTimeToNeighbour for the formula.
+			Alpha is an angle of road line, that could be calculated as alpha = arctangent(delta(h) / delta(l)).
+			There is no exact data about delta(h) and delta(l). We just know that delta(l) is a some 1
+			unit value and h is measured in some another units. That's why delta(l) = delta(h) for the rover.
+			I made experiments (see aidTask_pic_results.7z, DeltaTimeByDeltaHigh.xlsx).
+			I like the result formula and penalty for big angles on this map.
+			Other vehicles scale delta(h) by slopeScale.
+		*/
+		const double alpha = (deltaH < 0 ? -1 : 1) * atan(profile.slopeScale * abs(deltaH));
+		for (size_t isDiagonal = 0; isDiagonal < 2; ++isDiagonal)
+		{
+			const double distance = isDiagonal ? sqrt(2.0) : 1.0;
+			const TimeT time = distance / profile.speed / cos(alpha) / (1 - sin(alpha));
+			result->m_times[(deltaH + MAX_DELTA) * 2 + isDiagonal] = time;
+			lowest = std::min(lowest, time / distance);
+		}
+	}
+	// There are no moves at all. Any estimation is admissible then
+	result->m_lowestTimeCorrection = (lowest < std::numeric_limits<TimeT>::infinity()) ? lowest : 1.0;
+
+	result->m_drivable.assign(256, 0);
+	for (size_t overrides = 0; overrides < result->m_drivable.size(); ++overrides)
+	{
+		result->m_drivable[overrides] = (overrides & profile.forbiddenFlags) ? 0 : 1;
+	}
+	return result;
+}
+
+const std::shared_ptr<const VehicleCosts>& VehicleCosts::standard()
+{
+	static const std::shared_ptr<const VehicleCosts> costs = compile(VehicleProfile::rover());
+	return costs;
+}
+
+bool VehicleCosts::isRestrictionOf(const VehicleCosts& other) const
+{
+	for (size_t id = 0; id < m_times.size(); ++id)
+	{
+		if (m_times[id] == m_times[id] && other.m_times[id] != other.m_times[id])
+		{
+			return false;
+		}
+	}
+	for (size_t overrides = 0; overrides < m_drivable.size(); ++overrides)
+	{
+		if (m_drivable[overrides] && !other.m_drivable[overrides])
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,48 @@
+#include "model.h"
+#include "first_moves.h"
+
+#include <time_prediction.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*! Offline tool for first moves (see first_moves.h). There is one Dijkstra over the whole map per destination.
+Routes of RouteBuilder to these destinations are walks by the tables.
+Usage: first_moves <file> [--threads N] x y [x y ...]
+	Threads are all cores by default.
+*/
+int main(int argc, char** argv)
+{
+	const int threadsArgs = (argc > 3 && std::string(argv[2]) == "--threads") ? 2 : 0;
+	const int pointsArgs = argc - 2 - threadsArgs;
+	if (pointsArgs < 2 || pointsArgs % 2 != 0)
+	{
+		std::cout << "Usage: first_moves <file> [--threads N] x y [x y ...]" << std::endl;
+		return -1;
+	}
+	try
+	{
+		MapsModel model(argv[0]);
+		const size_t threads = threadsArgs ? std::stoul(argv[3]) : 0;
+		std::vector<PointT> destinations;
+		for (int arg = 2 + threadsArgs; arg < argc; arg += 2)
+		{
+			destinations.push_back(PointT(std::stoi(argv[arg]), std::stoi(argv[arg + 1])));
+		}
+		const auto begin = std::chrono::steady_clock::now();
+		auto elapsed = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(); };
+		const auto moves = FirstMoves::build<EvaluationStategy>(model, destinations, threads, [&](size_t done) {
+			std::cout << done << " / " << destinations.size() << " destinations, " << elapsed() << " s" << std::endl;
+		});
+		moves->save(argv[1]);
+		std::cout << "First moves of " << moves->count() << " destinations: " << elapsed() << " s, " << moves->runs() << " runs, "
+			<< moves->bytes() << " bytes" << std::endl;
+		return 0;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+}
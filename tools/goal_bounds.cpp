@@ -0,0 +1,58 @@
+#include "model.h"
+#include "goal_bounds.h"
+
+#include <time_prediction.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/*! Offline tool for goal bounds (see goal_bounds.h). There is one Dijkstra over the whole map per source cell,
+so sources are a rectangle of the map. Routes of RouteBuilder are pruned inside it.
+Usage: goal_bounds <file> [left top width height] [threads]
+	The whole map is the default area. Threads are all cores by default.
+*/
+int main(int argc, char** argv)
+{
+	if (argc != 2 && argc != 6 && argc != 7)
+	{
+		std::cout << "Usage: goal_bounds <file> [left top width height] [threads]" << std::endl;
+		return -1;
+	}
+	try
+	{
+		MapsModel model(argv[0]);
+		size_t left = 0;
+		size_t top = 0;
+		size_t width = model.getSizeX();
+		size_t height = model.getSizeY();
+		size_t threads = 0;
+		if (argc >= 6)
+		{
+			left = std::stoul(argv[2]);
+			top = std::stoul(argv[3]);
+			width = std::stoul(argv[4]);
+			height = std::stoul(argv[5]);
+		}
+		if (argc == 7)
+		{
+			threads = std::stoul(argv[6]);
+		}
+		const size_t count = width * height;
+		const auto begin = std::chrono::steady_clock::now();
+		auto elapsed = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(); };
+		const auto bounds = GoalBounds::build<EvaluationStategy>(model, left, top, width, height, threads, [&](size_t done) {
+			if (done % 256 == 0 || done == count)
+			{
+				std::cout << done << " / " << count << " sources, " << elapsed() << " s" << std::endl;
+			}
+		});
+		bounds->save(argv[1]);
+		std::cout << "Goal bounds of " << count << " sources: " << elapsed() << " s, " << bounds->bytes() << " bytes" << std::endl;
+		return 0;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+}
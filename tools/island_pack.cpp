@@ -0,0 +1,143 @@
+#include "model.h"
+
+#include <island_pack.h>
+#include <time_prediction.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string.h>
+#include <vector>
+
+/*! Offline tool for island packs (see island_pack.h).
+Usage:
+	island_pack build [pack file]       builds the pack from raw assets (default assets/island.pack)
+	island_pack validate [pack file]    checks the pack against raw assets
+	island_pack components              reports connected components of raw assets. Small ones are often map data problems
+*/
+namespace
+{
+std::vector<TimeT> movesTimes(const MapsModel& model)
+{
+	EvaluationStategy simEngine(model.elevation(), model.overrides(), std::numeric_limits<TimeT>::quiet_NaN());
+	return simEngine.timesTable();
+}
+
+void build(const MapsModel& model, const std::string& filename)
+{
+	const size_t cells = model.getSizeX() * model.getSizeY();
+	const auto times = movesTimes(model);
+
+	IslandPackWriter writer(model.getSizeX(), model.getSizeY());
+	writer.add(PS_ELEVATION, model.elevation().rawData(), cells);
+	writer.add(PS_OVERRIDES, model.overrides().rawData(), cells);
+	writer.add(PS_MOVE_TIMES, &times[0], times.size() * sizeof(TimeT));
+	const auto components = model.components().serialize();
+	writer.add(PS_COMPONENTS, &components[0], components.size());
+	writer.write(filename);
+}
+
+bool sameSection(const IslandPack& pack, uint32_t type, const void* expected, size_t size, const char* name)
+{
+	size_t actualSize = 0;
+	const uint8_t* actual = pack.section(type, actualSize);
+	if (!actual)
+	{
+		std::cout << name << ": missed" << std::endl;
+		return false;
+	}
+	if (actualSize != size || memcmp(actual, expected, size) != 0)
+	{
+		std::cout << name << ": differs from raw assets" << std::endl;
+		return false;
+	}
+	std::cout << name << ": ok" << std::endl;
+	return true;
+}
+
+bool validate(const MapsModel& model, const std::string& filename)
+{
+	auto pack = IslandPack::open(filename);
+	std::string error;
+	if (!pack->verify(error))
+	{
+		std::cout << error << std::endl;
+		return false;
+	}
+	std::cout << "checksums: ok" << std::endl;
+	if (pack->sizeX() != model.getSizeX() || pack->sizeY() != model.getSizeY())
+	{
+		std::cout << "sizes differ from raw assets" << std::endl;
+		return false;
+	}
+	const size_t cells = model.getSizeX() * model.getSizeY();
+	const auto times = movesTimes(model);
+	bool result = sameSection(*pack, PS_ELEVATION, model.elevation().rawData(), cells, "elevation");
+	result = sameSection(*pack, PS_OVERRIDES, model.overrides().rawData(), cells, "overrides") && result;
+	result = sameSection(*pack, PS_MOVE_TIMES, &times[0], times.size() * sizeof(TimeT), "move times") && result;
+	const auto components = model.components().serialize();
+	result = sameSection(*pack, PS_COMPONENTS, &components[0], components.size(), "components") && result;
+	return result;
+}
+
+void reportComponents(const MapsModel& model)
+{
+	const auto& components = model.components();
+	std::vector<std::pair<uint64_t, uint32_t>> bySize;
+	uint64_t drivable = 0;
+	for (uint32_t component = 0; component < components.count(); ++component)
+	{
+		bySize.push_back(std::make_pair(components.size(component), component));
+		drivable += components.size(component);
+	}
+	std::sort(bySize.rbegin(), bySize.rend());
+	std::cout << "Drivable cells: " << drivable << ", components: " << components.count() << std::endl;
+	const size_t SHOWN = 10;
+	for (size_t id = 0; id < std::min(SHOWN, bySize.size()); ++id)
+	{
+		std::cout << "  component " << bySize[id].second << ": " << bySize[id].first << " cells" << std::endl;
+	}
+	const uint64_t SMALL = 16;
+	const auto small = std::count_if(bySize.begin(), bySize.end(),
+									[SMALL](const std::pair<uint64_t, uint32_t>& item) { return item.first <= SMALL; });
+	std::cout << "Components with <= " << SMALL << " cells: " << small << std::endl;
+}
+
+double elapsedMs(const std::chrono::steady_clock::time_point& from)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - from).count();
+}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || (strcmp(argv[1], "build") != 0 && strcmp(argv[1], "validate") != 0 && strcmp(argv[1], "components") != 0))
+	{
+		std::cout << "Usage: island_pack build|validate|components [pack file]" << std::endl;
+		return -1;
+	}
+	try
+	{
+		const std::string filename = (argc > 2) ? argv[2] : MapsModel::assetsDir(argv[0]) + "island.pack";
+		const MapsModel model(argv[0], MapsModel::AS_RAW);
+		if (strcmp(argv[1], "components") == 0)
+		{
+			reportComponents(model);
+			return 0;
+		}
+		if (strcmp(argv[1], "build") == 0)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			build(model, filename);
+			std::cout << "Island pack is built in " << elapsedMs(begin) << " ms: " << filename << std::endl;
+			return 0;
+		}
+		return validate(model, filename) ? 0 : 1;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+}
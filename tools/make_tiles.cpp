@@ -0,0 +1,45 @@
+#include <tiled_map.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*! Converts a raw map (sizeX * sizeY bytes by rows, as assets/elevation.data) into a tiled map file.
+The raw map is read by bands of tile rows, so it works for maps that are larger than memory.
+Usage: make_tiles <raw file> <sizeX> <sizeY> <tiled file> [tile size]
+*/
+int main(int argc, char** argv)
+{
+	if (argc < 5)
+	{
+		std::cout << "Usage: make_tiles <raw file> <sizeX> <sizeY> <tiled file> [tile size]" << std::endl;
+		return -1;
+	}
+	try
+	{
+		const size_t sizeX = std::stoul(argv[2]);
+		const size_t sizeY = std::stoul(argv[3]);
+		const size_t tileDim = (argc > 5) ? std::stoul(argv[5]) : 256;
+
+		std::ifstream in(argv[1], std::ifstream::binary);
+		TiledMapWriter writer(argv[4], sizeX, sizeY, tileDim);
+		std::vector<uint8_t> band(sizeX * tileDim);
+		while (!writer.isComplete())
+		{
+			const size_t rows = writer.bandRows();
+			in.read((char*)&band[0], rows * sizeX);
+			if (!in.good())
+			{
+				throw std::runtime_error("Can't read raw map file");
+			}
+			writer.writeBand(&band[0], rows);
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,227 @@
+#include "maps_viewer.h"
+#include "model.h"
+#include "router.h"
+
+#include <perf_counters.h>
+#include <prioritized_queue.h>
+#include <time_prediction.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string.h>
+#include <vector>
+
+/*! Benchmark of queries between random drivable cells of the island. A query is the search, the path extraction
+and a cropped preview of the route. Latencies and hardware counters of phases are reported (see perf_counters.h):
+IPC and misses per 1000 instructions tell if a phase waits for memory or for branches.
+Counters are skipped with the reason if they are not available (containers, VMs).
+Queries are the same for the same seed, so builds are compared by runs with the same arguments.
+Maps are taken from tiled map files with --tiles (see make_tiles). Searches of them keep times in tiles
+allocated on the first write (SearchOptions::SS_TILED), memory of the state is reported.
+Usage: route_bench [queries] [seed] [--quiet] [--tiles <elevation tiles> <overrides tiles>]
+*/
+namespace
+{
+using RouterT = RouteBuilder<EvaluationStategy, ArenaPrioritizedQueue<TimeT, MeasuredPointT>>;
+
+const char* PHASES[] = { "search", "path", "render" };
+const size_t PHASES_COUNT = 3;
+
+double elapsedUs(const std::chrono::steady_clock::time_point& from)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - from).count();
+}
+
+double percentile(std::vector<double> values, double share)
+{
+	if (values.empty())
+	{
+		return 0.0;
+	}
+	const size_t id = std::min(values.size() - 1, static_cast<size_t>(share * values.size()));
+	std::nth_element(values.begin(), values.begin() + id, values.end());
+	return values[id];
+}
+
+/// Pairs of drivable cells of one island fragment
+std::vector<std::pair<PointT, PointT>> makeQueries(const MapsModel& model, size_t count, uint32_t seed)
+{
+	const EvaluationStategy simEngine(model.elevation(), model.overrides(), RouterT::UNREACHABLE);
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<int> randomX(0, static_cast<int>(model.getSizeX()) - 1);
+	std::uniform_int_distribution<int> randomY(0, static_cast<int>(model.getSizeY()) - 1);
+	auto drivable = [&]() {
+		PointT pnt(randomX(random), randomY(random));
+		while (!simEngine.isDrivable(pnt))
+		{
+			pnt = PointT(randomX(random), randomY(random));
+		}
+		return pnt;
+	};
+	std::vector<std::pair<PointT, PointT>> result;
+	while (result.size() < count)
+	{
+		const PointT startPnt = drivable();
+		const PointT finishPnt = drivable();
+		if (!model.hasComponents() || model.components().mayReach(startPnt, finishPnt))
+		{
+			result.push_back(std::make_pair(startPnt, finishPnt));
+		}
+	}
+	return result;
+}
+
+void printCounts(const char* phase, const PerfCounts& counts, size_t expansions)
+{
+	std::cout << std::setw(8) << phase;
+	for (int event = 0; event < PE_COUNT; ++event)
+	{
+		std::cout << std::setw(15);
+		if (counts.has(static_cast<PerfEvent>(event)))
+		{
+			std::cout << counts.values[event];
+		}
+		else
+		{
+			std::cout << "-";
+		}
+	}
+	std::cout << std::fixed << std::setprecision(2);
+	if (counts.has(PE_CYCLES) && counts.has(PE_INSTRUCTIONS) && counts[PE_CYCLES])
+	{
+		std::cout << "  IPC " << static_cast<double>(counts[PE_INSTRUCTIONS]) / counts[PE_CYCLES];
+	}
+	if (counts.has(PE_INSTRUCTIONS) && counts[PE_INSTRUCTIONS])
+	{
+		// Misses per 1000 instructions
+		const double kiloInstructions = counts[PE_INSTRUCTIONS] / 1000.0;
+		const PerfEvent misses[] = { PE_L1D_MISSES, PE_LLC_MISSES, PE_DTLB_MISSES, PE_BRANCH_MISSES };
+		for (auto event : misses)
+		{
+			if (counts.has(event))
+			{
+				std::cout << "  " << PerfCounts::name(event) << "/Kinstr " << counts[event] / kiloInstructions;
+			}
+		}
+	}
+	if (expansions && counts.has(PE_CYCLES))
+	{
+		std::cout << "  cycles/expansion " << static_cast<double>(counts[PE_CYCLES]) / expansions;
+	}
+	std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		bool quiet = false;
+		std::vector<std::string> tiles;
+		std::vector<std::string> args;
+		for (int arg = 1; arg < argc; ++arg)
+		{
+			if (strcmp(argv[arg], "--quiet") == 0)
+			{
+				quiet = true;
+			}
+			else if (strcmp(argv[arg], "--tiles") == 0 && arg + 2 < argc)
+			{
+				tiles.push_back(argv[++arg]);
+				tiles.push_back(argv[++arg]);
+			}
+			else
+			{
+				args.push_back(argv[arg]);
+			}
+		}
+		const size_t count = (args.size() > 0) ? std::stoul(args[0]) : 100;
+		const uint32_t seed = (args.size() > 1) ? static_cast<uint32_t>(std::stoul(args[1])) : 1;
+		std::unique_ptr<MapsModel> models(tiles.empty() ? new MapsModel(argv[0]) : new MapsModel(tiles[0], tiles[1]));
+		MapsModel& model = *models;
+		if (model.hasComponents())
+		{
+			model.components();
+		}
+		const auto queries = makeQueries(model, count, seed);
+
+		PerfCounters& counters = PerfCounters::thread();
+		if (!counters.error().empty())
+		{
+			std::cout << "Hardware counters are not counted: " << counters.error() << std::endl;
+		}
+		visualizer::MapsViewer viewer(model);
+		RouterT router(model, viewer, PointT(0, 0));
+		router.setPerfCounters(true);
+		visualizer::RenderOptions preview;
+		preview.crop = true;
+
+		PerfCounts totals[PHASES_COUNT];
+		std::vector<double> latencies;
+		size_t expansions = 0;
+		size_t found = 0;
+		size_t previewPixels = 0;
+		size_t stateBytes = 0;
+		const auto begin = std::chrono::steady_clock::now();
+		for (const auto& query : queries)
+		{
+			router.restart(query.first);
+			const auto queryBegin = std::chrono::steady_clock::now();
+			if (!router.moveTo(query.second))
+			{
+				continue;
+			}
+			previewPixels += router.renderRoute(preview).pixels.size();
+			latencies.push_back(elapsedUs(queryBegin));
+			const auto& result = router.lastResult();
+			const PerfCounts phases[PHASES_COUNT] = { result.searchCounts, result.pathCounts, router.lastRenderCounts() };
+			for (size_t phase = 0; phase < PHASES_COUNT; ++phase)
+			{
+				totals[phase] += phases[phase];
+			}
+			expansions += result.expansions;
+			stateBytes = std::max(stateBytes, result.stateBytes);
+			found += 1;
+			if (!quiet)
+			{
+				std::cout << "(" << query.first.first << "," << query.first.second << ")->(" << query.second.first << "," << query.second.second
+					<< ") cost " << result.time << " expansions " << result.expansions << " latency " << static_cast<uint64_t>(latencies.back()) << "us";
+				if (result.searchCounts.has(PE_CYCLES))
+				{
+					std::cout << " cycles " << result.searchCounts[PE_CYCLES] << "/" << result.pathCounts[PE_CYCLES] << "/" << router.lastRenderCounts()[PE_CYCLES];
+				}
+				std::cout << std::endl;
+			}
+		}
+		const double wallMs = elapsedUs(begin) / 1000.0;
+
+		std::cout << "Queries: " << queries.size() << ", found: " << found << ", wall time: " << wallMs << " ms"
+			<< ", expansions: " << expansions << ", preview pixels: " << previewPixels << ", max state bytes: " << stateBytes << std::endl;
+		std::cout << "Latency p50: " << static_cast<uint64_t>(percentile(latencies, 0.5)) << "us"
+			<< ", p95: " << static_cast<uint64_t>(percentile(latencies, 0.95)) << "us" << std::endl;
+		if (!counters.available())
+		{
+			return 0;
+		}
+		std::cout << std::setw(8) << "phase";
+		for (int event = 0; event < PE_COUNT; ++event)
+		{
+			std::cout << std::setw(15) << PerfCounts::name(static_cast<PerfEvent>(event));
+		}
+		std::cout << std::endl;
+		for (size_t phase = 0; phase < PHASES_COUNT; ++phase)
+		{
+			printCounts(PHASES[phase], totals[phase], phase == 0 ? expansions : 0);
+		}
+		return 0;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+}
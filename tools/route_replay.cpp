@@ -0,0 +1,378 @@
+#include "maps_viewer.h"
+#include "model.h"
+#include "router.h"
+
+#include <prioritized_queue.h>
+#include <query_log.h>
+#include <time_prediction.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/*! Re-executes a query log (see query_log.h) against the current build. It is for A/B of queues and heuristics
+on real traffic: capture a log by 'Bachelor --query-log <file>' or RouteBuilder::setQueryLog, change the code, replay.
+Costs of routes must be identical to logged ones. Corridors are built again with the logged factor and width.
+Queries with a deadline depend on the machine load: a search could be stopped in one run and not in another.
+Costs of routes found by both runs are verified anyway. They are identical unless it is anytime search,
+its routes are within the 1 + epsilon bound of each other. Latencies and expansions are compared query by query.
+Queries are replayed with the logged vehicle. Plateau masks and climb bounds are built again for the queries that used them.
+Goal bounds, swamps and first moves are precomputed tables, they are loaded from the given files. A query that used
+a table which is not given is replayed without it: routes stay optimal, so its cost is verified, but expansions differ.
+Every thread has its own RouteBuilder. Queries are taken by threads in the order of the log.
+Usage: route_replay <log> [threads] [--goal-bounds <file>] [--swamps <file>] [--first-moves <file>] [--quiet]
+*/
+namespace
+{
+using RouterT = RouteBuilder<EvaluationStategy, ArenaPrioritizedQueue<TimeT, MeasuredPointT>>;
+
+struct Replayed
+{
+	Replayed() : found(false), time(0.0), expansions(0), latencyUs(0.0)
+	{}
+
+	bool found;
+	TimeT time;
+	size_t expansions;
+	double latencyUs;
+};
+
+/// Level of MapsPyramid of the logged corridor. Factors of levels are 2, 4, 8 ...
+size_t corridorLevel(const QueryRecord& record)
+{
+	size_t level = 0;
+	while ((size_t(2) << level) < record.corridorFactor)
+	{
+		level += 1;
+	}
+	if ((size_t(2) << level) != record.corridorFactor)
+	{
+		throw std::runtime_error("Wrong factor of the corridor in the query log");
+	}
+	return level;
+}
+
+/// Tables of the replayed queries. Vehicles and climb bounds are by records
+struct ReplayTables
+{
+	std::shared_ptr<const MapsPyramid> pyramid;
+	std::shared_ptr<const PlateauMask> plateaus;
+	std::shared_ptr<const GoalBounds> goalBounds;
+	std::shared_ptr<const SwampRegions> swamps;
+	std::shared_ptr<const FirstMoves> firstMoves;
+	std::vector<std::shared_ptr<const VehicleCosts>> vehicles;
+	std::vector<std::shared_ptr<const ClimbBound>> climbBounds;
+};
+
+/// Logged tables that are not given to the replay
+bool isMissingTables(const QueryRecord& record, const ReplayTables& tables)
+{
+	return ((record.mode & QM_GOAL_BOUNDS) && !tables.goalBounds) || ((record.mode & QM_SWAMPS) && !tables.swamps) ||
+		((record.mode & QM_FIRST_MOVES) && !tables.firstMoves);
+}
+
+/// nullptr for QV_DEFAULT. The rover is the shared standard() costs, options of the default vehicle accept only them
+std::shared_ptr<const VehicleCosts> loggedVehicle(const QueryRecord& record)
+{
+	switch (record.vehicle)
+	{
+	case QV_DEFAULT:
+		return nullptr;
+	case QV_ROVER:
+		return VehicleCosts::standard();
+	case QV_TRUCK:
+		return VehicleCosts::compile(VehicleProfile::truck());
+	case QV_BIKE:
+		return VehicleCosts::compile(VehicleProfile::bike());
+	case QV_CUSTOM:
+	{
+		VehicleProfile profile;
+		profile.name = "logged";
+		profile.forbiddenFlags = record.vehicleForbidden;
+		profile.speed = record.vehicleSpeed;
+		profile.slopeScale = record.vehicleSlopeScale;
+		profile.maxClimb = record.vehicleMaxClimb;
+		profile.maxDescent = record.vehicleMaxDescent;
+		return VehicleCosts::compile(profile);
+	}
+	default:
+		throw std::runtime_error("Wrong vehicle in the query log");
+	}
+}
+
+/** Routes of both runs are found by the same search. Anytime search is stopped at different passes.
+	A search without a logged table sums times of another optimal route, it could differ by rounding
+*/
+bool isSameCost(const QueryRecord& record, const Replayed& result, bool isMissingTables)
+{
+	if (!(record.mode & QM_ANYTIME))
+	{
+		return record.time == result.time ||
+			(isMissingTables && std::abs(record.time - result.time) <= 1e-9 * std::max(record.time, result.time));
+	}
+	const TimeT bound = 1.0 + record.epsilon;
+	return std::max(record.time, result.time) <= bound * std::min(record.time, result.time);
+}
+
+SearchOptions toOptions(size_t id, const QueryRecord& record, const ReplayTables& tables)
+{
+	SearchOptions options;
+	options.epsilon = record.epsilon;
+	options.epsilonStep = record.epsilonStep;
+	options.anytime = (record.mode & QM_ANYTIME) != 0;
+	options.state = static_cast<SearchOptions::StateBackend>(record.state);
+	if (record.deadlineUs)
+	{
+		options.deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(record.deadlineUs);
+	}
+	options.vehicle = tables.vehicles[id];
+	options.climbBound = tables.climbBounds[id];
+	if (record.mode & QM_PLATEAUS)
+	{
+		options.plateaus = tables.plateaus;
+	}
+	if (record.mode & QM_GOAL_BOUNDS)
+	{
+		options.goalBounds = tables.goalBounds;
+	}
+	if (record.mode & QM_SWAMPS)
+	{
+		options.swamps = tables.swamps;
+	}
+	if (record.mode & QM_FIRST_MOVES)
+	{
+		options.firstMoves = tables.firstMoves;
+	}
+	if (record.mode & QM_CORRIDOR)
+	{
+		const PointT startPnt(record.startX, record.startY);
+		const PointT finishPnt(record.finishX, record.finishY);
+		options.corridor = tables.pyramid->corridor(startPnt, finishPnt, record.corridorWidth, corridorLevel(record));
+	}
+	return options;
+}
+
+/// \param viewer it is not used by replay, RouteBuilder takes one
+void replay(const MapsModel& model, visualizer::MapsViewer& viewer, const std::vector<QueryRecord>& records, const ReplayTables& tables,
+			std::atomic<size_t>& next, std::vector<Replayed>& results)
+{
+	RouterT router(model, viewer, PointT(0, 0));
+	for (size_t id = next++; id < records.size(); id = next++)
+	{
+		const auto& record = records[id];
+		router.restart(PointT(record.startX, record.startY));
+		// The corridor is built by the caller, it is not a part of the logged latency
+		const auto options = toOptions(id, record, tables);
+		const auto begin = std::chrono::steady_clock::now();
+		auto& result = results[id];
+		result.found = router.moveTo(PointT(record.finishX, record.finishY), options);
+		result.latencyUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+		result.time = router.lastResult().time;
+		result.expansions = router.lastResult().expansions;
+	}
+}
+
+double percentile(std::vector<double> values, double share)
+{
+	if (values.empty())
+	{
+		return 0.0;
+	}
+	const size_t id = std::min(values.size() - 1, static_cast<size_t>(share * values.size()));
+	std::nth_element(values.begin(), values.begin() + id, values.end());
+	return values[id];
+}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: route_replay <log> [threads] [--goal-bounds <file>] [--swamps <file>] [--first-moves <file>] [--quiet]" << std::endl;
+		return -1;
+	}
+	try
+	{
+		bool quiet = false;
+		size_t threads = 1;
+		std::string goalBoundsFile;
+		std::string swampsFile;
+		std::string firstMovesFile;
+		for (int arg = 2; arg < argc; ++arg)
+		{
+			const bool hasValue = arg + 1 < argc;
+			if (strcmp(argv[arg], "--quiet") == 0)
+			{
+				quiet = true;
+			}
+			else if (strcmp(argv[arg], "--goal-bounds") == 0 && hasValue)
+			{
+				goalBoundsFile = argv[++arg];
+			}
+			else if (strcmp(argv[arg], "--swamps") == 0 && hasValue)
+			{
+				swampsFile = argv[++arg];
+			}
+			else if (strcmp(argv[arg], "--first-moves") == 0 && hasValue)
+			{
+				firstMovesFile = argv[++arg];
+			}
+			else
+			{
+				threads = std::max<size_t>(1, std::stoul(argv[arg]));
+			}
+		}
+		const auto log = QueryLog::read(argv[1]);
+		MapsModel model(argv[0]);
+		if (log.header.sizeX != model.getSizeX() || log.header.sizeY != model.getSizeY() ||
+			log.header.mapChecksum != model.checksum())
+		{
+			std::cout << "The log is captured on another map" << std::endl;
+			return 1;
+		}
+		model.components();
+
+		// Levels up to the coarsest one of logged corridors
+		size_t levels = 0;
+		for (const auto& record : log.records)
+		{
+			if (record.mode & QM_CORRIDOR)
+			{
+				levels = std::max(levels, corridorLevel(record) + 1);
+			}
+		}
+		ReplayTables tables;
+		if (levels)
+		{
+			tables.pyramid = MapsPyramid::build<EvaluationStategy>(model, levels);
+		}
+		if (!goalBoundsFile.empty())
+		{
+			tables.goalBounds = GoalBounds::load(goalBoundsFile, model);
+		}
+		if (!swampsFile.empty())
+		{
+			tables.swamps = SwampRegions::load(swampsFile, model);
+		}
+		if (!firstMovesFile.empty())
+		{
+			tables.firstMoves = FirstMoves::load(firstMovesFile, model);
+		}
+		// Vehicles are compiled once by their logged parameters, climb bounds once by vehicles
+		std::vector<std::pair<const QueryRecord*, std::shared_ptr<const VehicleCosts>>> vehicles;
+		std::vector<std::pair<const VehicleCosts*, std::shared_ptr<const ClimbBound>>> climbBounds;
+		for (const auto& record : log.records)
+		{
+			auto vehicle = std::find_if(vehicles.begin(), vehicles.end(), [&record](const auto& known) {
+				return known.first->vehicle == record.vehicle && known.first->vehicleForbidden == record.vehicleForbidden &&
+					known.first->vehicleSpeed == record.vehicleSpeed && known.first->vehicleSlopeScale == record.vehicleSlopeScale &&
+					known.first->vehicleMaxClimb == record.vehicleMaxClimb && known.first->vehicleMaxDescent == record.vehicleMaxDescent;
+			});
+			if (vehicle == vehicles.end())
+			{
+				vehicle = vehicles.insert(vehicles.end(), std::make_pair(&record, loggedVehicle(record)));
+			}
+			tables.vehicles.push_back(vehicle->second);
+
+			std::shared_ptr<const ClimbBound> climbBound;
+			if (record.mode & QM_CLIMB_BOUND)
+			{
+				auto known = std::find_if(climbBounds.begin(), climbBounds.end(), [&vehicle](const auto& bound) {
+					return bound.first == vehicle->second.get();
+				});
+				if (known == climbBounds.end())
+				{
+					known = climbBounds.insert(climbBounds.end(), std::make_pair(vehicle->second.get(), ClimbBound::build(vehicle->second)));
+				}
+				climbBound = known->second;
+			}
+			tables.climbBounds.push_back(climbBound);
+
+			if ((record.mode & QM_PLATEAUS) && !tables.plateaus)
+			{
+				tables.plateaus = PlateauMask::build(model);
+			}
+		}
+
+		MapsReplicas replicas(model);
+		std::vector<Replayed> results(log.records.size());
+		std::atomic<size_t> next(0);
+		const auto begin = std::chrono::steady_clock::now();
+		std::vector<std::thread> workers;
+		for (size_t id = 0; id < threads; ++id)
+		{
+			// Every thread reads maps of its NUMA node
+			workers.push_back(std::thread([&, id]() {
+				visualizer::MapsViewer viewer(model);
+				replay(replicas.bind(id), viewer, log.records, tables, next, results);
+			}));
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		const double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+		size_t mismatches = 0;
+		size_t unverified = 0;
+		size_t withoutTables = 0;
+		long long expansionsDelta = 0;
+		std::vector<double> loggedLatencies;
+		std::vector<double> replayedLatencies;
+		for (size_t id = 0; id < log.records.size(); ++id)
+		{
+			const auto& record = log.records[id];
+			const auto& result = results[id];
+			const char* status = "ok";
+			if (record.deadlineUs && (!record.found || !result.found))
+			{
+				// One of the runs could be stopped by the deadline
+				status = "deadline";
+				unverified += 1;
+			}
+			else if ((record.found != 0) != result.found || (result.found && !isSameCost(record, result, isMissingTables(record, tables))))
+			{
+				status = "MISMATCH";
+				mismatches += 1;
+			}
+			else if (isMissingTables(record, tables))
+			{
+				// Expansions are not comparable
+				status = "ok (without tables)";
+				withoutTables += 1;
+			}
+			const long long delta = static_cast<long long>(result.expansions) - static_cast<long long>(record.expansions);
+			expansionsDelta += delta;
+			loggedLatencies.push_back(record.latencyUs);
+			replayedLatencies.push_back(result.latencyUs);
+			if (!quiet || status[0] == 'M')
+			{
+				std::cout << id << " (" << record.startX << "," << record.startY << ")->(" << record.finishX << "," << record.finishY << ") "
+					<< status << " cost " << record.time << " -> " << result.time
+					<< " expansions " << record.expansions << " " << (delta >= 0 ? "+" : "") << delta
+					<< " latency " << record.latencyUs << "us -> " << static_cast<uint64_t>(result.latencyUs) << "us" << std::endl;
+			}
+		}
+		std::cout << "Queries: " << log.records.size() << ", mismatches: " << mismatches << ", not verified (stopped by deadline): " << unverified
+			<< ", replayed without logged tables: " << withoutTables
+			<< ", threads: " << threads << ", wall time: " << wallMs << " ms" << std::endl;
+		std::cout << "Expansions delta: " << expansionsDelta << std::endl;
+		std::cout << "Latency p50: " << static_cast<uint64_t>(percentile(loggedLatencies, 0.5)) << "us -> "
+			<< static_cast<uint64_t>(percentile(replayedLatencies, 0.5)) << "us"
+			<< ", p95: " << static_cast<uint64_t>(percentile(loggedLatencies, 0.95)) << "us -> "
+			<< static_cast<uint64_t>(percentile(replayedLatencies, 0.95)) << "us" << std::endl;
+		return mismatches ? 1 : 0;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+}
@@ -0,0 +1,82 @@
+#include "model.h"
+#include "delta_stepping.h"
+
+#include <prioritized_queue.h>
+#include <time_prediction.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/*! Makes sure that parallel DeltaStepping gives the same arrival times as the sequential search.
+Times are compared bit by bit on every cell of the map.
+Usage: sssp_check [threads] [delta]
+*/
+namespace
+{
+const PointT START_POINTS[] = {
+	PointT(159, 1520), // Rover
+	PointT(1303, 85), // Bachelor
+	PointT(1577, 1294) // Wedding
+};
+
+bool isSame(TimeT val1, TimeT val2)
+{
+	// Both are NaN or both are equal
+	return ((val1 != val1) && (val2 != val2)) || (val1 == val2);
+}
+
+double elapsedMs(const std::chrono::steady_clock::time_point& from)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - from).count();
+}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		const size_t threads = (argc > 1) ? std::stoul(argv[1]) : 0;
+		const TimeT delta = (argc > 2) ? std::stod(argv[2]) : DeltaStepping<EvaluationStategy>::DEFAULT_DELTA;
+		MapsModel model(argv[0]);
+
+		DeltaStepping<EvaluationStategy> parallel(model, delta, threads);
+		RWMap sequential(model.getSizeX(), model.getSizeY(), DeltaStepping<EvaluationStategy>::UNREACHABLE,
+						std::function<bool(const TimeT&)>([](TimeT t) {return t != t; }));
+		size_t mismatches = 0;
+		for (auto& start : START_POINTS)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			sequentialArrivalTimes<EvaluationStategy, PrioritizedQueue<TimeT, MeasuredPointT>>(model, start, sequential);
+			const double sequentialMs = elapsedMs(begin);
+
+			begin = std::chrono::steady_clock::now();
+			parallel.run(start);
+			const double parallelMs = elapsedMs(begin);
+
+			size_t reached = 0;
+			size_t different = 0;
+			for (int y = 0; y < static_cast<int>(model.getSizeY()); ++y)
+			{
+				for (int x = 0; x < static_cast<int>(model.getSizeX()); ++x)
+				{
+					const auto pnt = std::make_pair(x, y);
+					const auto expected = sequential.get(pnt);
+					reached += (expected == expected) ? 1 : 0;
+					different += isSame(expected, parallel.get(pnt)) ? 0 : 1;
+				}
+			}
+			mismatches += different;
+			std::cout << "Start (" << start.first << ", " << start.second << "): reached " << reached << " cells"
+				<< ", sequential " << sequentialMs << " ms"
+				<< ", delta-stepping " << parallelMs << " ms on " << parallel.threadsCount() << " threads"
+				<< " (" << parallel.processedBuckets() << " buckets, " << parallel.relaxedItems() << " relaxations)"
+				<< ", mismatches " << different << std::endl;
+		}
+		return mismatches ? 1 : 0;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+}
@@ -0,0 +1,100 @@
+#include "maps_viewer.h"
+#include "model.h"
+#include "router.h"
+
+#include <prioritized_queue.h>
+#include <static_maps.h>
+#include <static_time_prediction.h>
+#include <time_prediction.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*! Makes sure that the compile-time path (StaticEvaluationStategy with StaticRWMap) finds routes of the same time
+as the runtime one (EvaluationStategy with RWMap). Times are equal up to rounding of trigonometric functions
+of the runtime cost model. Queries between random drivable cells are the same for the same seed.
+Usage: static_check [queries] [seed]
+*/
+namespace
+{
+using DynamicRouterT = RouteBuilder<EvaluationStategy, ArenaPrioritizedQueue<TimeT, MeasuredPointT>>;
+using StaticRouterT = RouteBuilder<StaticEvaluationStategy<MapsModel::IMAGE_DIM, MapsModel::IMAGE_DIM>,
+	ArenaPrioritizedQueue<TimeT, MeasuredPointT>, StaticRWMap<MapsModel::IMAGE_DIM, MapsModel::IMAGE_DIM>>;
+
+const TimeT TOLERANCE = 1e-9;// relative difference of times of routes
+
+double elapsedMs(const std::chrono::steady_clock::time_point& from)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - from).count();
+}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		const size_t count = (argc > 1) ? std::stoul(argv[1]) : 20;
+		const uint32_t seed = (argc > 2) ? static_cast<uint32_t>(std::stoul(argv[2])) : 1;
+		MapsModel model(argv[0]);
+		if (model.getSizeX() != MapsModel::IMAGE_DIM || model.getSizeY() != MapsModel::IMAGE_DIM)
+		{
+			throw std::runtime_error("Compile-time path is built for the island image size");
+		}
+		visualizer::MapsViewer viewer(model);
+		DynamicRouterT dynamicRouter(model, viewer, PointT(0, 0));
+		StaticRouterT staticRouter(model, viewer, PointT(0, 0));
+		// Dense state for both: the sparse one is the same for both paths
+		SearchOptions options;
+		options.state = SearchOptions::SS_DENSE;
+
+		const EvaluationStategy simEngine(model.elevation(), model.overrides(), DynamicRouterT::UNREACHABLE);
+		std::mt19937 random(seed);
+		std::uniform_int_distribution<int> randomX(0, static_cast<int>(model.getSizeX()) - 1);
+		std::uniform_int_distribution<int> randomY(0, static_cast<int>(model.getSizeY()) - 1);
+		auto drivable = [&]() {
+			PointT pnt(randomX(random), randomY(random));
+			while (!simEngine.isDrivable(pnt))
+			{
+				pnt = PointT(randomX(random), randomY(random));
+			}
+			return pnt;
+		};
+
+		size_t mismatches = 0;
+		double dynamicMs = 0.0;
+		double staticMs = 0.0;
+		for (size_t query = 0; query < count; ++query)
+		{
+			const PointT startPnt = drivable();
+			const PointT finishPnt = drivable();
+			dynamicRouter.restart(startPnt);
+			staticRouter.restart(startPnt);
+			auto begin = std::chrono::steady_clock::now();
+			const bool dynamicFound = dynamicRouter.moveTo(finishPnt, options);
+			dynamicMs += elapsedMs(begin);
+			begin = std::chrono::steady_clock::now();
+			const bool staticFound = staticRouter.moveTo(finishPnt, options);
+			staticMs += elapsedMs(begin);
+
+			const TimeT dynamicTime = dynamicRouter.lastResult().time;
+			const TimeT staticTime = staticRouter.lastResult().time;
+			const bool same = (dynamicFound == staticFound) &&
+				(!dynamicFound || std::fabs(dynamicTime - staticTime) <= TOLERANCE * dynamicTime);
+			mismatches += same ? 0 : 1;
+			std::cout << "(" << startPnt.first << "," << startPnt.second << ")->(" << finishPnt.first << "," << finishPnt.second << ") "
+				<< (dynamicFound ? std::to_string(dynamicTime) : std::string("not found")) << " / "
+				<< (staticFound ? std::to_string(staticTime) : std::string("not found")) << (same ? "" : " MISMATCH") << std::endl;
+		}
+		std::cout << "Queries: " << count << ", runtime path " << dynamicMs << " ms, compile-time path " << staticMs << " ms"
+			<< ", mismatches " << mismatches << std::endl;
+		return mismatches ? 1 : 0;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+}
@@ -0,0 +1,51 @@
+#include "model.h"
+#include "swamps.h"
+
+#include <time_prediction.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/*! Offline tool for swamps (see swamps.h): regions that optimal routes never enter.
+Usage: swamps <file> [region size]
+*/
+int main(int argc, char** argv)
+{
+	if (argc != 2 && argc != 3)
+	{
+		std::cout << "Usage: swamps <file> [region size]" << std::endl;
+		return -1;
+	}
+	try
+	{
+		MapsModel model(argv[0]);
+		const size_t regionSize = (argc == 3) ? std::stoul(argv[2]) : SwampRegions::DEFAULT_REGION_SIZE;
+		const auto begin = std::chrono::steady_clock::now();
+		auto elapsed = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(); };
+		const auto swamps = SwampRegions::build<EvaluationStategy>(model, regionSize, [&](size_t done) {
+			if (done % (1 << 20) == 0)
+			{
+				std::cout << done << " tiles are checked, " << elapsed() << " s" << std::endl;
+			}
+		});
+		swamps->save(argv[1]);
+
+		EvaluationStategy simEngine(model.elevation(), model.overrides(), std::numeric_limits<TimeT>::quiet_NaN());
+		size_t drivable = 0;
+		for (int y = 0; y < static_cast<int>(model.getSizeY()); ++y)
+		{
+			for (int x = 0; x < static_cast<int>(model.getSizeX()); ++x)
+			{
+				drivable += simEngine.isDrivable(PointT(x, y)) ? 1 : 0;
+			}
+		}
+		std::cout << "Swamps: " << swamps->count() << ", cells: " << swamps->cells() << " of " << drivable << " drivable ("
+			<< 100.0 * swamps->cells() / std::max<size_t>(1, drivable) << "%), " << elapsed() << " s" << std::endl;
+		return 0;
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return -1;
+	}
+}
@@ -5,14 +5,30 @@
 #include "visualizer.h"
 #include "model.h"
 
+#include <algorithm>
 #include <vector>
 #include <functional>
+#include <limits>
 #include <ostream>
+#include <stdexcept>
 
 namespace visualizer 
 {
 
-/// Rander map with route to a BMP file (pic.bmp)
+/// Options of route rendering (see MapsViewer::renderRoute)
+struct RenderOptions
+{
+	RenderOptions() : crop(false), margin(DEFAULT_MARGIN), scale(1)
+	{}
+
+	static const size_t DEFAULT_MARGIN = 64;
+
+	bool crop; ///< only the bounding box of the route and stop points is rendered
+	size_t margin; ///< cells around the bounding box if crop is set
+	size_t scale; ///< a pixel is a square of scale x scale cells. Route and stop marks win over the terrain in it
+};
+
+/// Rander map with route to a BMP file (pic.bmp) or to an image in memory
 struct MapsViewer 
 {
 	MapsViewer(MapsModel& model): model(model)
@@ -20,124 +36,237 @@ struct MapsViewer
 	}
 
 	/// Rander map with route to a BMP file (pic.bmp)
-	void showRoute(const PathTimes& path, const std::list<PointT>& basePoints)
+	/// PathT is a BasicPathTimes, PointsT is a container of stop points
+	template<typename PathT, typename PointsT>
+	void showRoute(const PathT& path, const PointsT& basePoints)
 	{
 		auto forecastTime = path.getForecastTime();
 		std::cout << "Time forecast for the trip is: " << forecastTime << " island seconds" << std::endl;
 
 		// Show results on view
 		std::ofstream of("pic.bmp", std::ofstream::binary);
-
-		visualizer::writeBMP(
-			of,
-			model.elevation().rawData(),
-			model.getSizeX(),
-			model.getSizeY(),
-			[&](int x, int y, uint8_t elevation) 
-			{
-				// Marks interesting positions on the map
-				if (donut(x, y, basePoints))
-				{
-					return static_cast<uint8_t>(visualizer::IPV_PATH);
-				}
-
-				//Show Path dots
-				PointT point(x, y);
-				uint8_t pathType = static_cast<uint8_t>(visualizer::IPV_ELEVATION_BEGIN);
-				if (extactPathColor(path, model.overrides(), point, pathType))
-				{
-					return pathType;
-				}
-
-				// Signifies water
-				if ((model.overrides().get(std::make_pair(x, y)) & (OF_WATER_BASIN | OF_RIVER_MARSH)) ||
-					elevation == 0)
-				{
-					return static_cast<uint8_t>(visualizer::IPV_WATER);
-				}
-
-				// Signifies normal ground color
-				if (elevation < visualizer::IPV_ELEVATION_BEGIN)
-				{
-					elevation = static_cast<uint8_t>(visualizer::IPV_ELEVATION_BEGIN);
-				}
-				return elevation;
-			}
-		);
+		visualizer::writeBMP(of, renderRoute(path, basePoints, RenderOptions()));
 		of.flush();
 #if __APPLE__
 		auto res = system("open pic.bmp");
 		(void)res;
 #endif
 	}
-private:
-	static bool donut(int x, int y, const std::list<PointT>& basePoints)
+
+	/*! Rander map with route into an image. Only the area of the crop is read from the maps and rendered.
+		Previews for requests are cheap: e.g. crop with scale 4 around a local route is a few KB.
+		Use writeBMP or toBMP (visualizer.h) to get a file.
+	*/
+	template<typename PathT, typename PointsT>
+	Image renderRoute(const PathT& path, const PointsT& basePoints, const RenderOptions& options)
 	{
-		for(auto& pnt: basePoints)
+		if (!options.scale)
+		{
+			throw std::invalid_argument("Scale of rendering should be > 0");
+		}
+		Area area = { 0, 0, static_cast<int>(model.getSizeX()), static_cast<int>(model.getSizeY()) };
+		if (options.crop)
 		{
-			if (donut(x, y, pnt.first, pnt.second))
-				return true;
+			area = boundingBox(path, basePoints, static_cast<int>(options.margin));
 		}
-		return false;
+		// Times of the route in the area and its border. A cell is colored by the route in it or near it
+		const Area border = { area.left - 1, area.top - 1, area.right + 1, area.bottom + 1 };
+		const size_t borderWidth = border.right - border.left;
+		std::vector<TimeT> times(borderWidth * (border.bottom - border.top), std::numeric_limits<TimeT>::quiet_NaN());
+		path.forEach([&](const PointT& point, const TimeT& tm) {
+			if (border.contains(point))
+			{
+				times[borderWidth * (point.second - border.top) + (point.first - border.left)] = tm;
+			}
+		});
+
+		Image cells(area.right - area.left, area.bottom - area.top);
+		for (int y = area.top; y < area.bottom; ++y)
+		{
+			for (int x = area.left; x < area.right; ++x)
+			{
+				cells.pixels[cells.width * (y - area.top) + (x - area.left)] = cellColor(PointT(x, y), times, border);
+			}
+		}
+		// Marks interesting positions on the map
+		for (auto& pnt : basePoints)
+		{
+			for (int y = std::max(area.top, pnt.second - DONUT_RADIUS); y <= std::min(area.bottom - 1, pnt.second + DONUT_RADIUS); ++y)
+			{
+				for (int x = std::max(area.left, pnt.first - DONUT_RADIUS); x <= std::min(area.right - 1, pnt.first + DONUT_RADIUS); ++x)
+				{
+					if (donut(x, y, pnt.first, pnt.second))
+					{
+						cells.pixels[cells.width * (y - area.top) + (x - area.left)] = static_cast<uint8_t>(visualizer::IPV_PATH);
+					}
+				}
+			}
+		}
+		if (options.scale == 1)
+		{
+			return cells;
+		}
+		return downsample(cells, options.scale);
 	}
 
-	static bool donut(int x, int y, int x1, int y1)
+private:
+	static const int DONUT_RADIUS = 20;
+
+	/// Cells [left, right) x [top, bottom)
+	struct Area
 	{
-		int dx = x - x1;
-		int dy = y - y1;
-		int r2 = dx * dx + dy * dy;
-		return r2 >= 150 && r2 <= 400;
-	}
+		int left;
+		int top;
+		int right;
+		int bottom;
 
+		bool contains(const PointT& point) const
+		{
+			return point.first >= left && point.first < right && point.second >= top && point.second < bottom;
+		}
+	};
 
-	static bool extactPathSurroundings(const PathTimes& path, const MapExplorer& map, const PointT& point, TimeT& tm)
+	template<typename PathT, typename PointsT>
+	Area boundingBox(const PathT& path, const PointsT& basePoints, int margin) const
 	{
-		int pathType = visualizer::IPV_ELEVATION_BEGIN;
-		if (path.extract(point, tm))
+		Area box = { std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min() };
+		auto add = [&box](const PointT& point) {
+			box.left = std::min(box.left, point.first);
+			box.top = std::min(box.top, point.second);
+			box.right = std::max(box.right, point.first + 1);
+			box.bottom = std::max(box.bottom, point.second + 1);
+		};
+		path.forEach([&](const PointT& point, const TimeT&) { add(point); });
+		for (auto& pnt : basePoints)
 		{
-			return true;
+			add(pnt);
 		}
-		auto neigbList = map.getNeighbors(point);
-		for (auto& pnt : neigbList)
+		if (box.left > box.right)
 		{
-			if (path.extract(pnt, tm))
-			{
-				return true;
-			}
+			// Nothing to show
+			box = { 0, 0, 1, 1 };
 		}
-		return false;
+		box.left = std::max(0, box.left - margin);
+		box.top = std::max(0, box.top - margin);
+		box.right = std::min(static_cast<int>(model.getSizeX()), box.right + margin);
+		box.bottom = std::min(static_cast<int>(model.getSizeY()), box.bottom + margin);
+		return box;
 	}
 
-	static bool extactPathColor(const PathTimes& path, const MapExplorer& map, const PointT& point, uint8_t& pathType)
+	/// Route color, water or terrain. The route is taken from the point or from the first neighbor on the route
+	uint8_t cellColor(const PointT& point, const std::vector<TimeT>& times, const Area& border) const
 	{
-		pathType = visualizer::IPV_ELEVATION_BEGIN;
-		TimeT tm; //Time elapsed for go throughTimePoint
-		if (extactPathSurroundings(path, map, point, tm))
+		const size_t borderWidth = border.right - border.left;
+		auto time = [&](const PointT& pnt) { return times[borderWidth * (pnt.second - border.top) + (pnt.first - border.left)]; };
+		TimeT tm = time(point);
+		// The same order of neighbors as BaseMap::getNeighbors
+		static const int offsets[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {1, -1}, {1, 0}, {1, 1}, {0, -1}, {0, 1} };
+		for (size_t id = 0; id < 8 && tm != tm; ++id)
 		{
-			if (tm < 0.95)
+			const PointT neighbor(point.first + offsets[id][0], point.second + offsets[id][1]);
+			if (neighbor.first >= 0 && neighbor.second >= 0 &&
+				neighbor.first < static_cast<int>(model.getSizeX()) && neighbor.second < static_cast<int>(model.getSizeY()))
 			{
-				pathType = static_cast<uint8_t>(visualizer::IPV_QUICK_PATH);
-				return true;
+				tm = time(neighbor);
 			}
-			if (tm < 2)
-			{
-				pathType = static_cast<uint8_t>(visualizer::IPV_NORMAL_PATH);
-				return true;
-			}
-			if (tm < 4)
-			{
-				pathType = static_cast<uint8_t>(visualizer::IPV_SLOW_PATH);
-				return true;
-			}
-			if (tm >= 4)
+		}
+		if (tm == tm)
+		{
+			return pathColor(tm);
+		}
+		const uint8_t elevation = model.elevation().get(point);
+		// Signifies water
+		if ((model.overrides().get(point) & (OF_WATER_BASIN | OF_RIVER_MARSH)) || elevation == 0)
+		{
+			return static_cast<uint8_t>(visualizer::IPV_WATER);
+		}
+		// Signifies normal ground color
+		return std::max(elevation, static_cast<uint8_t>(visualizer::IPV_ELEVATION_BEGIN));
+	}
+
+	static uint8_t pathColor(TimeT tm)
+	{
+		if (tm < 0.95)
+		{
+			return static_cast<uint8_t>(visualizer::IPV_QUICK_PATH);
+		}
+		if (tm < 2)
+		{
+			return static_cast<uint8_t>(visualizer::IPV_NORMAL_PATH);
+		}
+		if (tm < 4)
+		{
+			return static_cast<uint8_t>(visualizer::IPV_SLOW_PATH);
+		}
+		return static_cast<uint8_t>(visualizer::IPV_TOO_SLOW_PATH);
+	}
+
+	/// Pooling of scale x scale cells. Stop marks win, then the slowest route color, then the highest terrain, then water
+	static Image downsample(const Image& cells, size_t scale)
+	{
+		Image result((cells.width + scale - 1) / scale, (cells.height + scale - 1) / scale);
+		for (size_t y = 0; y < result.height; ++y)
+		{
+			for (size_t x = 0; x < result.width; ++x)
 			{
-				pathType = static_cast<uint8_t>(visualizer::IPV_TOO_SLOW_PATH);
-				return true;
+				int best = -1;
+				for (size_t cellY = y * scale; cellY < std::min(cells.height, (y + 1) * scale); ++cellY)
+				{
+					for (size_t cellX = x * scale; cellX < std::min(cells.width, (x + 1) * scale); ++cellX)
+					{
+						best = std::max(best, poolRank(cells.pixels[cells.width * cellY + cellX]));
+					}
+				}
+				result.pixels[result.width * y + x] = fromPoolRank(best);
 			}
+		}
+		return result;
+	}
 
+	/// Pool ranks: water 0, terrain 1..250 by elevation, route colors 251..254, stop mark 255
+	static int poolRank(uint8_t value)
+	{
+		if (value == visualizer::IPV_PATH)
+		{
+			return 255;
+		}
+		if (value == visualizer::IPV_WATER)
+		{
+			return 0;
 		}
-		return false;
+		if (value < visualizer::IPV_ELEVATION_BEGIN)
+		{
+			return 249 + value;
+		}
+		return value - visualizer::IPV_ELEVATION_BEGIN + 1;
 	}
+
+	static uint8_t fromPoolRank(int rank)
+	{
+		if (rank == 255)
+		{
+			return static_cast<uint8_t>(visualizer::IPV_PATH);
+		}
+		if (rank == 0)
+		{
+			return static_cast<uint8_t>(visualizer::IPV_WATER);
+		}
+		if (rank > 250)
+		{
+			return static_cast<uint8_t>(rank - 249);
+		}
+		return static_cast<uint8_t>(rank - 1 + visualizer::IPV_ELEVATION_BEGIN);
+	}
+
+	static bool donut(int x, int y, int x1, int y1)
+	{
+		int dx = x - x1;
+		int dy = y - y1;
+		int r2 = dx * dx + dy * dy;
+		return r2 >= 150 && r2 <= 400;
+	}
+
+
 private:
 	MapsModel & model;
 };
@@ -4,6 +4,7 @@
 #include <vector>
 #include <functional>
 #include <ostream>
+#include <stdint.h>
 
 namespace visualizer {
 
@@ -21,6 +22,20 @@ enum ImagePixelValues
 };
 
 
+/// 8-bit image of pixel values (see ImagePixelValues). Rows go from the top
+struct Image
+{
+	Image() : width(0), height(0)
+	{}
+
+	Image(size_t width, size_t height) : width(width), height(height), pixels(width * height, 0)
+	{}
+
+	size_t width;
+	size_t height;
+	std::vector<uint8_t> pixels;
+};
+
 /** A method to write BMP file contents to a specified ostream.
  *
  * @param out The ostream to use for output. Could be directed into anything
@@ -39,6 +54,12 @@ void writeBMP(
     size_t height,
     std::function<uint8_t(size_t, size_t, uint8_t)> pixelFilter);
 
+/// Writes the image as a BMP with the elevation colormap
+void writeBMP(std::ostream& out, const Image& image);
+
+/// \return the image as BMP file contents in memory
+std::vector<uint8_t> toBMP(const Image& image);
+
 } // namespace visualizer
 
 #endif // __VISUALIZER_H__
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <array>
+#include <sstream>
 #include <string.h>
 
 
@@ -207,5 +208,22 @@ void writeBMP(
     writeBMP(out, width, height, elevationData, &colormap[0], colormap.size() / 3, pixelFilter);
 }
 
+void writeBMP(std::ostream& out, const Image& image)
+{
+    if (image.pixels.empty())
+    {
+        return;
+    }
+    writeBMP(out, &image.pixels[0], image.width, image.height, [](size_t, size_t, uint8_t value) { return value; });
+}
+
+std::vector<uint8_t> toBMP(const Image& image)
+{
+    std::ostringstream out;
+    writeBMP(out, image);
+    const std::string data = out.str();
+    return std::vector<uint8_t>(data.begin(), data.end());
+}
+
 
 } // namespace visualizer